@@ -1,6 +1,25 @@
 #include "common.hlsli"
 USE_CBUFFER(BrushState, Brush, 1);
 
+#ifdef BRUSH_PACKED_VERTEX
+// VertexSolidPacked
+struct Input
+{
+    float3 position : POSITION;
+    float2 uv       : TEXCOORD0;
+    float2 normal   : NORMAL0;       // Octahedral
+    uint4  extra    : BLENDINDICES0; // x: face part, y: alpha
+};
+
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float  t = saturate(-n.z);
+    n.xy += n.xy >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#else
+// VertexSolid
 struct Input
 {
     float3 position : POSITION;
@@ -8,6 +27,7 @@ struct Input
     float3 uv       : TEXCOORD0;
     uint   face     : BLENDINDICES0;
 };
+#endif
 
 struct Varyings
 {
@@ -23,10 +43,18 @@ Varyings vs_main(Input i)
     Varyings v = (Varyings)0;
 
     v.position = mul(Camera.viewProj, float4(i.position, 1.0));
-    v.normal   = i.normal;
     v.view     = mul(Camera.view, float4(i.position, 1.0)).xyz;
+#ifdef BRUSH_PACKED_VERTEX
+    // Same as SelectionIDs::MakePart
+    uint face  = Brush.faceBase | (i.extra.x << Brush.partShift);
+    v.normal   = OctDecode(i.normal);
+    v.uv       = float3(i.uv, i.extra.y / 255.0);
+#else
+    uint face  = i.face;
+    v.normal   = i.normal;
     v.uv       = i.uv;
-    v.id       = Brush.id == 0 ? i.face : Brush.id;
+#endif
+    v.id       = Brush.id == 0 ? face : Brush.id;
 
     return v;
 }
@@ -0,0 +1,2 @@
+#define BRUSH_PACKED_VERTEX
+#include "brush_blend.hlsl"
@@ -0,0 +1,2 @@
+#define BRUSH_PACKED_VERTEX
+#include "brush.hlsl"
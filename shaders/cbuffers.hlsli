@@ -22,5 +22,7 @@ struct BrushState
 {
     float4 color;
     uint id;
-    float3 padding;
+    uint faceBase;  // Selection ID of the solid, packed vertices add their part to it
+    uint partShift; // SelectionIDs::IndexBits, where the part goes in an ID
+    float padding;
 };
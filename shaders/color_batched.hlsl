@@ -0,0 +1,46 @@
+#include "common.hlsli"
+
+// Gizmos::Vertex, batched lines and triangles in world space
+struct Input
+{
+    float3 position : POSITION;
+    float3 normal   : NORMAL0; // Zero for unlit
+    float4 color    : COLOR0;
+    uint   id       : BLENDINDICES0;
+};
+
+struct Varyings
+{
+    float4 position : SV_POSITION;
+    float3 normal   : NORMAL0;
+    float3 view     : TEXCOORD0;
+    float4 color    : COLOR0;
+    uint   id       : BLENDINDICES0;
+};
+
+struct Output
+{
+    float4 color : SV_TARGET0;
+    uint   id    : SV_TARGET1;
+};
+
+Varyings vs_main(Input i)
+{
+    Varyings v = (Varyings)0;
+    v.position = mul(Camera.viewProj, float4(i.position, 1.0));
+    v.view     = mul(Camera.view, float4(i.position, 1.0)).xyz;
+    v.normal   = i.normal;
+    v.color    = i.color;
+    v.id       = i.id;
+    return v;
+}
+
+Output ps_main(Varyings v)
+{
+    Output o = (Output)0;
+    o.color = v.color;
+    if (any(v.normal != 0))
+        o.color.rgb *= Lighting(v.normal, v.view);
+    o.id = v.id;
+    return o;
+}
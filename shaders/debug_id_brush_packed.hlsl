@@ -0,0 +1,2 @@
+#define BRUSH_PACKED_VERTEX
+#include "debug_id_brush.hlsl"
@@ -8,6 +8,7 @@
 #include "common/Span.h"
 #include "common/Filesystem.h"
 #include "common/Event.h"
+#include "common/Profiler.h"
 #include "../submodules/libvpk-plusplus/libvpk++.h"
 
 #include <vector>
@@ -71,6 +72,8 @@ namespace chisel
 
     // Events //
         Event<> OnRefresh;
+        // After an asset is loaded for the first time.
+        Event<> OnLoad;
 
     private:
         std::vector<Path> searchPaths;
@@ -84,6 +87,8 @@ namespace chisel
         if (IsLoaded(path)) [[likely]]
             return Rc<T>(static_cast<T*>(T::AssetDB[path]));
 
+        PROFILE_SCOPE(Profiler.Intern(path));
+
         // Lookup file extension
         auto* loader = AssetLoader<T>::ForExtension(path.ext());
         if (!loader) {
@@ -102,6 +107,7 @@ namespace chisel
                 Console.Error("[Assets] Failed to import {} asset: {}", path.ext(), path);
                 return GetDefaultAsset<T>();
             }
+            OnLoad();
         }
         catch (std::exception& err)
         {
@@ -3,6 +3,8 @@
 #include "math/Math.h"
 #include "chisel/map/Common.h"
 
+#include <algorithm>
+#include <limits>
 #include <sstream>
 
 #define LIBMDL_CUSTOM_VECTORS
@@ -40,7 +42,7 @@ namespace chisel
         const libmdl::VVDHeader& vvdData = model.getVertices();
         const libmdl::VTXHeader& vtxData = model.getMeshData();
 
-        MeshBuffer<VertexSolid, uint32> mesh;
+        Mesh mesh;
 
         //
         // Materials
@@ -64,85 +66,116 @@ namespace chisel
             }
         }
 
+        //
+        // Vertex Buffer
+        //
+        // The VVD has every vertex once, by body part, then model, then mesh.
+        // Every LOD indexes into it, so they all share one buffer.
+        // Where each mesh's vertices start comes from the MDL, see the index buffer below.
+        uint32 numVertices = vvdData.numLODVertexes[0];
+
         // Important this does not get reallocated
-        size_t numIndices = 0;
-        for (const vtx::BodyPart& bodypart : vtxData.bodyParts(vtxData))
+        auto& vertices = *new std::vector<VertexSolid>;
+        auto& indices  = *new std::vector<uint32>;
+        vertices.reserve(numVertices);
+
+        AABB bounds = { vec3(std::numeric_limits<float>::max()), vec3(std::numeric_limits<float>::lowest()) };
+        for (uint32 i = 0; i < numVertices; i++)
         {
-            const vtx::Model& model = bodypart.models(bodypart)[0];
-            const vtx::ModelLOD& lod = model.lods(model)[0];
-            for (const vtx::Mesh& meshPart : lod.meshes(lod))
-                for (const vtx::StripGroup& stripGroup : meshPart.stripGroups(meshPart))
-                    numIndices += stripGroup.indices.count;
+            const vvd::Vertex& vert = vvdData.getVertex(i);
+            vertices.push_back(VertexSolid {
+                .position = vert.position,
+                .normal = vert.normal,
+                .uv = vec3(vert.texCoord, 0),
+                .face = 0
+            });
+            bounds = AABB::Extend(bounds, vert.position);
         }
-        mesh.vertices.reserve(vvdData.numLODVertexes[0]);
-        mesh.indices.reserve(numIndices);
 
-        uint32 vertOffset = 0;
+        //
+        // Index Buffer
+        //
+        // One group per mesh per LOD, LOD by LOD. Only the first submodel of each body part.
+        struct GroupRange { uint firstIndex, indexCount; int material; };
+        std::vector<GroupRange> ranges;
 
-        // how many layers of nesting are you on? you are like a little baby. watch this
-        int b = 0;
-        for (const vtx::BodyPart& bodypart : vtxData.bodyParts(vtxData))
+        for (uint lodIndex = 0;; lodIndex++)
         {
-            const mdl::BodyPart* mdlbodypart = mdlData.bodyParts.get(&mdlData, b++);
-            int md = 0;
-            for (const vtx::Model& model : bodypart.models(bodypart))
+            Mesh::LOD lodRange = { .firstGroup = uint(ranges.size()) };
+            bool any = false;
+
+            int b = 0;
+            for (const vtx::BodyPart& bodypart : vtxData.bodyParts(vtxData))
             {
-                const mdl::Model* mdlmodel = mdlbodypart->modelData.get(mdlbodypart, md++);
-                for (const vtx::ModelLOD& lod : model.lods(model))
+                const mdl::BodyPart* mdlbodypart = mdlData.bodyParts.get(&mdlData, b++);
+
+                for (const vtx::Model& model : bodypart.models(bodypart))
                 {
-                    int ms = 0;
-                    for (const vtx::Mesh& meshPart : lod.meshes(lod))
+                    const mdl::Model* mdlmodel = mdlbodypart->modelData.get(mdlbodypart, 0);
+                    auto lods = model.lods(model);
+                    if (lodIndex < lods.size())
                     {
-                        uint32 indexOffset = 0;
+                        any = true;
 
-                        const mdl::Mesh* mdlmesh = mdlmodel->meshes.get(mdlmodel, ms++);
-                        for (const vtx::StripGroup& stripGroup : meshPart.stripGroups(meshPart))
+                        int ms = 0;
+                        for (const vtx::Mesh& meshPart : lods[lodIndex].meshes(lods[lodIndex]))
                         {
-                            //
-                            // Vertex Buffer
-                            //
-                            for (const vtx::Vertex& vt : stripGroup.vertices(stripGroup))
-                            {
-                                const vvd::Vertex& vert = vvdData.getVertex(vt.origMeshVertID + vertOffset);
-                                mesh.vertices.push_back(VertexSolid {
-                                    .position = vert.position,
-                                    .normal = vert.normal,
-                                    .uv = vec3(vert.texCoord, 0),
-                                    .face = 0
-                                });
-                            }
+                            const mdl::Mesh* mdlmesh = mdlmodel->meshes.get(mdlmodel, ms++);
 
-                            //
-                            // Index Buffer
-                            //
-                            auto indices = stripGroup.indices(stripGroup);
-                            for (size_t i = 0; i < indices.size(); i++)
+                            // vertexindex is a byte offset into the VVD's vertices, vertexoffset counts from the model's first.
+                            uint32 base = uint32(mdlmodel->vertexindex / sizeof(vvd::Vertex)) + uint32(mdlmesh->vertexoffset);
+
+                            GroupRange range = { uint(indices.size()), 0, mdlmesh->material };
+                            for (const vtx::StripGroup& stripGroup : meshPart.stripGroups(meshPart))
                             {
-                                size_t j = i;
-                                switch (j % 3) { // Swap winding order
-                                    case 0: j += 2; break;
-                                    case 2: j -= 2; break;
+                                auto stripVerts   = stripGroup.vertices(stripGroup);
+                                auto stripIndices = stripGroup.indices(stripGroup);
+                                for (size_t i = 0; i < stripIndices.size(); i++)
+                                {
+                                    size_t j = i;
+                                    switch (j % 3) { // Swap winding order
+                                        case 0: j += 2; break;
+                                        case 2: j -= 2; break;
+                                    }
+                                    uint32 vertex = base + stripVerts[stripIndices[j]].origMeshVertID;
+                                    if (vertex >= numVertices)
+                                        throw std::runtime_error("MDL Loader: .dx90.vtx refers to a vertex past the end of the .vvd");
+                                    indices.push_back(vertex);
                                 }
-                                mesh.indices.push_back(indices[j] + indexOffset);
                             }
-
-                            indexOffset += stripGroup.vertices.count;
-                            vertOffset += stripGroup.vertices.count;
+                            range.indexCount = uint(indices.size()) - range.firstIndex;
+                            ranges.push_back(range);
                         }
-
-                        mesh.AddGroup(mdlmesh->material);
-                        indexOffset = 0;
                     }
 
-                    // Ignore other LODs
+                    // Ignore other submodels
                     break;
                 }
+            }
 
-                // Ignore other submodels
+            if (!any)
                 break;
-            }
+
+            lodRange.groupCount = uint(ranges.size()) - lodRange.firstGroup;
+            mesh.lods.push_back(lodRange);
         }
 
+        // All groups share the same two buffers, so they're uploaded once.
+        VertexBuffer vertexBuffer = VertexBuffer(VertexSolid::Layout, vertices.data(), vertices.size() * sizeof(VertexSolid));
+        IndexBuffer  indexBuffer  = IndexBuffer(indices.data(), indices.size() * sizeof(uint32));
+        for (const GroupRange& range : ranges)
+        {
+            Mesh::Group& group = mesh.AddGroup();
+            group.vertices   = vertexBuffer;
+            group.indices    = indexBuffer;
+            group.material   = range.material;
+            group.firstIndex = range.firstIndex;
+            group.indexCount = range.indexCount;
+        }
+
+        if (!vertices.empty())
+            mesh.bounds = bounds;
+
         outMesh = mesh;
     }};
 }
@@ -44,6 +44,7 @@ namespace chisel
             .SysMemSlicePitch = 0,
         };
         Engine.rctx.device->CreateTexture2D(&desc, &initialData, &tex.texture);
+        tex.SetDesc(desc, channels == 4);
         D3D11_SHADER_RESOURCE_VIEW_DESC srvDescLinear =
         {
             .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
@@ -89,6 +90,26 @@ namespace chisel
         }
     }
 
+    // TEXTUREFLAGS_ONEBITALPHA, DXT1 has no alpha unless this is set.
+    static constexpr uint32_t VTFOneBitAlpha = 0x1000;
+
+    inline bool HasAlpha(DXGI_FORMAT format, uint32_t vtfFlags = 0)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+            return (vtfFlags & VTFOneBitAlpha) != 0;
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return true;
+        default:
+            return false;
+        }
+    }
+
     static AssetLoader<Texture> VTFLoader = { ".VTF", [](Texture& tex, const Buffer& data)
     {
         // TODO: Make copy-less.
@@ -128,6 +149,7 @@ namespace chisel
             mipData.push_back(initialData);
         }
         Engine.rctx.device->CreateTexture2D(&desc, mipData.data(), &tex.texture);
+        tex.SetDesc(desc, HasAlpha(format, header.flags));
         D3D11_SHADER_RESOURCE_VIEW_DESC srvDescLinear =
         {
             .Format = format,
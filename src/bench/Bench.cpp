@@ -0,0 +1,332 @@
+#include "chisel/Core.h"
+#include "chisel/map/Map.h"
+#include "chisel/Occlusion.h"
+#include "chisel/formats/Formats.h"
+#include "common/Filesystem.h"
+#include "common/Parallel.h"
+#include "common/Profiler.h"
+#include "common/Time.h"
+#include "console/Console.h"
+#include "formats/KeyValues.h"
+#include "render/CBuffers.h"
+#include "render/CommandList.h"
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/trigonometric.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** chisel-bench: Times the map core on its own, no window or GPU needed.
+ *
+ *  Usage: chisel-bench [iterations] [--trace out.json] [file.vmf...]
+ *  Defaults to the maps in tests/. --trace writes the profiler's zones for the last runs
+ *  as a Chrome/Perfetto trace.
+ */
+
+#ifndef CHISEL_TESTS_DIR
+#define CHISEL_TESTS_DIR "tests"
+#endif
+
+namespace chisel::bench
+{
+    using Seconds = Time::Seconds;
+
+    struct Timings
+    {
+        Seconds parse  = 0; // Text -> KeyValues
+        Seconds import = 0; // Whole ImportVMF (parse, CSG, mesh, upload)
+        Seconds csg    = 0; // Solid::UpdateFaces on every solid
+        Seconds mesh   = 0; // Solid::UpdateMeshes on every solid
+        Seconds save   = 0; // ExportVMF
+        Seconds occlusion = 0; // Rasterizing occluders and testing every solid, from the middle of the map
+        Seconds record = 0;    // Recording every brush mesh into 4 command lists in parallel and submitting them to a null backend
+
+        size_t  visible = 0;
+        size_t  hidden  = 0; // Occluded or off screen
+        size_t  commands = 0; // Per viewport
+
+        size_t  solids = 0;
+        Map::BrushMemory memory;
+    };
+
+    template <typename Fn>
+    static Seconds Measure(Fn&& fn)
+    {
+        Seconds start = Time::GetTime();
+        fn();
+        return Time::GetTime() - start;
+    }
+
+    static void ForEachSolid(Map& map, auto&& fn)
+    {
+        for (Solid& solid : map.Brushes())
+            fn(solid);
+
+        for (BrushEntity* ent : map.BrushEntities())
+        {
+            for (Solid& solid : ent->Brushes())
+                fn(solid);
+        }
+    }
+
+    static bool Run(const std::string& path, Timings& t)
+    {
+        auto text = fs::readTextFile(path);
+        if (!text)
+            return false;
+
+        t.parse += Measure([&] {
+            auto kv = kv::KeyValues::ParseFromUTF8(StringView{ *text });
+        });
+
+        Map map;
+        Core.map = &map;
+
+        bool ok = true;
+        t.import += Measure([&] { ok = ImportVMF(path, map); });
+        if (!ok)
+        {
+            Core.map = nullptr;
+            return false;
+        }
+
+        t.solids = 0;
+        t.csg += Measure([&] {
+            ForEachSolid(map, [&](Solid& solid) { solid.UpdateFaces(); t.solids++; });
+        });
+
+        Core.brushAllocator->open();
+        t.mesh += Measure([&] {
+            ForEachSolid(map, [](Solid& solid) { solid.UpdateMeshes(); });
+        });
+        Core.brushAllocator->close();
+
+        t.memory = map.GetBrushMemory();
+
+        // Same settings as r_occlusion_occluder_size, looking down +X from the middle of the world.
+        if (std::optional<AABB> bounds = map.GetBounds())
+        {
+            vec3 eye = bounds->Center();
+            mat4x4 view = glm::lookAtLH(eye, eye + vec3(1, 0, 0), vec3(0, 0, 1));
+            mat4x4 proj = glm::perspectiveLH_ZO(glm::radians(75.0f), 16.0f / 9.0f, 1.0f, 16384.0f);
+
+            OcclusionCuller culler;
+            t.occlusion += Measure([&] {
+                culler.Begin(proj * view);
+                for (const Solid& solid : map.Brushes())
+                {
+                    if (OcclusionCuller::IsOccluder(solid, 256.0f))
+                        culler.AddOccluder(solid);
+                }
+                culler.Finish();
+
+                ForEachSolid(map, [&](Solid& solid) {
+                    if (std::optional<AABB> solidBounds = solid.GetBounds())
+                        culler.IsVisible(*solidBounds);
+                });
+            });
+
+            const OcclusionCuller::Stats& stats = culler.GetStats();
+            t.visible = stats.visible;
+            t.hidden  = stats.occluded + stats.outside;
+        }
+
+        // What MapRender records for each brush mesh, as if 4 viewports were open.
+        {
+            static const render::Shader shader;
+            std::vector<const BrushMesh*> meshes;
+            ForEachSolid(map, [&](Solid& solid) {
+                for (const BrushMesh& mesh : solid.GetMeshes())
+                    meshes.push_back(&mesh);
+            });
+
+            render::CommandList lists[4];
+            render::NullCommandBackend backend;
+            t.record += Measure([&] {
+                ParallelFor(std::size(lists), [&](size_t i)
+                {
+                    render::CommandList& cmd = lists[i];
+                    cmd.Reset();
+                    for (const BrushMesh* mesh : meshes)
+                    {
+                        cbuffers::BrushState state;
+                        state.id = mesh->brush->GetSelectionID();
+                        state.faceBase = state.id;
+                        state.partShift = SelectionIDs::IndexBits;
+                        state.color = vec4(1.0f);
+
+                        cmd.UploadConstBuffer(1, nullptr, &state, sizeof(state), render::VertexShader | render::PixelShader);
+                        cmd.SetShaderResource(0, nullptr);
+                        cmd.SetShader(shader);
+                        cmd.SetVertexBuffer(0, nullptr, 0, 0);
+                        cmd.SetIndexBuffer(nullptr, DXGI_FORMAT_R32_UINT, 0);
+                        cmd.DrawIndexed(mesh->GetLOD(0).indexCount);
+                    }
+                });
+
+                for (const render::CommandList& cmd : lists)
+                    backend.Submit(cmd);
+            });
+
+            t.commands = lists[0].GetStats().commands;
+        }
+
+        std::string out = path + ".bench.vmf";
+        t.save += Measure([&] { ok = ExportVMF(out, map); });
+        std::filesystem::remove(out);
+
+        Core.map = nullptr;
+        return ok;
+    }
+
+    // Fixed scene with a known answer, so culling changes can't quietly hide too much:
+    // from the origin looking down +X, a wall hides a box behind it but not one off to its side,
+    // nor a small far one that lands in the pixel column the wall's edge only partly covers,
+    // and never itself.
+    static bool CheckOcclusion()
+    {
+        Map map;
+        Core.map = &map;
+
+        Solid& wall = map.AddBrush(CreateCubeBrush(nullptr, vec3(16, 512, 512), glm::translate(mat4x4(1.0f), vec3(512, 0, 0))), false);
+        wall.UpdateFaces();
+        Core.brushAllocator->open();
+        wall.UpdateMeshes();
+        Core.brushAllocator->close();
+
+        mat4x4 view = glm::lookAtLH(vec3(0.0f), vec3(1, 0, 0), vec3(0, 0, 1));
+        mat4x4 proj = glm::perspectiveLH_ZO(glm::radians(75.0f), 16.0f / 9.0f, 1.0f, 16384.0f);
+
+        OcclusionCuller culler;
+        culler.Begin(proj * view);
+        culler.AddOccluder(wall);
+        culler.Finish();
+
+        bool ok = true;
+        auto expect = [&](const char* what, const AABB& bounds, bool visible)
+        {
+            if (culler.IsVisible(bounds) != visible)
+            {
+                Console.Error("Occlusion check failed: {} should be {}", what, visible ? "visible" : "occluded");
+                ok = false;
+            }
+        };
+
+        expect("the wall",              *wall.GetBounds(),                                 true);
+        expect("a box behind the wall", AABB{ vec3(1024, -32, -32),  vec3(1088, 32, 32) }, false);
+        expect("a box beside the wall", AABB{ vec3(1024, 1200, -32), vec3(1088, 1264, 32) }, true);
+        expect("a box just past the wall's edge", AABB{ vec3(4096, 2087, -8), vec3(4104, 2091, 8) }, true);
+
+        Core.map = nullptr;
+        return ok;
+    }
+
+    // With r_disp_mask_solid off, the plain sides of displacement brushes are meshed too
+    // and every face of them has to draw something.
+    static bool CheckDisplacements()
+    {
+        Map map;
+        Core.map = &map;
+        r_disp_mask_solid.SetValue(false);
+
+        bool ok = ImportVMF(std::string(CHISEL_TESTS_DIR) + "/test_disp.vmf", map);
+        if (!ok)
+            Console.Error("Displacement check failed: couldn't load test_disp.vmf");
+
+        size_t empty = 0;
+        ForEachSolid(map, [&](const Solid& solid)
+        {
+            if (!solid.HasDisplacement())
+                return;
+
+            for (const BrushMesh& mesh : solid.GetMeshes())
+                empty += mesh.indexCount == 0;
+            for (const Face& face : solid.GetFaces())
+                empty += face.GetDispIndexCount() == 0;
+        });
+
+        if (empty)
+        {
+            Console.Error("Displacement check failed: {} meshes or faces of displacement brushes have no indices", empty);
+            ok = false;
+        }
+
+        r_disp_mask_solid.SetValue(true);
+        Core.map = nullptr;
+        return ok;
+    }
+
+    static int Main(int argc, char* argv[])
+    {
+        Core.brushAllocator = std::make_unique<NullBrushAllocator>();
+
+        int iterations = 1;
+        int first = 1;
+        if (argc > 1 && std::atoi(argv[1]) > 0)
+        {
+            iterations = std::atoi(argv[1]);
+            first = 2;
+        }
+
+        std::vector<std::string> files;
+        std::string tracePath;
+        for (int i = first; i < argc; i++)
+        {
+            if (std::string_view(argv[i]) == "--trace" && i + 1 < argc)
+                tracePath = argv[++i];
+            else
+                files.push_back(argv[i]);
+        }
+
+        if (files.empty())
+        {
+            for (const char* name : { "c1a0_d.vmf", "sdk_vehicles.vmf", "test_disp.vmf" })
+                files.push_back(std::string(CHISEL_TESTS_DIR) + "/" + name);
+        }
+
+        std::printf("%-24s %8s %10s %10s %10s %10s %10s %10s %10s %10s %8s %8s %10s %8s\n", "map", "solids", "parse ms", "import ms", "csg ms", "mesh ms", "export ms", "cpu MB", "gpu MB", "occl ms", "visible", "hidden", "record ms", "cmds");
+
+        int failures = CheckOcclusion() ? 0 : 1;
+        failures += CheckDisplacements() ? 0 : 1;
+        for (const auto& file : files)
+        {
+            Timings t;
+            bool ok = true;
+            for (int i = 0; i < iterations && ok; i++)
+                ok = Run(file, t);
+
+            if (!ok)
+            {
+                Console.Error("Failed to benchmark '{}'", file);
+                failures++;
+                continue;
+            }
+
+            auto ms = [&](Seconds s) { return s * 1000.0 / iterations; };
+            auto mb = [](size_t bytes) { return bytes / (1024.0 * 1024.0); };
+            std::printf("%-24s %8zu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %8zu %8zu %10.2f %8zu\n",
+                (const char*)fs::Path(file).filename(), t.solids,
+                ms(t.parse), ms(t.import), ms(t.csg), ms(t.mesh), ms(t.save),
+                mb(t.memory.cpu + t.memory.meshes), mb(t.memory.gpu),
+                ms(t.occlusion), t.visible, t.hidden,
+                ms(t.record), t.commands);
+        }
+
+        if (!tracePath.empty() && !Profiler.WriteTrace(tracePath))
+        {
+            Console.Error("Failed to write trace to '{}'", tracePath);
+            failures++;
+        }
+
+        return failures ? 1 : 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    return chisel::bench::Main(argc, argv);
+}
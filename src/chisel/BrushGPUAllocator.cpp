@@ -0,0 +1,238 @@
+#include "chisel/BrushGPUAllocator.h"
+#include "console/Console.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace chisel
+{
+    // Without fences (CreateQuery failed), assume the GPU is never more than this many frames behind.
+    static constexpr uint64_t MaxFramesInFlight = 3;
+
+    BrushGPUAllocator::BrushGPUAllocator(render::RenderContext& rctx)
+        : m_rctx(rctx)
+    {
+        auto& page = m_pages.emplace_back(std::make_unique<Page>(PageSize));
+        CreateBuffer(*page);
+    }
+
+    BrushGPUAllocator::~BrushGPUAllocator()
+    {
+        for (auto& page : m_pages)
+        {
+            if (page->mapped)
+                m_rctx.ctx->Unmap(page->buffer.ptr(), 0);
+        }
+    }
+
+    bool BrushGPUAllocator::CreateBuffer(Page& page)
+    {
+        D3D11_BUFFER_DESC desc
+        {
+            .ByteWidth      = page.size,
+            .Usage          = D3D11_USAGE_DYNAMIC,
+            .BindFlags      = D3D11_BIND_VERTEX_BUFFER,
+            .CPUAccessFlags = D3D11_CPU_ACCESS_WRITE,
+        };
+        HRESULT hr = m_rctx.device->CreateBuffer(&desc, nullptr, &page.buffer);
+        if (FAILED(hr))
+        {
+            Console.Error("[Brushes] Failed to create a {} MB brush buffer: {:#x}", page.size / (1024 * 1024), uint32_t(hr));
+            page.buffer = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    void BrushGPUAllocator::open()
+    {
+        // Pages are mapped as they're written to.
+        m_refs++;
+    }
+
+    void BrushGPUAllocator::close()
+    {
+        assert(m_refs > 0);
+        if (--m_refs != 0)
+            return;
+
+        for (auto& page : m_pages)
+        {
+            if (page->mapped)
+            {
+                m_rctx.ctx->Unmap(page->buffer.ptr(), 0);
+                page->mapped = nullptr;
+            }
+        }
+    }
+
+    uint8_t* BrushGPUAllocator::data(uint32_t index)
+    {
+        assert(m_refs > 0);
+        Page& page = *m_pages[index];
+        if (page.mapped)
+            return page.mapped;
+
+        // No overwrite: the GPU may still be drawing from the rest of the page,
+        // and freed ranges are only reused once it's done with them.
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        HRESULT hr = m_rctx.ctx->Map(page.buffer.ptr(), 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped);
+        if (FAILED(hr))
+        {
+            Console.Error("[Brushes] Failed to map brush page {}: {:#x}", index, uint32_t(hr));
+            return nullptr;
+        }
+
+        page.mapped = (uint8_t*)mapped.pData;
+        return page.mapped;
+    }
+
+    BrushAllocator::Allocation BrushGPUAllocator::alloc(uint32_t size)
+    {
+        for (uint32_t i = 0; i < m_pages.size(); i++)
+        {
+            Page& page = *m_pages[i];
+            if (page.buffer == nullptr || int32_t(i) == m_evacuating)
+                continue;
+
+            Allocation allocation = { page.allocator.allocate(size), i };
+            if (allocation.offset != Allocation::NO_SPACE)
+            {
+                page.used += page.allocator.allocationSize(allocation);
+                return allocation;
+            }
+        }
+
+        // Nothing fits, add a page. Meshes bigger than a page get one of their own.
+        uint32_t index = 0;
+        while (index < m_pages.size() && m_pages[index]->buffer != nullptr)
+            index++;
+
+        auto page = std::make_unique<Page>(std::max(PageSize, size));
+        if (!CreateBuffer(*page))
+            return Allocation{};
+
+        Allocation allocation = { page->allocator.allocate(size), index };
+        page->used += page->allocator.allocationSize(allocation);
+
+        if (index == m_pages.size())
+            m_pages.push_back(std::move(page));
+        else
+            m_pages[index] = std::move(page);
+
+        return allocation;
+    }
+
+    void BrushGPUAllocator::free(Allocation alloc)
+    {
+        Page& page = *m_pages[alloc.page];
+        uint32_t size = page.allocator.allocationSize(alloc);
+        page.used -= size;
+        m_pendingBytes += size;
+
+        // The GPU may still be drawing from it, hold on until this frame's fence.
+        m_frees.push_back(alloc);
+    }
+
+    void BrushGPUAllocator::Release(const Allocation& alloc)
+    {
+        Page& page = *m_pages[alloc.page];
+        m_pendingBytes -= page.allocator.allocationSize(alloc);
+        page.allocator.free(alloc);
+    }
+
+    void BrushGPUAllocator::EndFrame()
+    {
+        assert(m_refs == 0);
+        m_frame++;
+
+        if (!m_frees.empty())
+        {
+            PendingFrees pending = { .frame = m_frame };
+            if (!m_fences.empty())
+            {
+                pending.fence = std::move(m_fences.back());
+                m_fences.pop_back();
+            }
+            else
+            {
+                D3D11_QUERY_DESC desc = { .Query = D3D11_QUERY_EVENT };
+                if (FAILED(m_rctx.device->CreateQuery(&desc, &pending.fence)))
+                    pending.fence = nullptr;
+            }
+
+            if (pending.fence != nullptr)
+                m_rctx.ctx->End(pending.fence.ptr());
+
+            pending.allocs.swap(m_frees);
+            m_pending.push_back(std::move(pending));
+        }
+
+        bool released = false;
+        while (!m_pending.empty())
+        {
+            PendingFrees& pending = m_pending.front();
+            bool done = pending.fence != nullptr
+                ? m_rctx.ctx->GetData(pending.fence.ptr(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK
+                : m_frame - pending.frame >= MaxFramesInFlight;
+            if (!done)
+                break;
+
+            for (const Allocation& alloc : pending.allocs)
+                Release(alloc);
+            released = true;
+
+            if (pending.fence != nullptr)
+                m_fences.push_back(std::move(pending.fence));
+            m_pending.pop_front();
+        }
+
+        if (!released)
+            return;
+
+        // Give back pages that emptied out, but always keep one.
+        size_t live = std::count_if(m_pages.begin(), m_pages.end(), [](auto& page) { return page->buffer != nullptr; });
+        for (uint32_t i = 0; i < m_pages.size() && live > 1; i++)
+        {
+            Page& page = *m_pages[i];
+            if (page.buffer == nullptr || page.allocator.storageReport().totalFreeSpace != page.size)
+                continue;
+
+            page.buffer = nullptr;
+            page.allocator.reset();
+            live--;
+
+            if (int32_t(i) == m_evacuating)
+                m_evacuating = -1;
+        }
+    }
+
+    BrushAllocator::Stats BrushGPUAllocator::stats() const
+    {
+        Stats stats;
+        for (auto& page : m_pages)
+        {
+            if (page->buffer == nullptr)
+                continue;
+
+            OffsetAllocator::StorageReport report = page->allocator.storageReport();
+            stats.pages++;
+            stats.capacity   += page->size;
+            stats.used       += page->used;
+            stats.free       += report.totalFreeSpace;
+            stats.largestFree = std::max<size_t>(stats.largestFree, report.largestFreeRegion);
+        }
+        stats.pendingFree = m_pendingBytes;
+        return stats;
+    }
+
+    float BrushGPUAllocator::Fragmentation(uint32_t index) const
+    {
+        const Page& page = *m_pages[index];
+        if (page.buffer == nullptr)
+            return 0.0f;
+
+        OffsetAllocator::StorageReport report = page.allocator.storageReport();
+        return float(report.totalFreeSpace - report.largestFreeRegion) / float(page.size);
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "chisel/map/Common.h"
+#include "render/Render.h"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace chisel
+{
+    /**
+     * Brush storage in GPU vertex buffers, one per page.
+     *
+     * Grows by adding pages instead of failing once a page is full.
+     * Frees are held back until the GPU has finished the frame they were made in,
+     * so a range is never rewritten while a draw might still be reading it.
+     */
+    struct BrushGPUAllocator final : BrushAllocator
+    {
+    public:
+        static constexpr uint32_t PageSize = 64 * 1024 * 1024; // 64 mb
+        static constexpr uint32_t MaxAllocationsPerPage = 65535;
+
+        BrushGPUAllocator(render::RenderContext& rctx);
+        ~BrushGPUAllocator();
+
+        void open() final override;
+        void close() final override;
+        uint8_t* data(uint32_t page) final override;
+
+        Allocation alloc(uint32_t size) final override;
+        void free(Allocation alloc) final override;
+
+        Stats stats() const final override;
+
+        // Call once a frame has been submitted.
+        // Fences the frees made during it, and releases the ones the GPU is done with.
+        void EndFrame();
+
+        render::RenderContext& rctx() const { return m_rctx; }
+
+        ID3D11Buffer* buffer(uint32_t page) const { return m_pages[page]->buffer.ptr(); }
+
+        uint32_t PageCount() const { return uint32_t(m_pages.size()); }
+
+        // Share of a page's space lost in holes: free space that isn't part of its largest free block.
+        float Fragmentation(uint32_t page) const;
+
+        // Stop allocating from a page, so it can be emptied by moving everything out of it.
+        // -1 to allocate from every page again.
+        void SetEvacuating(int32_t page) { m_evacuating = page; }
+        int32_t GetEvacuating() const { return m_evacuating; }
+
+    private:
+        struct Page
+        {
+            Page(uint32_t size)
+                : size(size)
+                , allocator(size, MaxAllocationsPerPage)
+            {}
+
+            uint32_t                   size;
+            OffsetAllocator::Allocator allocator;
+            Com<ID3D11Buffer>          buffer;  // null once released
+            uint8_t*                   mapped = nullptr;
+            size_t                     used = 0;
+        };
+
+        struct PendingFrees
+        {
+            Com<ID3D11Query>        fence;
+            uint64_t                frame;
+            std::vector<Allocation> allocs;
+        };
+
+        bool CreateBuffer(Page& page);
+        void Release(const Allocation& alloc);
+
+        render::RenderContext&           m_rctx;
+        std::vector<std::unique_ptr<Page>> m_pages;
+        int32_t                          m_evacuating = -1;
+        uint32_t                         m_refs = 0;
+
+        std::vector<Allocation>          m_frees;   // Made this frame
+        std::deque<PendingFrees>         m_pending; // Oldest first
+        std::vector<Com<ID3D11Query>>    m_fences;  // Signalled, ready for reuse
+        size_t                           m_pendingBytes = 0;
+        uint64_t                         m_frame = 0;
+    };
+}
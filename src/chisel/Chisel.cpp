@@ -7,6 +7,7 @@
 
 #include "console/Console.h"
 #include "gui/ConsoleWindow.h"
+#include "gui/ProfilerWindow.h"
 #include "gui/AssetPicker.h"
 #include "gui/Layout.h"
 #include "gui/Inspector.h"
@@ -32,7 +33,8 @@ namespace chisel
 
         Engine.Init();
 
-        fgd = new FGD("core/test.fgd");
+        Core.fgd = new FGD("core/test.fgd");
+        Core.map = &map;
         
         tool = Tool::Default;
 
@@ -47,19 +49,34 @@ namespace chisel
         Engine.systems.AddSystem<Inspector>();
         mainAssetPicker = &Engine.systems.AddSystem<AssetPicker>();
         settingsWindow = &Engine.systems.AddSystem<SettingsWindow>();
+        profilerWindow = &Engine.systems.AddSystem<GUI::ProfilerWindow>();
         Engine.systems.AddSystem<Viewport>();
 
         Engine.Loop();
         Engine.Shutdown();
     }
 
+    void Chisel::SetTool(Tool* next)
+    {
+        if (tool == next)
+            return;
+
+        if (tool)
+            tool->OnDeactivate();
+        tool = next;
+    }
+
     Chisel::~Chisel()
     {
-        delete fgd;
+        delete Core.fgd;
     }
 
     void Chisel::Save(std::string_view path)
     {
+        // Only VMF can write back solids outside of the loaded region
+        if (!path.ends_with("vmf"))
+            LoadDormantSolids(map);
+
         if (path.ends_with("vmf"))
             ExportVMF(path, map);
         else if (path.ends_with("box"))
@@ -76,11 +93,11 @@ namespace chisel
         map.Clear();
     }
     
-    bool Chisel::LoadMap(std::string_view path)
+    bool Chisel::LoadMap(std::string_view path, const MapRegion& region)
     {
         if (path.ends_with("vmf"))
         {
-            return ImportVMF(path, map);
+            return ImportVMF(path, map, region);
         } else if (path.ends_with("box"))
         {
             return ImportBox(path, map);
@@ -95,7 +112,7 @@ namespace chisel
         obsolete->origin = vec3(-8, -8, 0);
 
         vec3 origin = vec3(-7, -8, 0);
-        for (auto& [name, cls] : fgd->classes)
+        for (auto& [name, cls] : Core.fgd->classes)
         {
             if (cls.type == FGD::SolidClass || cls.type == FGD::BaseClass)
                 continue;
@@ -118,12 +135,46 @@ namespace chisel::commands
         exit(0);
     });
     
-    static ConCommand open_map("open_map", "Load a map from a file path.", [](ConCmd& cmd)
+    static ConCommand open_map("open_map", "Load a map from a file path, optionally only a region of it.", [](ConCmd& cmd)
     {
-        if (cmd.argc != 1)
-            return Console.Error("Usage: open_map <path>");
+        static constexpr const char* usage = "Usage: open_map <path> [bounds <minx> <miny> <minz> <maxx> <maxy> <maxz>] [visgroup <id>] [entity <classname|targetname>]";
+        if (cmd.argc < 1)
+            return Console.Error(usage);
+
+        MapRegion region;
+        for (uint i = 1; i < cmd.argc; i++)
+        {
+            std::string_view arg = cmd.argv[i];
+            if (arg == "bounds" && i + 6 < cmd.argc)
+            {
+                float coords[6];
+                for (uint j = 0; j < 6; j++)
+                {
+                    auto result = stream::Parse<float>(StringView(cmd.argv[++i]));
+                    if (!result.IsSuccess())
+                        return Console.Error(usage);
+                    coords[j] = *result;
+                }
+                region.bounds = AABB{ vec3(coords[0], coords[1], coords[2]), vec3(coords[3], coords[4], coords[5]) };
+            }
+            else if (arg == "visgroup" && i + 1 < cmd.argc)
+            {
+                auto result = stream::Parse<int>(StringView(cmd.argv[++i]));
+                if (!result.IsSuccess())
+                    return Console.Error(usage);
+                region.visgroup = *result;
+            }
+            else if (arg == "entity" && i + 1 < cmd.argc)
+            {
+                region.entity = cmd.argv[++i];
+            }
+            else
+            {
+                return Console.Error(usage);
+            }
+        }
 
-        if (!Chisel.LoadMap(cmd.argv[0]))
+        if (!Chisel.LoadMap(cmd.argv[0], region))
             Console.Error("Failed to load map '{}'", cmd.argv[0]);
     });
 }
@@ -3,8 +3,9 @@
 #include "chisel/Enums.h"
 #include "chisel/Engine.h"
 
-#include "chisel/Chisel.h"
+#include "chisel/Core.h"
 #include "chisel/map/Map.h"
+#include "chisel/formats/Formats.h"
 
 namespace chisel
 {
@@ -14,21 +15,16 @@ namespace chisel
     inline class Chisel
     {
     public:
-    // Game Data //
-        class FGD* fgd;
-
     // Editing //
         // TODO: Multiple maps.
         Map map;
 
         Tool*       tool;
+        void SetTool(Tool* next);
         Space       transformSpace = Space::World;
-        SelectMode  selectMode     = SelectMode::Groups;
 
         Rc<Material> activeMaterial   = nullptr;
 
-        std::unique_ptr<BrushGPUAllocator> brushAllocator;
-
         /*
         uint GetSelectionID(VMF::MapEntity& ent, VMF::Solid& solid)
         {
@@ -48,7 +44,7 @@ namespace chisel
         bool HasUnsavedChanges() { return !map.Empty(); }
         void Save(std::string_view path);
         void CloseMap();
-        bool LoadMap(std::string_view path);
+        bool LoadMap(std::string_view path, const MapRegion& region = {});
         void CreateEntityGallery();
 
     // Systems //
@@ -58,6 +54,7 @@ namespace chisel
         GUI::Window* console;
         GUI::Window* mainAssetPicker;
         GUI::Window* settingsWindow;
+        GUI::Window* profilerWindow;
 
     // Chisel Engine Loop //
 
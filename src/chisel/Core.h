@@ -0,0 +1,44 @@
+#pragma once
+
+#include "chisel/Enums.h"
+#include "chisel/map/Common.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace chisel
+{
+    class Map;
+    class FGD;
+
+    /**
+     * State shared by the map core (map, formats, CSG).
+     * Doesn't depend on the editor, a window or a GPU,
+     * so the core can run headless with a NullBrushAllocator.
+     */
+    inline struct Core
+    {
+    // Game Data //
+        FGD* fgd = nullptr;
+
+    // Editing //
+        // The map currently being edited, if any.
+        Map* map = nullptr;
+
+        SelectMode selectMode = SelectMode::Groups;
+
+    // Brush Storage //
+        std::unique_ptr<BrushAllocator> brushAllocator;
+
+        // Whether the renderer has shaders for VertexSolidPacked, see r_brush_packed_vertices.
+        bool packedBrushShaders = true;
+
+    // Redrawing //
+        // Bumped by anything that changes how the map looks: meshes, selection, entities, assets.
+        // Views compare it with the one they last drew to tell if they need to draw again.
+        std::atomic<uint64_t> sceneRevision = 0;
+
+        void SceneChanged() { sceneRevision.fetch_add(1, std::memory_order_relaxed); }
+    } Core;
+}
@@ -1,9 +1,14 @@
 
 #include "Engine.h"
 #include "common/Time.h"
+#include "common/Profiler.h"
 #include "chisel/Gizmos.h"
 #include "chisel/Handles.h"
 #include "chisel/Selection.h"
+#include "chisel/Core.h"
+#include "console/ConVar.h"
+#include "input/Keyboard.h"
+#include "input/Mouse.h"
 #include "gui/Common.h"
 #include "assets/Assets.h"
 #include "core/Primitives.h"
@@ -16,6 +21,12 @@ namespace chisel
     static render::RenderContext& rctx = Engine.rctx;
     static render::RenderContext& r = Engine.rctx;
 
+    static ConVar<bool>  r_idle_wait("r_idle_wait", true, "Sleep until the next input event when nothing has changed for a few frames.");
+    static ConVar<float> r_idle_timeout("r_idle_timeout", 0.5f, "Longest to sleep while idle, in seconds, so tooltips and text carets still update.");
+
+    // Frames drawn after the last change before sleeping, for ImGui to settle hover and layout.
+    static constexpr uint IdleFrames = 3;
+
     void Engine::Init()
     {
         // Create window
@@ -43,8 +54,22 @@ namespace chisel
         Time::Seconds lastTime    = Time::GetTime();
         Time::Seconds accumulator = 0;
 
+        uint awakeFrames = IdleFrames;
+
         while (!window->ShouldClose())
         {
+            if (awakeFrames == 0 && r_idle_wait)
+            {
+                PROFILE_SCOPE("Engine::Wait");
+                window->WaitForEvents(r_idle_timeout);
+
+                // Don't run fixed updates for the time spent asleep.
+                lastTime = Time::GetTime();
+            }
+
+            Profiler.BeginFrame();
+            PROFILE_SCOPE("Engine::Frame");
+
             auto currentTime = Time::GetTime();
             auto deltaTime   = currentTime - lastTime;
             lastTime = currentTime;
@@ -58,6 +83,8 @@ namespace chisel
 
             while (accumulator >= Time.fixed.deltaTime)
             {
+                PROFILE_SCOPE("Engine::Tick");
+
                 // Perform fixed updates
                 systems.Tick();
 
@@ -69,29 +96,69 @@ namespace chisel
             // Amount to lerp between physics steps
             [[maybe_unused]] double alpha = accumulator / Time.fixed.deltaTime;
 
-            // Clear buffered input
-            Input.Update();
+            {
+                PROFILE_SCOPE("Engine::Input");
+
+                // Clear buffered input
+                Input.Update();
+
+                // Process input
+                window->PreUpdate();
+            }
 
-            // Process input
-            window->PreUpdate();
+            {
+                PROFILE_SCOPE("Engine::BeginFrame");
 
-            // Setup to render
-            rctx.BeginFrame();
+                // Setup to render
+                rctx.BeginFrame();
+            }
 
-            // Perform system updates
-            systems.Update();
+            {
+                PROFILE_SCOPE("Engine::Update");
 
-            // Finish rendering
-            rctx.EndFrame();
-            OnEndFrame(rctx);
-            
-            // Present to non-main windows
-            GUI::Present();
+                // Perform system updates
+                systems.Update();
+            }
+
+            {
+                PROFILE_SCOPE("Engine::Render");
+
+                // Submit what systems recorded
+                OnRender(rctx);
+            }
+
+            // Anything bumping it from here on was after this frame's viewports were drawn.
+            uint64_t drawnRevision = Core.sceneRevision.load(std::memory_order_relaxed);
+
+            {
+                PROFILE_SCOPE("Engine::EndFrame");
+
+                // Finish rendering
+                rctx.EndFrame();
+                OnEndFrame(rctx);
+            }
+
+            {
+                PROFILE_SCOPE("Engine::Present");
+
+                // Present to non-main windows
+                GUI::Present();
+
+                // Present to main window
+                window->Update();
+            }
 
-            // Present to main window
-            window->Update();
+            // Stay awake while there's input to handle, something held down, changes not yet drawn,
+            // or anything asking for another frame with StayAwake.
+            bool active = window->eventCount > 0
+                || Keyboard.AnyKeyHeld() || Mouse.AnyButtonHeld()
+                || Core.sceneRevision.load(std::memory_order_relaxed) != drawnRevision
+                || stayAwake;
+            stayAwake = false;
+            awakeFrames = active ? IdleFrames : (awakeFrames > 0 ? awakeFrames - 1 : 0);
 
             Time.frameCount++;
+            Profiler.EndFrame();
         }
     }
 
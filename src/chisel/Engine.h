@@ -24,6 +24,8 @@ namespace chisel
         SystemGroup systems;
         render::RenderContext rctx;
 
+        // After systems have updated, before the UI is drawn over everything. For submitting what they recorded.
+        Event<render::RenderContext&> OnRender;
         Event<render::RenderContext&> OnEndFrame;
 
     public:
@@ -39,7 +41,11 @@ namespace chisel
         void Loop();
         void Shutdown();
 
+        // Don't go idle after this frame, for changes that come without input or a scene change.
+        void StayAwake() { stayAwake = true; }
+
     private:
+        bool stayAwake = false;
 
     } Engine;
 }
\ No newline at end of file
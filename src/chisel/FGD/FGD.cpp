@@ -373,6 +373,46 @@ namespace chisel
         }
     };
 
+    kv::KeyValuesType FGD::Var::ValueType() const
+    {
+        switch (type)
+        {
+            case Integer:
+            case Boolean:
+            case Flags:
+            case NodeID:
+                return kv::Types::Int;
+            case Choices:
+                return intChoices ? kv::Types::Int : kv::Types::String;
+            case Float:
+                return kv::Types::Float;
+            case Angle:
+            case AngleLocal:
+            case AngleNegativePitch:
+            case Vector:
+            case Origin:
+            case VecLine:
+                return kv::Types::Vector3;
+            case Color255:
+            case Color1:
+                return kv::Types::Vector4;
+            default:
+                return kv::Types::String;
+        }
+    }
+
+    kv::KeyValuesVariant FGD::Var::Parse(std::string_view text) const
+    {
+        // "255 255 255" is an opaque color.
+        float fill = 0.0f;
+        if (type == Color255)
+            fill = 255.0f;
+        else if (type == Color1)
+            fill = 1.0f;
+
+        return kv::KeyValuesVariant::Parse(text, ValueType(), fill);
+    }
+
     FGD::FGD(const char* path) : path(path)
     {
         auto str = ReadFGDFile(path);
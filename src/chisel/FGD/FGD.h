@@ -8,6 +8,7 @@
 #include "math/Math.h"
 #include "render/Render.h"
 #include "core/Mesh.h"
+#include "formats/KeyValues.h"
 
 namespace chisel
 {
@@ -127,6 +128,11 @@ namespace chisel
             bool readOnly = false;
             bool intChoices = false;
             List<std::pair<std::string, std::string>> choices;
+
+            // How values of this var are stored once parsed.
+            kv::KeyValuesType ValueType() const;
+            // Parses text (from a map, the default value or an edit) as this var's type.
+            kv::KeyValuesVariant Parse(std::string_view text) const;
         };
 
         struct InputOutput : Base
@@ -1,45 +1,99 @@
 #include "Gizmos.h"
 #include "glm/ext/matrix_transform.hpp"
 #include "chisel/Engine.h"
-#include "render/CBuffers.h"
+#include "console/ConCommand.h"
 #include "core/Primitives.h"
+#include "render/CBuffers.h"
+#include <algorithm>
+#include <string>
 #include <vector>
-#include <glm/gtx/vector_angle.hpp>
 #include "math/Winding.h"
 #include "map/Common.h"
+#include "chisel/Chisel.h"
 #include "chisel/MapRender.h"
 
 namespace chisel
 {
     render::RenderContext& Gizmos::r = Engine.rctx;
 
+    static ConCommand gizmo_stats("gizmo_stats", "Print how many draws gizmos took last frame.", []()
+    {
+        const Gizmos::Stats& stats = Gizmos::GetStats();
+        Console.Log("Gizmos: {} drawn in {} batches, {} draws ({} saved)",
+            stats.calls, stats.batches, stats.draws, stats.calls - std::min(stats.calls, stats.draws));
+
+        if (Gizmos::sh_ColorBatched.inputLayout == nullptr || !Gizmos::sh_Sprite.IsBatched())
+            Console.Log("  The batched gizmo shaders aren't compiled, so gizmos are drawn one at a time. Run shaders/build.bat.");
+    });
+
     void Gizmos::Init()
     {
         icnObsolete = Assets.Load<Texture>("textures/ui/obsolete.png");
         icnHandle   = Assets.Load<Texture>("textures/ui/handle.png");
-        sh_Color    = render::Shader(Engine.rctx.device.ptr(), Primitives::Vertex::Layout, "color");
-        sh_Sprite   = render::Shader(Engine.rctx.device.ptr(), Primitives::Vertex::Layout, "sprite");
+        sh_Color    = render::Shader(Engine.rctx.device.ptr(), Vertex::Layout, "color");
+        sh_Sprite   = LoadSpriteShader("sprite");
+        if (render::Shader::Exists("color_batched"))
+            sh_ColorBatched = render::Shader(Engine.rctx.device.ptr(), Vertex::Layout, "color_batched");
+
+        Engine.OnEndFrame += [](render::RenderContext&)
+        {
+            // Drawn outside of any pass, there's nothing to flush them to.
+            for (size_t i = 0; i < s_used; i++)
+            {
+                s_batches[i].vertices.clear();
+                s_batches[i].sprites.clear();
+            }
+            s_used = 0;
+            s_calls = 0;
+
+            std::lock_guard lock(s_statsMutex);
+            s_lastFrame = s_frame;
+            s_frame = Stats{};
+        };
+    }
+
+    Gizmos::SpriteShader Gizmos::LoadSpriteShader(std::string_view name)
+    {
+        SpriteShader shader;
+        shader.single = render::Shader(Engine.rctx.device.ptr(), Primitives::Vertex::Layout, name);
+
+        std::string batched = std::string(name) + "_batched";
+        if (render::Shader::Exists(batched))
+            shader.batched = render::Shader(Engine.rctx.device.ptr(), Sprite::Layout, batched);
+        return shader;
+    }
+
+    Gizmos::Batch& Gizmos::GetBatch(Topology topology, Texture* texture, const SpriteShader* shader)
+    {
+        bool selectable = id != 0;
+        bool point = topology == Topology::Sprites && pointSample;
+
+        for (size_t i = 0; i < s_used; i++)
+        {
+            Batch& batch = s_batches[i];
+            if (batch.topology == topology && batch.depthTest == depthTest && batch.selectable == selectable
+                && batch.pointSample == point && batch.texture == texture && batch.shader == shader)
+                return batch;
+        }
+
+        // Keep old batches around, so their vectors keep their capacity.
+        if (s_used == s_batches.size())
+            s_batches.emplace_back();
+
+        Batch& batch = s_batches[s_used++];
+        batch.topology    = topology;
+        batch.depthTest   = depthTest;
+        batch.selectable  = selectable;
+        batch.pointSample = point;
+        batch.texture     = texture;
+        batch.shader      = shader;
+        return batch;
     }
 
-    void Gizmos::DrawIcon(vec3 pos, Texture* icon, vec3 size, const render::Shader& shader)
+    void Gizmos::DrawIcon(vec3 pos, Texture* icon, vec3 size, const SpriteShader& shader)
     {
-        PreDraw();
-        r.SetShader(shader);
-        r.ctx->PSSetShaderResources(0, 1, &icon->srvSRGB);
-
-        cbuffers::ObjectState data;
-        data.model = glm::scale(glm::translate(mat4x4(1.0f), pos), size);
-        data.color = color;
-        data.id = id;
-        r.UploadConstBuffer(1, r.cbuffers.object, data);
-        
-        uint stride = sizeof(Primitives::Vertex);
-        uint offset = 0;
-        r.ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        r.ctx->IASetVertexBuffers(0, 1, &Primitives.Quad, &stride, &offset);
-        r.ctx->Draw(6, 0);
-
-        PostDraw();
+        s_calls++;
+        GetBatch(Topology::Sprites, icon, &shader).sprites.push_back(Sprite{ pos, size, color, id });
     }
 
     void Gizmos::DrawPoint(vec3 pos, float scale)
@@ -55,32 +109,12 @@ namespace chisel
         DrawIcon(pos, icnHandle.ptr(), vec3(scale));
     }
 
-    // TODO: These should be batched.
     void Gizmos::DrawLine(vec3 start, vec3 end)
     {
-        PreDraw();
-        r.SetShader(sh_Color);
-
-        mat4x4 mtx = glm::translate(mat4x4(1), start);
-        mtx = glm::rotate(mtx, glm::orientedAngle(glm::vec3(1, 0, 0), glm::normalize(end - start), Vectors.Up), glm::vec3(0, 0, 1));
-        mtx = glm::scale(mtx, glm::vec3(glm::distance(start, end), 1.0f, 1.0f));
-
-        cbuffers::ObjectState data;
-        data.model = mtx;
-        data.color = color;
-        data.id = 0;
-        r.UploadConstBuffer(1, r.cbuffers.object, data);
-
-        uint stride = sizeof(Primitives::Vertex);
-        uint offset = 0;
-        r.ctx->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
-        r.ctx->IASetVertexBuffers(0, 1, &Primitives.Line, &stride, &offset);
-        r.SetRasterState(r.Raster.SmoothLines.ptr());
-        r.ctx->Draw(2, 0);
-
-        r.SetRasterState(r.Raster.Default.ptr());
-        r.ctx->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        PostDraw();
+        s_calls++;
+        auto& vertices = GetBatch(Topology::Lines).vertices;
+        vertices.push_back(Vertex{ start, vec3(0.0f), color, 0 });
+        vertices.push_back(Vertex{ end,   vec3(0.0f), color, 0 });
     }
 
     void Gizmos::DrawPlane(const Plane& plane, bool backFace)
@@ -89,40 +123,16 @@ namespace chisel
         if (!PlaneWinding::CreateFromPlane(plane, winding))
             return;
 
-        PreDraw();
-
-        r.SetShader(sh_Color);
+        s_calls++;
+        auto& vertices = GetBatch(Topology::Triangles).vertices;
 
-        cbuffers::ObjectState data;
-        data.model = glm::identity<mat4x4>();
-        data.color = color;
-        data.id = 0;
-
-        Primitives::Vertex vertices[6];
-        vertices[0].pos = winding.points[backFace ? 2 : 0];
-        vertices[0].uv = vec2(0.0f);
-        vertices[1].pos = winding.points[1];
-        vertices[1].uv = vec2(0.0f);
-        vertices[2].pos = winding.points[backFace ? 0 : 2];
-        vertices[2].uv = vec2(0.0f);
-        vertices[3].pos = winding.points[backFace ? 3 : 0];
-        vertices[3].uv = vec2(0.0f);
-        vertices[4].pos = winding.points[2];
-        vertices[4].uv = vec2(0.0f);
-        vertices[5].pos = winding.points[backFace ? 0 : 3];
-        vertices[5].uv = vec2(0.0f);
-
-        ID3D11Buffer* buffer = r.scratchVertex.ptr();
-
-        r.UpdateDynamicBuffer(buffer, vertices, sizeof(vertices));
-        r.UploadConstBuffer(1, r.cbuffers.object, data);
-
-        uint stride = sizeof(Primitives::Vertex);
-        uint offset = 0;
-        r.ctx->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
-        r.ctx->Draw(6, 0);
-
-        PostDraw();
+        const uint32_t Indices[2][6] =
+        {
+            { 0, 1, 2, 0, 2, 3 },
+            { 2, 1, 0, 3, 2, 0 },
+        };
+        for (uint32_t i : Indices[backFace])
+            vertices.push_back(Vertex{ winding.points[i], vec3(0.0f), color, 0 });
     }
 
     void Gizmos::DrawAABB(const AABB& aabb)
@@ -133,7 +143,6 @@ namespace chisel
 
     void Gizmos::DrawBox(std::span<vec3, 8> corners)
     {
-        PreDraw();
         static constexpr std::array<std::array<uint32_t, 4>, 8> CornerIndices =
         {{
             { 5,4,6,7 },
@@ -144,13 +153,9 @@ namespace chisel
             { 2,6,4,0 },
         }};
 
-        r.SetShader(Chisel.Renderer->Shaders.Brush);
+        s_calls++;
+        auto& vertices = GetBatch(Topology::TrianglesBiased).vertices;
 
-        cbuffers::BrushState data;
-        data.color = this->color;
-        data.id = this->id;
-
-        VertexSolid vertices[6 * 6];
         for (uint32_t i = 0; i < 6; i++)
         {
             vec3 v0 = corners[CornerIndices[i][0]];
@@ -158,30 +163,16 @@ namespace chisel
             vec3 v2 = corners[CornerIndices[i][2]];
             vec3 v3 = corners[CornerIndices[i][3]];
 
+            // Lit like a brush
             vec3 normal = Plane::NormalFromPoints(v0, v1, v2);
 
-            vertices[6 * i + 0] = { v0, normal };
-            vertices[6 * i + 1] = { v1, normal };
-            vertices[6 * i + 2] = { v2, normal };
-            vertices[6 * i + 3] = { v0, normal };
-            vertices[6 * i + 4] = { v2, normal };
-            vertices[6 * i + 5] = { v3, normal };
+            vertices.push_back(Vertex{ v0, normal, color, id });
+            vertices.push_back(Vertex{ v1, normal, color, id });
+            vertices.push_back(Vertex{ v2, normal, color, id });
+            vertices.push_back(Vertex{ v0, normal, color, id });
+            vertices.push_back(Vertex{ v2, normal, color, id });
+            vertices.push_back(Vertex{ v3, normal, color, id });
         }
-
-        ID3D11Buffer* buffer = r.scratchVertex.ptr();
-
-        r.SetRasterState(r.Raster.DepthBiased.ptr());
-        r.UpdateDynamicBuffer(buffer, vertices, sizeof(vertices));
-        r.UploadConstBuffer(1, r.cbuffers.brush, data);
-        r.ctx->PSSetShaderResources(0, 1, &Chisel.Renderer->Textures.White->srvSRGB);
-
-        uint stride = sizeof(VertexSolid);
-        uint offset = 0;
-        r.ctx->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
-        r.ctx->Draw(6 * 6, 0);
-
-        r.SetRasterState(r.Raster.Default.ptr());
-        PostDraw();
     }
 
     void Gizmos::DrawBox(vec3 origin, float radius)
@@ -208,8 +199,6 @@ namespace chisel
 
     void Gizmos::DrawWireBox(std::span<vec3, 8> corners)
     {
-        // TODO: Use batched DrawLine instead of this nonsense
-        PreDraw();
         static constexpr std::array<uint, 24> CornerIndices =
         {{
             0, 1,
@@ -229,35 +218,11 @@ namespace chisel
             2, 6,
         }};
 
-        r.SetShader(sh_Color);
-
-        cbuffers::ObjectState data;
-        data.model = glm::identity<mat4x4>();
-        data.color = color;
-        data.id = 0;
+        s_calls++;
+        auto& vertices = GetBatch(Topology::Lines).vertices;
 
-        Primitives::Vertex vertices[24];
         for (uint32_t i = 0; i < 24; i++)
-        {
-            vertices[i] = { corners[CornerIndices[i]], vec2(0.0f) };
-        }
-
-        ID3D11Buffer* buffer = r.scratchVertex.ptr();
-
-        r.SetRasterState(r.Raster.SmoothLines.ptr());
-        
-        r.UpdateDynamicBuffer(buffer, vertices, sizeof(vertices));
-        r.UploadConstBuffer(1, r.cbuffers.object, data);
-
-        uint stride = sizeof(Primitives::Vertex);
-        uint offset = 0;
-        r.ctx->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
-        r.ctx->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
-        r.ctx->Draw(24, 0);
-
-        r.SetRasterState(r.Raster.Default.ptr());
-        r.ctx->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        PostDraw();
+            vertices.push_back(Vertex{ corners[CornerIndices[i]], vec3(0.0f), color, 0 });
     }
 
     void Gizmos::Reset()
@@ -265,21 +230,215 @@ namespace chisel
         struct Gizmos g;
         *this = g;
     }
-    
-    void Gizmos::PreDraw()
+
+    void Gizmos::SetState(render::CommandList& cmd, const Batch& batch, bool batched)
     {
-        r.SetDepthStencilState(depthTest ? r.Depth.Default.ptr() : r.Depth.Ignore.ptr());
+        cmd.SetDepthStencilState(batch.depthTest ? r.Depth.Default : r.Depth.Ignore);
 
-        if (id == 0)
-            r.SetBlendState(render::BlendFuncs::AlphaNoSelection);
+        if (batch.selectable)
+            cmd.SetBlendState(render::BlendFuncs::Alpha);
         else
-            r.SetBlendState(render::BlendFuncs::Alpha);
+            cmd.SetBlendState(render::BlendFuncs::AlphaNoSelection);
+
+        switch (batch.topology)
+        {
+            case Topology::Lines:
+                cmd.SetRasterState(r.Raster.SmoothLines);
+                cmd.SetTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+                cmd.SetShader(batched ? sh_ColorBatched : sh_Color);
+                break;
+
+            case Topology::Triangles:
+            case Topology::TrianglesBiased:
+                cmd.SetRasterState(batch.topology == Topology::TrianglesBiased ? r.Raster.DepthBiased : r.Raster.Default);
+                cmd.SetTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+                cmd.SetShader(batched ? sh_ColorBatched : sh_Color);
+                break;
+
+            case Topology::Sprites:
+                cmd.SetRasterState(r.Raster.Default);
+                cmd.SetTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+                cmd.SetShader(batched ? batch.shader->batched : batch.shader->single);
+                cmd.SetSampler(0, batch.pointSample ? r.Sample.Point : r.Sample.Default);
+                cmd.SetShaderResource(0, batch.texture->srvSRGB.ptr());
+                break;
+        }
+    }
+
+    uint32_t Gizmos::DrawSingle(render::CommandList& cmd, const Batch& batch, uint vertexOffset)
+    {
+        SetState(cmd, batch, false);
+
+        cbuffers::ObjectState data = {};
+        uint32_t draws = 0;
+
+        if (batch.topology == Topology::Sprites)
+        {
+            cmd.SetVertexBuffer(0, Primitives.Quad.ptr(), sizeof(Primitives::Vertex));
+            for (const Sprite& sprite : batch.sprites)
+            {
+                data.model = glm::scale(glm::translate(mat4x4(1.0f), sprite.origin), sprite.size);
+                data.color = sprite.color;
+                data.id    = sprite.id;
+                cmd.UploadConstBuffer(1, r.cbuffers.object, data);
+                cmd.Draw(6);
+                draws++;
+            }
+            return draws;
+        }
+
+        // Every gizmo's vertices share its color and ID, so draw each run of them.
+        // The older color shader is unlit, so lit runs (boxes) go through the brush shader as before batching.
+        const std::vector<Vertex>& vertices = batch.vertices;
+        data.model = glm::identity<mat4x4>();
+        cmd.SetUploadVertexBuffer(0, sizeof(Vertex), vertexOffset);
+        for (size_t start = 0, end; start < vertices.size(); start = end)
+        {
+            const bool lit = vertices[start].normal != vec3(0.0f);
+            for (end = start + 1; end < vertices.size(); end++)
+            {
+                if (vertices[end].color != vertices[start].color || vertices[end].id != vertices[start].id
+                    || (vertices[end].normal != vec3(0.0f)) != lit)
+                    break;
+            }
+
+            if (lit)
+            {
+                uint offset = 0;
+                auto* solid = (VertexSolid*)cmd.Upload(uint(end - start) * sizeof(VertexSolid), offset);
+                for (size_t i = start; i < end; i++)
+                    solid[i - start] = VertexSolid{ vertices[i].pos, vertices[i].normal, vec3(0.0f), 0 };
+
+                cbuffers::BrushState brush = {};
+                brush.color = vertices[start].color;
+                brush.id    = vertices[start].id;
+
+                cmd.SetShader(Chisel.Renderer->Shaders.Brush);
+                cmd.SetShaderResource(0, Chisel.Renderer->Textures.White->srvSRGB.ptr());
+                cmd.SetSampler(0, r.Sample.Default);
+                cmd.UploadConstBuffer(1, r.cbuffers.brush, brush);
+                cmd.SetUploadVertexBuffer(0, sizeof(VertexSolid), offset);
+                cmd.Draw(uint(end - start));
+
+                cmd.SetShader(sh_Color);
+                cmd.SetUploadVertexBuffer(0, sizeof(Vertex), vertexOffset);
+            }
+            else
+            {
+                data.color = vertices[start].color;
+                data.id    = vertices[start].id;
+                cmd.UploadConstBuffer(1, r.cbuffers.object, data);
+                cmd.Draw(uint(end - start), batch.first + uint(start));
+            }
+            draws++;
+        }
+        return draws;
     }
 
-    void Gizmos::PostDraw()
+    void Gizmos::Flush(render::CommandList& cmd)
     {
-        r.SetDepthStencilState(r.Depth.Default.ptr());
+        uint32_t calls = s_calls;
+        s_calls = 0;
+
+        if (s_used == 0)
+            return;
+
+        std::span<Batch> batches(s_batches.data(), s_used);
 
-        r.SetBlendState(render::BlendFuncs::Normal);
+        // Everything goes in one upload range per kind: vertices for lines and triangles, instances for sprites.
+        uint32_t vertexCount = 0;
+        uint32_t spriteCount = 0;
+        for (Batch& batch : batches)
+        {
+            if (batch.topology == Topology::Sprites)
+            {
+                batch.first = spriteCount;
+                spriteCount += uint32_t(batch.sprites.size());
+            }
+            else
+            {
+                batch.first = vertexCount;
+                vertexCount += uint32_t(batch.vertices.size());
+            }
+        }
+
+        uint vertexOffset = 0;
+        if (vertexCount != 0)
+        {
+            auto* data = (Vertex*)cmd.Upload(vertexCount * sizeof(Vertex), vertexOffset);
+            for (const Batch& batch : batches)
+            {
+                if (batch.topology != Topology::Sprites)
+                    std::copy(batch.vertices.begin(), batch.vertices.end(), data + batch.first);
+            }
+        }
+
+        uint spriteOffset = 0;
+        if (spriteCount != 0)
+        {
+            auto* data = (Sprite*)cmd.Upload(spriteCount * sizeof(Sprite), spriteOffset);
+            for (const Batch& batch : batches)
+            {
+                if (batch.topology == Topology::Sprites)
+                    std::copy(batch.sprites.begin(), batch.sprites.end(), data + batch.first);
+            }
+        }
+
+        uint32_t draws = 0;
+        for (const Batch& batch : batches)
+        {
+            if (batch.topology == Topology::Sprites)
+            {
+                if (batch.sprites.empty() || !batch.texture)
+                    continue;
+
+                if (!batch.shader->IsBatched())
+                {
+                    draws += DrawSingle(cmd, batch, vertexOffset);
+                    continue;
+                }
+
+                SetState(cmd, batch, true);
+                cmd.SetVertexBuffer(0, Primitives.Quad.ptr(), sizeof(Primitives::Vertex));
+                cmd.SetUploadVertexBuffer(1, sizeof(Sprite), spriteOffset);
+                cmd.DrawInstanced(6, uint(batch.sprites.size()), 0, batch.first);
+            }
+            else
+            {
+                if (batch.vertices.empty())
+                    continue;
+
+                if (sh_ColorBatched.inputLayout == nullptr)
+                {
+                    draws += DrawSingle(cmd, batch, vertexOffset);
+                    continue;
+                }
+
+                SetState(cmd, batch, true);
+                cmd.SetUploadVertexBuffer(0, sizeof(Vertex), vertexOffset);
+                cmd.Draw(uint(batch.vertices.size()), batch.first);
+            }
+            draws++;
+        }
+
+        cmd.SetDepthStencilState(r.Depth.Default);
+        cmd.SetBlendState(render::BlendFuncs::Normal);
+        cmd.SetRasterState(r.Raster.Default);
+        cmd.SetSampler(0, r.Sample.Default);
+        cmd.SetTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        {
+            std::lock_guard lock(s_statsMutex);
+            s_frame.calls   += calls;
+            s_frame.draws   += draws;
+            s_frame.batches += uint32_t(s_used);
+        }
+
+        for (Batch& batch : batches)
+        {
+            batch.vertices.clear();
+            batch.sprites.clear();
+        }
+        s_used = 0;
     }
 }
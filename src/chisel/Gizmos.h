@@ -2,30 +2,106 @@
 
 #include "assets/Assets.h"
 #include "render/Render.h"
+#include "render/CommandList.h"
 #include "math/Math.h"
 #include "Selection.h"
 #include "math/Plane.h"
 
+#include <mutex>
 #include <span>
+#include <string_view>
+#include <vector>
 
 namespace chisel
 {
+    /**
+     * Immediate mode drawing for editor helpers: icons, lines, planes and boxes.
+     *
+     * Nothing is drawn straight away. Each call appends to a batch for its state
+     * (shader, texture, depth test, ...), and Flush records every batch into a command list at once,
+     * lines and triangles from one vertex range and icons as instanced quads.
+     * Flush at the end of every pass that draws gizmos, into the list that binds its camera and targets.
+     *
+     * Batches are per thread, so viewports recorded in parallel each get their own.
+     * Draw from a local Gizmo on other threads rather than changing the shared one's state.
+     *
+     * Batching needs the *_batched shaders. Until shaders/build.bat has compiled them,
+     * Flush draws each gizmo on its own with the older shaders instead.
+     */
     inline struct Gizmos
     {
+        // Lines and triangles, already in world space
+        struct Vertex
+        {
+            vec3     pos;
+            vec3     normal; // Zero for unlit
+            vec4     color;
+            uint32_t id;
+
+            static constexpr D3D11_INPUT_ELEMENT_DESC Layout[] =
+            {
+                { "POSITION",      0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 0,                            D3D11_INPUT_PER_VERTEX_DATA, 0 },
+                { "NORMAL",        0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+                { "COLOR",         0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+                { "BLENDINDICES",  0, DXGI_FORMAT_R32_UINT,           0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            };
+        };
+
+        // One per icon, drawn over Primitives.Quad
+        struct Sprite
+        {
+            vec3     origin;
+            vec3     size;
+            vec4     color;
+            uint32_t id;
+
+            // Slot 0 is the quad, a Primitives::Vertex.
+            static constexpr D3D11_INPUT_ELEMENT_DESC Layout[] =
+            {
+                { "POSITION",      0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 0,                            D3D11_INPUT_PER_VERTEX_DATA,   0 },
+                { "TEXCOORD",      0, DXGI_FORMAT_R32G32_FLOAT,       0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+                { "TEXCOORD",      1, DXGI_FORMAT_R32G32B32_FLOAT,    1, 0,                            D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "TEXCOORD",      2, DXGI_FORMAT_R32G32B32_FLOAT,    1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "COLOR",         0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "BLENDINDICES",  0, DXGI_FORMAT_R32_UINT,           1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            };
+        };
+
+        // A sprite shader, and the batched version of it if that's been compiled.
+        struct SpriteShader
+        {
+            render::Shader single;  // Primitives::Vertex, one sprite per draw through the object cbuffer
+            render::Shader batched; // Sprite::Layout, instanced
+
+            bool IsBatched() const { return batched.inputLayout != nullptr; }
+        };
+
+        // Loads name, and name_batched if it exists.
+        static SpriteShader LoadSpriteShader(std::string_view name);
+
+        struct Stats
+        {
+            uint32_t calls   = 0; // Draw* calls
+            uint32_t draws   = 0; // What they were flushed as
+            uint32_t batches = 0;
+        };
+
         static inline Rc<Texture> icnObsolete;
         static inline Rc<Texture> icnHandle;
-        static inline render::Shader sh_Sprite;
+        static inline SpriteShader   sh_Sprite;
         static inline render::Shader sh_Color;
+        static inline render::Shader sh_ColorBatched;
 
-        Color color    = Colors.White;
-        bool depthTest = true;
-        SelectionID id = 0;
+        Color color      = Colors.White;
+        bool depthTest   = true;
+        bool pointSample = false; // For icons, so pixel art stays sharp
+        SelectionID id   = 0;
 
         // To manage scope: Gizmo g; g.color = ...; g.DrawLine(...);
         Gizmos() {}
         void Reset();
 
-        void DrawIcon(vec3 pos, Texture* icon, vec3 size = vec3(32.0f), const render::Shader& shader = sh_Sprite);
+        void DrawIcon(vec3 pos, Texture* icon, vec3 size = vec3(32.0f), const SpriteShader& shader = sh_Sprite);
         void DrawPoint(vec3 pos, float scale = -1.f); // scale by default is based on grid size
         void DrawLine(vec3 start, vec3 end);
         void DrawPlane(const Plane& plane, bool backFace = true);
@@ -35,13 +111,59 @@ namespace chisel
         void DrawAABB(const AABB& aabb);
         void DrawWireAABB(const AABB& aabb);
 
+        // Records everything this thread batched since the last flush.
+        static void Flush(render::CommandList& cmd);
+
+        // Totals for the last frame.
+        static const Stats& GetStats() { return s_lastFrame; }
+
         static void Init();
     protected:
-        void PreDraw();
-        void PostDraw();
+        enum class Topology : uint8_t
+        {
+            Lines,
+            Triangles,
+            TrianglesBiased, // Pulled in front of coplanar faces
+            Sprites,
+        };
+
+        struct Batch
+        {
+            Topology              topology = Topology::Triangles;
+            bool                  depthTest = true;
+            bool                  selectable = false; // Writes its ID to the selection target
+            bool                  pointSample = false;
+            Texture*              texture = nullptr;  // Sprites only
+            const SpriteShader*   shader = nullptr;   // Sprites only
+
+            uint32_t              first = 0; // Into the buffer, set by Flush
+
+            std::vector<Vertex>   vertices;
+            std::vector<Sprite>   sprites;
+        };
+
+        // The batch for this topology and the current state, starting one if there isn't one yet.
+        Batch& GetBatch(Topology topology, Texture* texture = nullptr, const SpriteShader* shader = nullptr);
+
+        static void SetState(render::CommandList& cmd, const Batch& batch, bool batched);
+        // Without the batched shaders, a draw for each run of vertices or sprite.
+        static uint32_t DrawSingle(render::CommandList& cmd, const Batch& batch, uint vertexOffset);
+
+        // Reused every flush, in the order they were first drawn to.
+        static inline thread_local std::vector<Batch> s_batches;
+        static inline thread_local size_t             s_used = 0;
+        static inline thread_local uint32_t           s_calls = 0; // Since the last flush
+
+        // Added to by every thread's flushes
+        static inline std::mutex         s_statsMutex;
+        static inline Stats              s_frame;
+        static inline Stats              s_lastFrame;
 
         static render::RenderContext& r;
     } Gizmos;
 
+    static_assert(sizeof(Gizmos::Vertex) == sizeof(float) * 11);
+    static_assert(sizeof(Gizmos::Sprite) == sizeof(float) * 11);
+
     using Gizmo = struct Gizmos;
-}
\ No newline at end of file
+}
@@ -163,14 +163,14 @@ namespace chisel
     //  Grid
     //--------------------------------------------------
 
-    void Handles::DrawGrid(Camera& camera, vec3 gridSize)
+    void Handles::DrawGrid(render::CommandList& cmd, Camera& camera, vec3 gridSize)
     {
         auto& r = Engine.rctx;
-        r.SetBlendState(render::BlendFuncs::Alpha);
-        r.SetDepthStencilState(r.Depth.LessEqual.ptr());
-        r.ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
-        r.SetRasterState(r.Raster.SmoothLines.ptr());
-        r.SetShader(sh_Grid);
+        cmd.SetBlendState(render::BlendFuncs::Alpha);
+        cmd.SetDepthStencilState(r.Depth.LessEqual);
+        cmd.SetTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+        cmd.SetRasterState(r.Raster.SmoothLines);
+        cmd.SetShader(sh_Grid);
 
         // Determine center of grid based on camera position
         vec3 chunk = gridSize * float(gridChunkSize);
@@ -190,11 +190,11 @@ namespace chisel
         mat4x4 proj = camera.ProjMatrix();
 
         // Set camera state
-        cbuffers::CameraState camState;
+        cbuffers::CameraState camState = {};
         camState.viewProj = proj * view;
         camState.view = view;
         camState.farZ = glm::min(farZ.x, farZ.y);
-        r.UploadConstBuffer(0, r.cbuffers.camera, camState, render::VertexShader);
+        cmd.UploadConstBuffer(0, r.cbuffers.camera, camState, render::VertexShader);
 
         // Draw each cell
         for (int x = -radius.x; x <= radius.x; x++)
@@ -203,20 +203,20 @@ namespace chisel
             {
                 vec3 translation = vec3(x, y, 0) * vec3(gridChunkSize);
 
-                cbuffers::ObjectState data;
+                cbuffers::ObjectState data = {};
                 data.model = glm::translate(mtx, translation);
                 data.id = 0;
 
-                r.UploadConstBuffer(1, r.cbuffers.object, data, render::VertexShader);
+                cmd.UploadConstBuffer(1, r.cbuffers.object, data, render::VertexShader);
 
-                r.DrawMesh(grid.ptr());
+                cmd.DrawMesh(grid.ptr());
             }
         }
 
-        r.SetRasterState(r.Raster.Default.ptr());
-        r.ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        r.SetDepthStencilState(r.Depth.Default.ptr());
-        r.SetBlendState(nullptr);
+        cmd.SetRasterState(r.Raster.Default);
+        cmd.SetTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        cmd.SetDepthStencilState(r.Depth.Default);
+        cmd.SetBlendState(nullptr);
     }
 
     Handles::Handles()
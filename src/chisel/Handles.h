@@ -6,6 +6,7 @@
 #include "math/Color.h"
 #include "math/AABB.h"
 #include "render/Render.h"
+#include "render/CommandList.h"
 #include "core/Transform.h"
 #include "core/Camera.h"
 #include "console/ConVar.h"
@@ -48,7 +49,7 @@ namespace chisel
 
         static constexpr int gridChunkSize = 200;
 
-        void DrawGrid(Camera& camera, vec3 gridSize);
+        void DrawGrid(render::CommandList& cmd, Camera& camera, vec3 gridSize);
 
         Handles();
 
@@ -1,11 +1,17 @@
 #include "MapRender.h"
 
 #include "console/ConVar.h"
+#include "console/ConCommand.h"
 #include "core/Transform.h"
 #include "FGD/FGD.h"
 #include "gui/Viewport.h"
 #include "render/CBuffers.h"
+#include "common/Parallel.h"
+#include "common/Profiler.h"
+#include "common/Hash.h"
 #include <glm/gtx/normal.hpp>
+#include <algorithm>
+#include <cmath>
 
 namespace chisel
 {
@@ -13,6 +19,28 @@ namespace chisel
     static ConVar<bool> r_drawworld("r_drawworld", true, "Draw world");
     static ConVar<bool> r_drawsprites("r_drawsprites", true, "Draw sprites");
 
+    static ConVar<int>   r_lod("r_lod", -1, "Force every model to this LOD. -1 to pick them by size on screen.");
+    static ConVar<float> r_lod_bias("r_lod_bias", 0.0f, "Bias for picking model LODs. Each step up halves the size on screen models are treated as.");
+    static ConVar<float> r_lod_pixels("r_lod_pixels", 256.0f, "Models smaller than this on screen, in pixels, drop to their next LOD. Each LOD after that is used at half the size of the one before.");
+
+    static ConVar<float> r_disp_lod_distance("r_disp_lod_distance", 4096.0f, "Displacements drop a level of detail every this many units away from the camera. 0 for always full detail.");
+
+    static ConVar<bool>  r_occlusion("r_occlusion", true, "Skip brushes and models hidden behind big solids, tested on the CPU.");
+    static ConVar<float> r_occlusion_occluder_size("r_occlusion_occluder_size", 256.0f, "Solids at least this wide in two directions hide what's behind them.");
+
+    static ConCommand occlusion_stats("occlusion_stats", "Print occlusion culling results for the last viewport drawn.", []()
+    {
+        const OcclusionCuller::Stats& stats = Chisel.Renderer->GetOcclusionStats();
+        Console.Log("Occlusion: {} occluders, {} polygons", stats.occluders, stats.polygons);
+        Console.Log("  {} tested: {} visible, {} occluded, {} off screen", stats.tested, stats.visible, stats.occluded, stats.outside);
+    });
+
+    static ConVar<bool> r_parallel_record("r_parallel_record", true, "Record viewports on worker threads, one each, before submitting them together.");
+    static ConVar<bool> r_redraw_always("r_redraw_always", false, "Draw every viewport every frame, even if nothing in it changed.");
+
+    static ConVar<float> r_brush_compact_threshold("r_brush_compact_threshold", 0.25f, "Compact a page of brush memory once this much of it is lost in holes between meshes. 0 to never compact.");
+    static ConVar<int> r_brush_compact_budget("r_brush_compact_budget", 256, "Solids moved per frame while compacting brush memory.");
+
     // Orange Tint: Color(0.8, 0.4, 0.1, 1);
     static ConVar<vec4> color_selection = ConVar<vec4>("color_selection", vec4(0.6, 0.1, 0.1, 1), "Selection color");
     static ConVar<vec4> color_selection_outline = ConVar<vec4>("color_selection_outline", vec4(0.95, 0.59, 0.19, 1), "Selection outline color");
@@ -28,156 +56,488 @@ namespace chisel
         Shaders.Brush = render::Shader(r.device.ptr(), VertexSolid::InputLayout, "brush");
         Shaders.BrushBlend = render::Shader(r.device.ptr(), VertexSolid::InputLayout, "brush_blend");
         Shaders.BrushDebugID = render::Shader(r.device.ptr(), VertexSolid::InputLayout, "debug_id_brush");
-        Shaders.SpriteDebugID = render::Shader(r.device.ptr(), Primitives::Vertex::Layout, "debug_id_sprite");
+
+        // Optional until shaders/build.bat has been run since they were added. Brushes stay unpacked without them.
+        if (render::Shader::Exists("brush_packed") && render::Shader::Exists("brush_blend_packed") && render::Shader::Exists("debug_id_brush_packed"))
+        {
+            Shaders.BrushPacked = render::Shader(r.device.ptr(), VertexSolidPacked::InputLayout, "brush_packed");
+            Shaders.BrushBlendPacked = render::Shader(r.device.ptr(), VertexSolidPacked::InputLayout, "brush_blend_packed");
+            Shaders.BrushDebugIDPacked = render::Shader(r.device.ptr(), VertexSolidPacked::InputLayout, "debug_id_brush_packed");
+        }
+        Core.packedBrushShaders = Shaders.BrushPacked.inputLayout != nullptr
+            && Shaders.BrushBlendPacked.inputLayout != nullptr
+            && Shaders.BrushDebugIDPacked.inputLayout != nullptr;
+        if (!Core.packedBrushShaders && r_brush_packed_vertices)
+            r_brush_packed_vertices.SetValue(false);
+
+        Shaders.SpriteDebugID = Gizmos::LoadSpriteShader("debug_id_sprite");
         Shaders.Model = render::Shader(r.device.ptr(), VertexSolid::InputLayout, "model");
+        // Optional like the packed brush shaders, models are drawn one at a time without it.
+        if (render::Shader::Exists("model_instanced"))
+            Shaders.ModelInstanced = render::Shader(r.device.ptr(), ModelInstance::Layout, "model_instanced");
 
         // Load builtin textures
         Textures.Missing = Assets.Load<Texture>("textures/error.png");
         Textures.White = Assets.Load<Texture>("textures/white.png");
 
-        Chisel.brushAllocator = std::make_unique<BrushGPUAllocator>(r);
+        auto brushes = std::make_unique<BrushGPUAllocator>(r);
+        brushAllocator = brushes.get();
+        Core.brushAllocator = std::move(brushes);
+
+        // Textures finishing loading, or reloading, change how the map looks.
+        Assets.OnLoad += [] { Core.SceneChanged(); };
+        Assets.OnRefresh += [] { Core.SceneChanged(); };
+
+        Engine.OnRender += [this](render::RenderContext&)
+        {
+            RenderViewports();
+        };
+
+        Engine.OnEndFrame += [this](render::RenderContext&)
+        {
+            brushAllocator->EndFrame();
+            CompactBrushes();
+        };
+    }
+
+    void MapRender::CompactBrushes()
+    {
+        PROFILE_SCOPE("MapRender::CompactBrushes");
+
+        int32_t page = brushAllocator->GetEvacuating();
+        if (page < 0)
+        {
+            compactQueue.clear();
+            if (r_brush_compact_threshold <= 0.0f)
+                return;
+
+            float worst = r_brush_compact_threshold;
+            for (uint32_t i = 0; i < brushAllocator->PageCount(); i++)
+            {
+                float fragmentation = brushAllocator->Fragmentation(i);
+                if (fragmentation >= worst)
+                {
+                    page = int32_t(i);
+                    worst = fragmentation;
+                }
+            }
+
+            if (page < 0)
+                return;
+
+            auto queue = [&](BrushEntity& entity)
+            {
+                for (Solid& solid : entity.Brushes())
+                {
+                    for (const BrushMesh& mesh : solid.GetMeshes())
+                    {
+                        if (mesh.alloc && int32_t(mesh.alloc->page) == page)
+                        {
+                            compactQueue.push_back(solid.GetAtomID());
+                            break;
+                        }
+                    }
+                }
+            };
+            queue(map);
+            for (BrushEntity* entity : map.BrushEntities())
+                queue(*entity);
+
+            // New meshes go elsewhere, and the page is given back once its frees have gone through.
+            brushAllocator->SetEvacuating(page);
+        }
+
+        size_t count = std::min<size_t>(compactQueue.size(), std::max<int>(r_brush_compact_budget, 1));
+        for (size_t i = 0; i < count; i++)
+        {
+            // Might have been deleted since.
+            if (Solid* solid = dynamic_cast<Solid*>(Atom::FindAtom(compactQueue.back())))
+                solid->ReuploadMeshes();
+            compactQueue.pop_back();
+        }
+
+        // Everything's moved and freed but the page is still in use, e.g. by a solid added back by undo.
+        if (compactQueue.empty() && brushAllocator->stats().pendingFree == 0)
+            brushAllocator->SetEvacuating(-1);
     }
 
     void MapRender::DrawViewport(Viewport& viewport)
     {
+        viewportQueue.push_back(&viewport);
+    }
+
+    void MapRender::ViewState::SetCamera(vec3 position, const mat4x4& proj, float height)
+    {
+        lodOrigin = position;
+        lodScale  = proj[1][1] * height * 0.5f;
+    }
+
+    void MapRender::RenderViewports()
+    {
+        if (viewportQueue.empty())
+            return;
+
+        PROFILE_SCOPE("MapRender::RenderViewports");
+
+        // Brings dirty proxies up to date, which can't happen on several threads at once.
+        // Before the keys, as it can bump the scene revision.
+        std::span<const Map::EntityProxy> proxies = map.EntityProxies();
+
+        // Viewports showing the same thing as last frame keep what's in their render targets.
+        drawQueue.clear();
+        for (Viewport* viewport : viewportQueue)
+        {
+            uint64_t key = ViewportKey(*viewport);
+            if (key == viewport->drawnKey && !r_redraw_always)
+                continue;
+
+            viewport->drawnKey = key;
+            drawQueue.push_back(viewport);
+        }
+        viewportQueue.clear();
+
+        if (drawQueue.empty())
+            return;
+
+        // A view that changed can keep changing with nothing else happening, like a camera still
+        // moving after its keys were let go. Look again next frame before going idle.
+        Engine.StayAwake();
+
+        while (views.size() < drawQueue.size())
+            views.push_back(std::make_unique<ViewState>());
+
+        // Uploading isn't safe from the recording threads, so every model they could draw goes up first.
+        {
+            PROFILE_SCOPE("MapRender::UploadModels");
+            for (const Map::EntityProxy& proxy : proxies)
+            {
+                if (proxy.model)
+                    UploadModel(proxy.model);
+            }
+        }
+
+        auto record = [&](size_t i)
+        {
+            RecordViewport(*views[i], *drawQueue[i], proxies);
+        };
+
+        if (r_parallel_record)
+            ParallelFor(drawQueue.size(), record);
+        else
+        {
+            for (size_t i = 0; i < drawQueue.size(); i++)
+                record(i);
+        }
+
+        {
+            PROFILE_SCOPE("MapRender::Submit");
+            for (Viewport* viewport : drawQueue)
+            {
+                r.Submit(viewport->sceneCommands);
+                r.Submit(viewport->handleCommands);
+            }
+        }
+
+        occlusionStats = views[drawQueue.size() - 1]->occlusion.GetStats();
+    }
+
+    uint64_t MapRender::ViewportKey(Viewport& viewport) const
+    {
+        Camera& camera = viewport.GetCamera();
+        mat4x4 viewProj = camera.ProjMatrix() * camera.ViewMatrix();
+
+        // Render targets are remade on resize, and start out empty.
+        const void* targets[] = { viewport.rt_SceneView.ptr(), viewport.ds_SceneView.ptr(), viewport.rt_ObjectID.ptr() };
+        uint2 size = viewport.rt_SceneView->GetSize();
+
+        uint64_t revisions[] = {
+            size.x, size.y,
+            Core.sceneRevision.load(std::memory_order_relaxed),
+            ConVarRevision.load(std::memory_order_relaxed),
+            uint64_t(viewport.drawMode),
+            // Handles are recorded fresh every frame, so compare what was recorded.
+            viewport.handleCommands.Hash(),
+        };
+
+        uint64_t hash = HashBytes(&viewProj, sizeof(viewProj));
+        hash = HashBytes(targets, sizeof(targets), hash);
+        return HashBytes(revisions, sizeof(revisions), hash);
+    }
+
+    void MapRender::RecordViewport(ViewState& view, Viewport& viewport, std::span<const Map::EntityProxy> proxies)
+    {
+        PROFILE_SCOPE("MapRender::RecordViewport");
+
+        render::CommandList& cmd = viewport.sceneCommands;
+        cmd.Reset();
+        view.cmd = &cmd;
+
         // Get camera matrices
         Camera& camera = viewport.GetCamera();
-        mat4x4 view = camera.ViewMatrix();
+        mat4x4 viewMatrix = camera.ViewMatrix();
         mat4x4 proj = camera.ProjMatrix();
 
         // Update CameraState
         cbuffers::CameraState data;
-        data.viewProj = proj * view;
-        data.view = view;
+        data.viewProj = proj * viewMatrix;
+        data.view = viewMatrix;
 
-        r.UploadConstBuffer(0, r.cbuffers.camera, data, render::VertexShader);
+        cmd.UploadConstBuffer(0, r.cbuffers.camera, data, render::VertexShader);
 
         ID3D11RenderTargetView* rts[] = {viewport.rt_SceneView->rtv.ptr(), viewport.rt_ObjectID->rtv.ptr()};
-        r.ctx->OMSetRenderTargets(2, rts, viewport.ds_SceneView->dsv.ptr());
+        cmd.SetRenderTargets(rts, viewport.ds_SceneView->dsv.ptr());
 
         float2 size = viewport.rt_SceneView->GetSize();
-        D3D11_VIEWPORT viewrect = { 0, 0, size.x, size.y, 0.0f, 1.0f };
-        r.ctx->RSSetViewports(1, &viewrect);
+        cmd.SetViewport(D3D11_VIEWPORT{ 0, 0, size.x, size.y, 0.0f, 1.0f });
+
+        view.SetCamera(camera.position, proj, size.y);
 
-        r.ctx->ClearRenderTargetView(viewport.rt_SceneView->rtv.ptr(), Color(0.2, 0.2, 0.2).Linear());
-        r.ctx->ClearRenderTargetView(viewport.rt_ObjectID->rtv.ptr(), Colors.Black);
-        r.ctx->ClearDepthStencilView(viewport.ds_SceneView->dsv.ptr(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+        cmd.ClearRenderTarget(viewport.rt_SceneView->rtv.ptr(), Color(0.2, 0.2, 0.2).Linear());
+        cmd.ClearRenderTarget(viewport.rt_ObjectID->rtv.ptr(), Colors.Black);
+        cmd.ClearDepthStencil(viewport.ds_SceneView->dsv.ptr());
 
-        drawMode = viewport.drawMode;
-        if (wireframe = drawMode == Viewport::DrawMode::Wireframe)
-            r.SetRasterState(r.Raster.Wireframe.ptr());
+        view.drawMode = viewport.drawMode;
+        if (view.wireframe = view.drawMode == Viewport::DrawMode::Wireframe)
+            cmd.SetRasterState(r.Raster.Wireframe);
         else
-            r.SetRasterState(r.Raster.Default.ptr());
+            cmd.SetRasterState(r.Raster.Default);
+
+        // Big world solids hide what's behind them. Not in wireframe, where everything shows through.
+        view.occlusionActive = r_occlusion && !view.wireframe;
+        if (view.occlusionActive)
+        {
+            PROFILE_SCOPE("MapRender::Occluders");
+            view.occlusion.Begin(data.viewProj);
+            for (const Solid& solid : map.Brushes())
+            {
+                if (OcclusionCuller::IsOccluder(solid, r_occlusion_occluder_size))
+                    view.occlusion.AddOccluder(solid);
+            }
+            view.occlusion.Finish();
+        }
 
-        // TODO: Cull!
         if (r_drawbrushes)
         {
+            PROFILE_SCOPE("MapRender::Brushes");
             if (r_drawworld)
-                DrawBrushEntity(map);
+                DrawBrushEntity(view, map);
 
-            for (auto* entity : map.Entities())
-            {
-                if (BrushEntity* brush = dynamic_cast<BrushEntity*>(entity))
-                    DrawBrushEntity(*brush);
-            }
+            for (BrushEntity* brush : map.BrushEntities())
+                DrawBrushEntity(view, *brush);
         }
 
-        if (wireframe)
-            r.SetRasterState(r.Raster.Default.ptr());
+        if (view.wireframe)
+            cmd.SetRasterState(r.Raster.Default);
 
-        for (const auto* entity : map.Entities())
         {
-            const PointEntity* point = dynamic_cast<const PointEntity*>(entity);
-            if (!point) continue;
+            PROFILE_SCOPE("MapRender::Entities");
 
-            DrawPointEntity(entity->classname, false, point->origin, vec3(0), point->IsSelected(), point->GetSelectionID(), point);
+            const Color selected = Color(color_selection);
+            for (const Map::EntityProxy& proxy : proxies)
+            {
+                if (view.occlusionActive && proxy.model)
+                {
+                    AABB bounds = proxy.bounds;
+                    if (proxy.model->bounds)
+                        bounds = AABB{ proxy.origin + proxy.model->bounds->min, proxy.origin + proxy.model->bounds->max };
+
+                    if (!view.occlusion.IsVisible(bounds))
+                        continue;
+                }
+
+                DrawEntity(view, proxy, proxy.selected ? selected : Colors.White);
+            }
+            DrawModels(view);
         }
 
-        r.SetRasterState(r.Raster.Default.ptr());
+        // Sprites and anything else drawn as gizmos.
+        Gizmos.Flush(cmd);
+
+        cmd.SetRasterState(r.Raster.Default);
     }
 
-    void MapRender::DrawPointEntity(const std::string& classname, bool preview, vec3 origin, vec3 angles, bool selected, SelectionID id, const PointEntity* ent)
+    void MapRender::DrawPointEntity(const std::string& classname, bool preview, vec3 origin)
     {
-        const Color color = selected ? Color(color_selection) : (preview ? Color(color_preview) : Colors.White);
+        Map::EntityProxy proxy;
+        proxy.origin = origin;
 
-        Gizmos.color = color;
-        Gizmos.id = id;
+        auto iter = Core.fgd->classes.find(classname);
+        if (iter != Core.fgd->classes.end())
+        {
+            proxy.cls    = &iter->second;
+            proxy.sprite = proxy.cls->texture.ptr();
+            // No entity to have a model yet.
+            proxy.model  = proxy.cls->isProp ? nullptr : proxy.cls->model.ptr();
+        }
 
-        // TODO: Should cache FGD class with each ent...
-        if (!Chisel.fgd->classes.contains(classname))
+        // Drawn by FlushHandles
+        DrawEntity(handleView, proxy, preview ? Color(color_preview) : Colors.White);
+    }
+
+    void MapRender::DrawEntity(ViewState& view, const Map::EntityProxy& proxy, Color color)
+    {
+        Gizmo& gizmos = view.gizmos;
+        gizmos.color = color;
+        gizmos.id = proxy.id;
+
+        vec3 origin = proxy.origin;
+        if (!proxy.cls)
         {
-            DrawObsolete(origin);
-            Gizmos.id = 0;
+            DrawObsolete(view, origin);
+            gizmos.id = 0;
             return;
         }
 
         bool drew = false;
 
-        auto& cls = Chisel.fgd->classes[classname];
-
-        //AABB bounds = AABB{cls.bbox[0], cls.bbox[1]};
         // TODO: Draw boxes if no sprite
 
-        // Draw models
-        if (cls.model != nullptr || cls.isProp)
+        // Queue models, drawn instanced with every other entity using the same one
+        if (Mesh* model = proxy.model)
         {
-            Rc<Mesh> model = cls.isProp ? ent->GetModel() : cls.model;
-            if (model != nullptr)
-            {
-                // Just upload it if it's not uploaded
-                if (!model->uploaded) [[unlikely]]
-                    r.UploadMesh(model.ptr());
+            view.modelQueue.push_back(QueuedModel{ model, SelectLOD(view, *model, origin), ModelInstance{
+                .model = glm::translate(glm::identity<mat4x4>(), origin),
+                .color = color,
+                .id    = proxy.id,
+            }});
+            drew = true;
+        }
+
+        // Draw sprites
+        if (r_drawsprites && proxy.sprite != nullptr)
+        {
+            DrawPixelSprite(view, origin, proxy.sprite);
+            drew = true;
+        }
 
-                r.SetShader(Shaders.Model);
-                r.ctx->PSSetShaderResources(0, 1, &Textures.White->srvSRGB);
+        if (!drew)
+            DrawObsolete(view, origin);
 
-                cbuffers::ObjectState data;
-                data.color = color;
-                data.id = id;
-                data.model = glm::translate(glm::identity<mat4x4>(), origin);
+        gizmos.color = Colors.White;
+        gizmos.id = 0;
+    }
 
-                r.UploadConstBuffer(1, r.cbuffers.object, data);
+    void MapRender::DrawModels(ViewState& view)
+    {
+        std::vector<QueuedModel>& modelQueue = view.modelQueue;
+        if (modelQueue.empty())
+            return;
 
-                r.SetDepthStencilState(r.Depth.Default);
-                r.SetRasterState(r.Raster.Default);
-                r.SetSampler(0, r.Sample.Default);
+        PROFILE_SCOPE("MapRender::DrawModels");
 
-                r.DrawMesh(model.ptr());
-                drew = true;
-            }
+        render::CommandList& cmd = *view.cmd;
+
+        // Group by mesh and LOD, each run of them is one instanced draw per group.
+        std::stable_sort(modelQueue.begin(), modelQueue.end(), [](const QueuedModel& a, const QueuedModel& b)
+        {
+            return a.mesh != b.mesh ? a.mesh < b.mesh : a.lod < b.lod;
+        });
+
+        const bool instanced = Shaders.ModelInstanced.inputLayout != nullptr;
+
+        uint32_t count = uint32_t(modelQueue.size());
+        uint offset = 0;
+        if (instanced)
+        {
+            auto* instances = (ModelInstance*)cmd.Upload(count * sizeof(ModelInstance), offset);
+            for (uint32_t i = 0; i < count; i++)
+                instances[i] = modelQueue[i].instance;
         }
 
-        // Draw sprites
-        if (r_drawsprites && cls.texture != nullptr)
+        cmd.SetShader(instanced ? Shaders.ModelInstanced : Shaders.Model);
+        cmd.SetDepthStencilState(r.Depth.Default);
+        cmd.SetRasterState(r.Raster.Default);
+        cmd.SetSampler(0, r.Sample.Default);
+
+        for (uint32_t first = 0; first < count;)
         {
-            DrawPixelSprite(origin, cls.texture.ptr());
-            drew = true;
+            Mesh* mesh = modelQueue[first].mesh;
+            uint lod = modelQueue[first].lod;
+            uint32_t run = 1;
+            while (first + run < count && modelQueue[first + run].mesh == mesh && modelQueue[first + run].lod == lod)
+                run++;
+
+            // Failed to upload, see UploadModel.
+            bool uploaded = mesh->uploaded;
+
+            if (uploaded && instanced)
+            {
+                cmd.SetShaderResource(0, Textures.White->srvSRGB.ptr());
+                cmd.DrawMeshInstanced(mesh, sizeof(ModelInstance), offset + first * sizeof(ModelInstance), run, lod);
+            }
+            else if (uploaded)
+            {
+                // Without model_instanced every instance is its own draw, as before instancing.
+                cmd.SetShaderResource(0, Textures.White->srvSRGB.ptr());
+                for (uint32_t i = first; i < first + run; i++)
+                {
+                    const ModelInstance& instance = modelQueue[i].instance;
+                    cbuffers::ObjectState data = {};
+                    data.model = instance.model;
+                    data.color = instance.color;
+                    data.id    = instance.id;
+                    cmd.UploadConstBuffer(1, r.cbuffers.object, data);
+                    cmd.DrawMesh(mesh, lod);
+                }
+            }
+
+            first += run;
         }
 
-        if (!drew)
-            DrawObsolete(origin);
+        modelQueue.clear();
+    }
 
-        Gizmos.color = Colors.White;
-        Gizmos.id = 0;
+    void MapRender::UploadModel(Mesh* mesh)
+    {
+        if (!mesh->uploaded) [[unlikely]]
+            r.UploadMesh(mesh);
     }
 
-    inline void MapRender::DrawPixelSprite(vec3 pos, Texture* tex)
+    uint MapRender::SelectLOD(const ViewState& view, const Mesh& mesh, vec3 origin) const
     {
-        r.SetSampler(0, r.Sample.Point);
-        if (this->drawMode == Viewport::DrawMode::ObjectID)
-            Gizmos.DrawIcon(pos, tex != nullptr ? tex : Gizmos.icnObsolete.ptr(), vec3(32.0f), Shaders.SpriteDebugID);
-        else
-            Gizmos.DrawIcon(pos, tex != nullptr ? tex : Gizmos.icnObsolete.ptr(), vec3(32.0f));
-        r.SetSampler(0, r.Sample.Default);
+        uint count = mesh.LODCount();
+        if (count < 2)
+            return 0;
+
+        if (r_lod >= 0)
+            return std::min<uint>(r_lod, count - 1);
+
+        if (!mesh.bounds)
+            return 0;
+
+        // Projected size of the bounding sphere
+        float radius   = glm::length(mesh.bounds->Dimensions()) * 0.5f;
+        float distance = glm::max(glm::distance(view.lodOrigin, origin + mesh.bounds->Center()), radius);
+        float pixels   = 2.0f * radius * view.lodScale / glm::max(distance, 1.0f);
+        pixels *= std::exp2(-float(r_lod_bias));
+
+        uint lod = 0;
+        float threshold = r_lod_pixels;
+        while (lod + 1 < count && pixels < threshold)
+        {
+            lod++;
+            threshold *= 0.5f;
+        }
+        return lod;
+    }
 
+    inline void MapRender::DrawPixelSprite(ViewState& view, vec3 pos, Texture* tex)
+    {
+        Gizmo& gizmos = view.gizmos;
+        gizmos.pointSample = true;
+        if (view.drawMode == Viewport::DrawMode::ObjectID)
+            gizmos.DrawIcon(pos, tex != nullptr ? tex : Gizmos.icnObsolete.ptr(), vec3(32.0f), Shaders.SpriteDebugID);
+        else
+            gizmos.DrawIcon(pos, tex != nullptr ? tex : Gizmos.icnObsolete.ptr(), vec3(32.0f));
+        gizmos.pointSample = false;
     }
     
-    inline void MapRender::DrawObsolete(vec3 pos)
+    inline void MapRender::DrawObsolete(ViewState& view, vec3 pos)
     {
         if (r_drawsprites)
-            DrawPixelSprite(pos, nullptr);
+            DrawPixelSprite(view, pos, nullptr);
         else
-            Gizmos.DrawPoint(pos);
+            view.gizmos.DrawPoint(pos);
     }
 
     struct BrushPass : cbuffers::BrushState
@@ -190,20 +550,23 @@ namespace chisel
         BrushPass(BrushMesh* mesh)
         {
             this->mesh = mesh;
-            indices = mesh->indices.size();
+            indices = mesh->GetLOD(0).indexCount;
             id = mesh->brush->GetSelectionID();
+            faceBase = id;
+            partShift = SelectionIDs::IndexBits;
             color = Colors.White;
         }
     };
 
-    inline void MapRender::DrawPass(const BrushPass& pass)
+    inline void MapRender::DrawPass(ViewState& view, const BrushPass& pass)
     {
-        r.UploadConstBuffer(1, r.cbuffers.brush, pass);
+        render::CommandList& cmd = *view.cmd;
+        cmd.UploadConstBuffer(1, r.cbuffers.brush, static_cast<const cbuffers::BrushState&>(pass));
 
-        uint stride = sizeof(VertexSolid);
+        uint stride = BrushVertexStride();
         uint vertexOffset = pass.mesh->alloc->offset;
-        uint indexOffset = vertexOffset + pass.mesh->vertices.size() * stride;
-        ID3D11Buffer* buffer = Chisel.brushAllocator->buffer();
+        uint indexOffset = vertexOffset + pass.mesh->vertexCount * stride;
+        ID3D11Buffer* buffer = brushAllocator->buffer(pass.mesh->alloc->page);
         ID3D11ShaderResourceView *srv = nullptr;
         bool pointSample = false;
 
@@ -223,7 +586,7 @@ namespace chisel
                 if (Texture* layer = material->baseTextures[i].ptr())
                 {
                     numLayers++;
-                    r.ctx->PSSetShaderResources(i+1, 1, pass.texOverride ? &pass.texOverride->srvSRGB : &layer->srvSRGB);
+                    cmd.SetShaderResource(i+1, pass.texOverride ? pass.texOverride->srvSRGB.ptr() : layer->srvSRGB.ptr());
                 }
             }
         }
@@ -238,54 +601,67 @@ namespace chisel
         }
         if (pointSample)
         {
-            r.ctx->PSSetSamplers(0, 1, &r.Sample.Point);
+            cmd.SetSampler(0, r.Sample.Point);
         }
-        r.ctx->PSSetShaderResources(0, 1, &srv);
+        cmd.SetShaderResource(0, srv);
 
         // Choose shader variant
-        if (numLayers > 1)
-            r.SetShader(Shaders.BrushBlend);
+        bool packed = r_brush_packed_vertices;
+        if (view.drawMode == Viewport::DrawMode::ObjectID)
+            cmd.SetShader(packed ? Shaders.BrushDebugIDPacked : Shaders.BrushDebugID);
+        else if (numLayers > 1)
+            cmd.SetShader(packed ? Shaders.BrushBlendPacked : Shaders.BrushBlend);
         else
-            r.SetShader(Shaders.Brush);
+            cmd.SetShader(packed ? Shaders.BrushPacked : Shaders.Brush);
 
-        if (this->drawMode == Viewport::DrawMode::ObjectID)
-            r.SetShader(Shaders.BrushDebugID);
-
-        r.ctx->IASetVertexBuffers(0, 1, &buffer, &stride, &vertexOffset);
-        r.ctx->IASetIndexBuffer(buffer, DXGI_FORMAT_R32_UINT, indexOffset);
-        r.ctx->DrawIndexed(pass.indices, pass.startIndex, 0);
+        cmd.SetVertexBuffer(0, buffer, stride, vertexOffset);
+        cmd.SetIndexBuffer(buffer, DXGI_FORMAT_R32_UINT, indexOffset);
+        cmd.DrawIndexed(pass.indices, pass.startIndex, 0);
         if (pointSample)
         {
-            r.ctx->PSSetSamplers(0, 1, &r.Sample.Default);
+            cmd.SetSampler(0, r.Sample.Default);
         }
     }
 
-    inline void MapRender::DrawSelectionOutline(BrushPass pass)
+    inline void MapRender::DrawSelectionOutline(ViewState& view, BrushPass pass)
     {
-        r.SetBlendState(render::BlendFuncs::Alpha);
-        r.SetRasterState(r.Raster.Wireframe.ptr());
-        r.SetDepthStencilState(r.Depth.NoWrite.ptr());
+        render::CommandList& cmd = *view.cmd;
+        cmd.SetBlendState(render::BlendFuncs::Alpha);
+        cmd.SetRasterState(r.Raster.Wireframe);
+        cmd.SetDepthStencilState(r.Depth.NoWrite);
         pass.color = color_selection_outline;
         pass.texOverride = Textures.White.ptr();
-        DrawPass(pass);
-        r.SetDepthStencilState(r.Depth.Default.ptr());
-        r.SetRasterState(r.Raster.Default.ptr());
-        r.SetBlendState(nullptr);
+        DrawPass(view, pass);
+        cmd.SetDepthStencilState(r.Depth.Default);
+        cmd.SetRasterState(r.Raster.Default);
+        cmd.SetBlendState(nullptr);
     }
 
-    inline void MapRender::DrawMesh(BrushMesh* mesh)
+    inline void MapRender::DrawMesh(ViewState& view, BrushMesh* mesh)
     {
         BrushPass pass = BrushPass(mesh);
 
-        if (Chisel.selectMode == SelectMode::Faces)
+        // Lower detail displacements further away, by the nearest point of their solid.
+        if (mesh->lodCount > 1 && r_disp_lod_distance > 0.0f)
+        {
+            if (std::optional<AABB> bounds = mesh->brush->GetBounds())
+            {
+                float distance = glm::distance(view.lodOrigin, glm::clamp(view.lodOrigin, bounds->min, bounds->max));
+                DispLOD lod = mesh->GetLOD(uint32_t(std::min(distance / r_disp_lod_distance, float(DispMaxLODs))));
+                pass.startIndex = lod.firstIndex;
+                pass.indices = lod.indexCount;
+            }
+        }
+
+        if (Core.selectMode == SelectMode::Faces)
             pass.id = 0;
 
-        if (wireframe)
+        if (view.wireframe)
         {
             // Draw only wireframe outline
             pass.color = mesh->brush->IsSelected() ? color_selection_outline : vec4(Colors.White);
             pass.texOverride = Textures.White.ptr();
-            DrawPass(pass);
+            DrawPass(view, pass);
         }
         else
         {
@@ -293,30 +669,39 @@ namespace chisel
             {
                 // Highlight face
                 pass.color = color_selection;
-                DrawPass(pass);
+                DrawPass(view, pass);
 
                 // Draw wireframe outline
-                DrawSelectionOutline(pass);
+                DrawSelectionOutline(view, pass);
             }
             else
             {
-                DrawPass(pass);
+                DrawPass(view, pass);
             }
         }
     }
 
-    void MapRender::DrawBrushEntity(BrushEntity& ent)
+    void MapRender::DrawBrushEntity(ViewState& view, BrushEntity& ent)
     {
-        static std::vector<BrushMesh*> opaqueMeshes;
-        static std::vector<BrushMesh*> transMeshes;
+        std::vector<BrushMesh*>& opaqueMeshes = view.opaqueMeshes;
+        std::vector<BrushMesh*>& transMeshes = view.transMeshes;
         opaqueMeshes.clear();
         transMeshes.clear();
 
         for (Solid& brush : ent.Brushes())
         {
+            if (view.occlusionActive)
+            {
+                std::optional<AABB> bounds = brush.GetBounds();
+                if (bounds && !view.occlusion.IsVisible(*bounds))
+                    continue;
+            }
+
             for (auto& mesh : brush.GetMeshes())
             {
-                assert(mesh.alloc);
+                // Failed to upload
+                if (!mesh.alloc)
+                    continue;
 
                 if (mesh.material && mesh.material->translucent)
                     transMeshes.push_back(&mesh);
@@ -325,27 +710,40 @@ namespace chisel
             }
         }
 
+        render::CommandList& cmd = *view.cmd;
+
         // Draw opaque meshes.
-        r.SetBlendState(wireframe ? render::BlendFuncs::Alpha : render::BlendFuncs::Normal);
-        r.SetDepthStencilState(r.Depth.Default.ptr());
+        cmd.SetBlendState(view.wireframe ? render::BlendFuncs::Alpha : render::BlendFuncs::Normal);
+        cmd.SetDepthStencilState(r.Depth.Default);
         for (auto* mesh : opaqueMeshes)
-            DrawMesh(mesh);
+            DrawMesh(view, mesh);
 
         // Draw trans meshes.
-        r.SetBlendState(render::BlendFuncs::Alpha);
-        r.SetDepthStencilState(r.Depth.NoWrite.ptr());
+        cmd.SetBlendState(render::BlendFuncs::Alpha);
+        cmd.SetDepthStencilState(r.Depth.NoWrite);
         for (auto* mesh : transMeshes)
-            DrawMesh(mesh);
+            DrawMesh(view, mesh);
         
-        r.SetBlendState(render::BlendFuncs::Normal);
+        cmd.SetBlendState(render::BlendFuncs::Normal);
     }
 
-    void MapRender::DrawHandles(mat4x4& view, mat4x4& proj)
+    void MapRender::DrawHandles(Viewport& viewport, render::CommandList& cmd)
     {
+        PROFILE_SCOPE("MapRender::DrawHandles");
+
+        // Models and sprites from the tool are picked and drawn like the viewport's own.
+        Camera& camera = viewport.GetCamera();
+        ViewState& view = handleView;
+        view.cmd = &cmd;
+        view.drawMode = viewport.drawMode;
+        view.wireframe = false;
+        view.occlusionActive = false;
+        view.SetCamera(camera.position, camera.ProjMatrix(), float(viewport.rt_SceneView->GetSize().y));
+
         if (Selection.Empty())
             return;
 
-        if (Chisel.selectMode == SelectMode::Faces)
+        if (Core.selectMode == SelectMode::Faces)
         {
             for (auto& item : Selection)
             {
@@ -361,16 +759,25 @@ namespace chisel
                         pass.id = face->GetSelectionID();
 
                         // Highlight face
-                        r.SetRasterState(r.Raster.DepthBiased.ptr());
+                        cmd.SetRasterState(r.Raster.DepthBiased);
                         pass.color = color_selection;
-                        DrawPass(pass);
+                        DrawPass(view, pass);
 
                         // Draw selection outline
-                        DrawSelectionOutline(pass);
+                        DrawSelectionOutline(view, pass);
                     }
                 }
             }
         }
     }
 
-}
\ No newline at end of file
+    void MapRender::FlushHandles(render::CommandList& cmd)
+    {
+        handleView.cmd = &cmd;
+        for (const QueuedModel& model : handleView.modelQueue)
+            UploadModel(model.mesh);
+        DrawModels(handleView);
+        Gizmos.Flush(cmd);
+        handleView.cmd = nullptr;
+    }
+}
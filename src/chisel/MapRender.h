@@ -1,6 +1,7 @@
 #pragma once
 
 #include "chisel/Chisel.h"
+#include "chisel/BrushGPUAllocator.h"
 #include "common/System.h"
 #include "chisel/Engine.h"
 #include "chisel/Selection.h"
@@ -12,6 +13,11 @@
 #include "math/Math.h"
 #include "math/Color.h"
 #include "chisel/FGD/FGD.h"
+#include "chisel/Occlusion.h"
+#include "render/CommandList.h"
+
+#include <memory>
+#include <vector>
 
 namespace chisel
 {
@@ -29,10 +35,38 @@ namespace chisel
             render::Shader Brush;
             render::Shader BrushBlend;
             render::Shader BrushDebugID;
-            render::Shader SpriteDebugID;
+            // For VertexSolidPacked
+            render::Shader BrushPacked;
+            render::Shader BrushBlendPacked;
+            render::Shader BrushDebugIDPacked;
+            Gizmos::SpriteShader SpriteDebugID;
             render::Shader Model;
+            render::Shader ModelInstanced;
         } Shaders;
 
+        // Per instance data for Shaders.ModelInstanced
+        struct ModelInstance
+        {
+            mat4x4   model;
+            vec4     color;
+            uint32_t id;
+
+            // Slot 0 is the mesh, a VertexSolid.
+            static constexpr D3D11_INPUT_ELEMENT_DESC Layout[] =
+            {
+                { "POSITION",     0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 0,                            D3D11_INPUT_PER_VERTEX_DATA,   0 },
+                { "NORMAL",       0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+                { "TEXCOORD",     0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+                { "BLENDINDICES", 0, DXGI_FORMAT_R32_UINT,           0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+                { "TRANSFORM",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,                            D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "TRANSFORM",    1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "TRANSFORM",    2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "TRANSFORM",    3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "COLOR",        0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+                { "BLENDINDICES", 1, DXGI_FORMAT_R32_UINT,           1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+            };
+        };
+
         struct DefaultTextures {
             Rc<Texture> Missing;
             Rc<Texture> White;
@@ -42,21 +76,97 @@ namespace chisel
 
         void Start() final override;
 
-        // Called by Viewport::Render
+        // Called by Viewport::Render. Queues the viewport to be recorded with the others once the UI is done.
         void DrawViewport(Viewport& viewport);
 
-        void DrawPointEntity(const std::string& classname, bool preview, vec3 origin, vec3 angles = vec3(0), bool selected = false, SelectionID id = 0, const PointEntity* ent = nullptr);
-        void DrawBrushEntity(BrushEntity& ent);
-        void DrawHandles(mat4x4& view, mat4x4& proj);
+        // Records every viewport queued this frame, in parallel, then submits them in order
+        // along with the handles drawn over them.
+        void RenderViewports();
+
+        // Handles over a viewport, recorded while its window is drawn: selected faces,
+        // then whatever the tool draws, then FlushHandles once the tool is done.
+        void DrawHandles(Viewport& viewport, render::CommandList& cmd);
+        void FlushHandles(render::CommandList& cmd);
+
+        // Draws an entity that isn't in the map, e.g. a placement preview. Only from a tool's DrawHandles.
+        void DrawPointEntity(const std::string& classname, bool preview, vec3 origin);
+
+        // Occlusion culling results for the last viewport drawn.
+        const OcclusionCuller::Stats& GetOcclusionStats() const { return occlusionStats; }
 
     protected:
-        inline void DrawPass(const BrushPass& pass);
-        inline void DrawSelectionOutline(BrushPass pass);
-        inline void DrawMesh(BrushMesh* mesh);
-        inline void DrawPixelSprite(vec3 pos, Texture* tex);
-        inline void DrawObsolete(vec3 pos);
-
-        bool wireframe = false;
-        Viewport::DrawMode drawMode = Viewport::DrawMode::Shaded;
+        struct QueuedModel
+        {
+            Mesh*         mesh;
+            uint          lod;
+            ModelInstance instance;
+        };
+
+        // Everything used while recording one viewport, so viewports can be recorded at the same time.
+        struct ViewState
+        {
+            render::CommandList* cmd = nullptr;
+            Gizmo gizmos;
+
+            Viewport::DrawMode drawMode = Viewport::DrawMode::Shaded;
+            bool wireframe = false;
+
+            // Rebuilt for each viewport, unless drawing wireframe.
+            OcclusionCuller occlusion;
+            bool occlusionActive = false;
+
+            // From the viewport's camera, for picking LODs
+            vec3  lodOrigin = vec3(0.0f);
+            float lodScale  = 1.0f; // Pixels across for something 1 unit wide, 1 unit away
+
+            std::vector<QueuedModel> modelQueue;
+
+            // Scratch for DrawBrushEntity
+            std::vector<BrushMesh*> opaqueMeshes;
+            std::vector<BrushMesh*> transMeshes;
+
+            void SetCamera(vec3 position, const mat4x4& proj, float height);
+        };
+
+        void RecordViewport(ViewState& view, Viewport& viewport, std::span<const Map::EntityProxy> proxies);
+
+        // Everything that decides what a viewport's render target ends up holding.
+        // If it matches the one from when the viewport was last drawn, the target is left as it is.
+        uint64_t ViewportKey(Viewport& viewport) const;
+
+        void DrawEntity(ViewState& view, const Map::EntityProxy& proxy, Color color);
+        void DrawBrushEntity(ViewState& view, BrushEntity& ent);
+
+        inline void DrawPass(ViewState& view, const BrushPass& pass);
+        inline void DrawSelectionOutline(ViewState& view, BrushPass pass);
+        inline void DrawMesh(ViewState& view, BrushMesh* mesh);
+        inline void DrawPixelSprite(ViewState& view, vec3 pos, Texture* tex);
+        inline void DrawObsolete(ViewState& view, vec3 pos);
+
+        // Draws the models DrawEntity queued up, one instanced draw per mesh group.
+        // Meshes that aren't uploaded yet are skipped, see UploadModel.
+        void DrawModels(ViewState& view);
+        // Uploads a model's mesh if it isn't already. Main thread only, before recording draws of it.
+        void UploadModel(Mesh* mesh);
+        // Level of detail for a model at this origin, from how big its bounds look in the view.
+        uint SelectLOD(const ViewState& view, const Mesh& mesh, vec3 origin) const;
+
+        // Moves solids out of the most fragmented brush page, a few each frame.
+        void CompactBrushes();
+
+        // Owned by Core
+        BrushGPUAllocator* brushAllocator = nullptr;
+        // Solids still to move out of the page being compacted
+        std::vector<AtomID> compactQueue;
+
+        // Viewports queued by DrawViewport this frame, and a state for each, kept between frames.
+        std::vector<Viewport*>                  viewportQueue;
+        // The ones that changed since they were last drawn, recorded and submitted.
+        std::vector<Viewport*>                  drawQueue;
+        std::vector<std::unique_ptr<ViewState>> views;
+        // For handles, recorded on the main thread.
+        ViewState handleView;
+
+        OcclusionCuller::Stats occlusionStats;
     };
 }
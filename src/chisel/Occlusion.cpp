@@ -0,0 +1,321 @@
+#include "chisel/Occlusion.h"
+#include "chisel/map/Solid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace chisel
+{
+    static constexpr uint32_t LevelWidth(uint32_t level)  { return std::max(OcclusionCuller::Width  >> level, 1u); }
+    static constexpr uint32_t LevelHeight(uint32_t level) { return std::max(OcclusionCuller::Height >> level, 1u); }
+
+    static_assert(OcclusionCuller::Width % 4 == 0);
+    static_assert(LevelWidth(OcclusionCuller::Levels - 1) >= 1 && LevelHeight(OcclusionCuller::Levels - 1) >= 1);
+
+    OcclusionCuller::OcclusionCuller()
+    {
+        for (uint32_t level = 0; level < Levels; level++)
+            m_depth[level].resize(LevelWidth(level) * LevelHeight(level), 1.0f);
+    }
+
+    void OcclusionCuller::Begin(const mat4x4& viewProj)
+    {
+        m_viewProj = viewProj;
+        m_stats = Stats{};
+        std::fill(m_depth[0].begin(), m_depth[0].end(), 1.0f);
+    }
+
+    bool OcclusionCuller::IsOccluder(const Solid& solid, float minSize)
+    {
+        if (solid.HasDisplacement())
+            return false;
+
+        std::optional<AABB> bounds = solid.GetBounds();
+        if (!bounds)
+            return false;
+
+        // Second biggest dimension
+        vec3 size = bounds->Dimensions();
+        float middle = std::max(std::min(size.x, size.y), std::min(std::max(size.x, size.y), size.z));
+        if (middle < minSize)
+            return false;
+
+        // Anything that can be seen through
+        for (const Side& side : solid.GetSides())
+        {
+            if (side.material && (side.material->translucent || side.material->alphatest))
+                return false;
+        }
+        return true;
+    }
+
+    void OcclusionCuller::AddOccluder(const Solid& solid)
+    {
+        ScreenRect rect;
+        if (!solid.GetBounds() || !Project(*solid.GetBounds(), rect))
+            return;
+
+        m_stats.occluders++;
+
+        for (const Face& face : solid.GetFaces())
+        {
+            if (face.points.size() < 3)
+                continue;
+
+            m_clipped.clear();
+            for (vec3 point : face.points)
+                m_clipped.push_back(m_viewProj * vec4(point, 1.0f));
+
+            // Clip against the near plane (z >= 0), the only one that matters for depth.
+            // The rest is clamped to the screen when rasterizing.
+            m_polygon.clear();
+            for (size_t i = 0; i < m_clipped.size(); i++)
+            {
+                const vec4& a = m_clipped[i];
+                const vec4& b = m_clipped[(i + 1) % m_clipped.size()];
+
+                if (a.z >= 0.0f)
+                    m_polygon.push_back(a);
+                if ((a.z >= 0.0f) != (b.z >= 0.0f))
+                    m_polygon.push_back(glm::mix(a, b, a.z / (a.z - b.z)));
+            }
+
+            if (m_polygon.size() < 3)
+                continue;
+
+            // To pixels, y down.
+            for (vec4& v : m_polygon)
+            {
+                float w = std::max(v.w, 1e-6f);
+                v = vec4(
+                    (v.x / w *  0.5f + 0.5f) * Width,
+                    (v.y / w * -0.5f + 0.5f) * Height,
+                    v.z / w,
+                    1.0f);
+            }
+
+            RasterizePolygon(m_polygon);
+        }
+    }
+
+    void OcclusionCuller::RasterizePolygon(std::span<const vec4> polygon)
+    {
+        // Twice the signed area, either winding.
+        float area = 0.0f;
+        for (size_t i = 0; i < polygon.size(); i++)
+        {
+            const vec4& a = polygon[i];
+            const vec4& b = polygon[(i + 1) % polygon.size()];
+            area += a.x * b.y - b.x * a.y;
+        }
+        if (std::abs(area) < 1e-6f)
+            return;
+        float winding = area < 0.0f ? -1.0f : 1.0f;
+
+        vec2 lo = vec2(std::numeric_limits<float>::max());
+        vec2 hi = vec2(std::numeric_limits<float>::lowest());
+        for (const vec4& v : polygon)
+        {
+            lo = glm::min(lo, vec2(v));
+            hi = glm::max(hi, vec2(v));
+        }
+
+        int minX = std::max(int(std::floor(lo.x)), 0);
+        int maxX = std::min(int(std::ceil (hi.x)), int(Width) - 1);
+        int minY = std::max(int(std::floor(lo.y)), 0);
+        int maxY = std::min(int(std::ceil (hi.y)), int(Height) - 1);
+        if (minX > maxX || minY > maxY)
+            return;
+
+        m_stats.polygons++;
+
+        // Edge functions, positive inside: E(x, y) = A*x + B*y + C.
+        // Pulled in by half a pixel along each axis, so E >= 0 at a pixel's centre means the edge
+        // is clear of the whole pixel. Only pixels the polygon covers entirely are filled,
+        // a pixel it only grazes can't hide what's behind it.
+        m_edges.clear();
+        for (size_t i = 0; i < polygon.size(); i++)
+        {
+            const vec4& a = polygon[i];
+            const vec4& b = polygon[(i + 1) % polygon.size()];
+            float A = (a.y - b.y) * winding;
+            float B = (b.x - a.x) * winding;
+            float C = -(A * a.x + B * a.y);
+            m_edges.push_back(vec3(A, B, C - 0.5f * (std::abs(A) + std::abs(B))));
+        }
+
+        // Depth is affine in screen space over the whole (planar) polygon,
+        // take its plane from the biggest triangle of the fan.
+        size_t best = 2;
+        float bestArea = 0.0f;
+        for (size_t i = 2; i < polygon.size(); i++)
+        {
+            vec2 e1 = vec2(polygon[i - 1]) - vec2(polygon[0]);
+            vec2 e2 = vec2(polygon[i])     - vec2(polygon[0]);
+            float triArea = std::abs(e1.x * e2.y - e1.y * e2.x);
+            if (triArea > bestArea)
+            {
+                bestArea = triArea;
+                best = i;
+            }
+        }
+
+        vec3 v0 = vec3(polygon[0]), v1 = vec3(polygon[best - 1]), v2 = vec3(polygon[best]);
+        float triArea = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (std::abs(triArea) < 1e-6f)
+            return;
+
+        // Barycentrics from the triangle's own edge functions.
+        float inv = 1.0f / triArea;
+        float A0 = v1.y - v2.y, B0 = v2.x - v1.x, C0 = v1.x * v2.y - v2.x * v1.y;
+        float A1 = v2.y - v0.y, B1 = v0.x - v2.x, C1 = v2.x * v0.y - v0.x * v2.y;
+        float A2 = v0.y - v1.y, B2 = v1.x - v0.x, C2 = v0.x * v1.y - v1.x * v0.y;
+        float AZ = (A0 * v0.z + A1 * v1.z + A2 * v2.z) * inv;
+        float BZ = (B0 * v0.z + B1 * v1.z + B2 * v2.z) * inv;
+        float CZ = (C0 * v0.z + C1 * v1.z + C2 * v2.z) * inv;
+        // And the farthest depth within the pixel rather than at its centre, for the same reason.
+        CZ += 0.5f * (std::abs(AZ) + std::abs(BZ));
+
+        // 4 pixels at a time, branchless so the compiler can vectorize it. Plain scalar code, no intrinsics.
+        int startX = minX & ~3;
+        for (int y = minY; y <= maxY; y++)
+        {
+            float py = float(y) + 0.5f;
+            float* row = &m_depth[0][y * Width];
+
+            for (int x = startX; x <= maxX; x += 4)
+            {
+                float px[4], inside[4];
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    px[lane]     = float(x + lane) + 0.5f;
+                    inside[lane] = std::numeric_limits<float>::max();
+                }
+
+                for (const vec3& edge : m_edges)
+                {
+                    for (int lane = 0; lane < 4; lane++)
+                        inside[lane] = std::min(inside[lane], edge.x * px[lane] + edge.y * py + edge.z);
+                }
+
+                float* depth = row + x;
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    float z = AZ * px[lane] + BZ * py + CZ;
+                    depth[lane] = inside[lane] >= 0.0f ? std::min(depth[lane], z) : depth[lane];
+                }
+            }
+        }
+    }
+
+    void OcclusionCuller::Finish()
+    {
+        for (uint32_t level = 1; level < Levels; level++)
+        {
+            const std::vector<float>& src = m_depth[level - 1];
+            std::vector<float>& dst = m_depth[level];
+
+            uint32_t srcWidth  = LevelWidth(level - 1);
+            uint32_t srcHeight = LevelHeight(level - 1);
+            uint32_t width     = LevelWidth(level);
+            uint32_t height    = LevelHeight(level);
+
+            for (uint32_t y = 0; y < height; y++)
+            {
+                const float* row0 = &src[std::min(y * 2,     srcHeight - 1) * srcWidth];
+                const float* row1 = &src[std::min(y * 2 + 1, srcHeight - 1) * srcWidth];
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    uint32_t x0 = std::min(x * 2,     srcWidth - 1);
+                    uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+                    dst[y * width + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+                }
+            }
+        }
+    }
+
+    bool OcclusionCuller::Project(const AABB& bounds, ScreenRect& rect) const
+    {
+        rect.min = vec2(std::numeric_limits<float>::max());
+        rect.max = vec2(std::numeric_limits<float>::lowest());
+        rect.nearest = std::numeric_limits<float>::max();
+
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            vec3 corner = vec3(
+                (i & 1) ? bounds.max.x : bounds.min.x,
+                (i & 2) ? bounds.max.y : bounds.min.y,
+                (i & 4) ? bounds.max.z : bounds.min.z);
+
+            vec4 clip = m_viewProj * vec4(corner, 1.0f);
+            if (clip.z < 0.0f)
+            {
+                // Crosses the near plane, could be anywhere.
+                rect.min = vec2(0.0f);
+                rect.max = vec2(Width, Height);
+                rect.nearest = 0.0f;
+                return true;
+            }
+
+            vec2 screen = vec2(
+                (clip.x / clip.w *  0.5f + 0.5f) * Width,
+                (clip.y / clip.w * -0.5f + 0.5f) * Height);
+            rect.min = glm::min(rect.min, screen);
+            rect.max = glm::max(rect.max, screen);
+            rect.nearest = std::min(rect.nearest, clip.z / clip.w);
+        }
+
+        return rect.max.x >= 0.0f && rect.min.x <= float(Width)
+            && rect.max.y >= 0.0f && rect.min.y <= float(Height)
+            && rect.nearest <= 1.0f;
+    }
+
+    bool OcclusionCuller::IsVisible(const AABB& bounds)
+    {
+        m_stats.tested++;
+
+        ScreenRect rect;
+        if (!Project(bounds, rect))
+        {
+            m_stats.outside++;
+            return false;
+        }
+
+        // The level where the box is about 2 texels across, so only a few need reading.
+        float extent = std::max(rect.max.x - rect.min.x, rect.max.y - rect.min.y);
+        uint32_t level = extent > 2.0f ? uint32_t(std::ceil(std::log2(extent * 0.5f))) : 0;
+        level = std::min(level, Levels - 1);
+
+        int width  = int(LevelWidth(level));
+        int height = int(LevelHeight(level));
+        float scale = 1.0f / float(1u << level);
+
+        int x0 = std::clamp(int(std::floor(rect.min.x * scale)), 0, width - 1);
+        int x1 = std::clamp(int(std::floor(rect.max.x * scale)), 0, width - 1);
+        int y0 = std::clamp(int(std::floor(rect.min.y * scale)), 0, height - 1);
+        int y1 = std::clamp(int(std::floor(rect.max.y * scale)), 0, height - 1);
+
+        // Rasterized depth can come out a few ulps nearer than the box corners it was projected from,
+        // which would hide occluders behind themselves. Give boxes a little in their favour: a fraction of
+        // (1 - z), which is about proportional to 1 / distance, and a few ulps near 1 on top.
+        float nearest = rect.nearest - (1.0f - rect.nearest) * DepthBias - 8.0f * std::numeric_limits<float>::epsilon();
+
+        const std::vector<float>& depth = m_depth[level];
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                // The farthest occluder here is behind the box's nearest point, some of it could show.
+                if (depth[y * width + x] >= nearest)
+                {
+                    m_stats.visible++;
+                    return true;
+                }
+            }
+        }
+
+        m_stats.occluded++;
+        return false;
+    }
+}
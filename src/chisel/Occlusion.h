@@ -0,0 +1,88 @@
+#pragma once
+
+#include "math/Math.h"
+#include "math/AABB.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace chisel
+{
+    class Solid;
+
+    /**
+     * Software occlusion culling, all on the CPU.
+     *
+     * Big solids are rasterized into a small depth buffer, then boxes are tested against
+     * a max-depth pyramid of it: if every texel the box covers has an occluder in front of
+     * the box's nearest point, nothing in the box can be seen.
+     * Doesn't need a window or GPU, so it can be run on a map by itself.
+     */
+    class OcclusionCuller
+    {
+    public:
+        // Powers of two, Width a multiple of 4 so rows can be filled 4 pixels at a time.
+        static constexpr uint32_t Width  = 256;
+        static constexpr uint32_t Height = 128;
+        static constexpr uint32_t Levels = 8; // Down to 2x1
+        // Boxes count as this much nearer, relative to their distance, so occluders never hide themselves.
+        static constexpr float DepthBias = 1.0f / 1024.0f;
+
+        struct Stats
+        {
+            uint32_t occluders = 0;
+            uint32_t polygons  = 0;
+            uint32_t tested    = 0;
+            uint32_t visible   = 0;
+            uint32_t occluded  = 0; // Behind occluders
+            uint32_t outside   = 0; // Off screen
+        };
+
+        OcclusionCuller();
+
+        // Clears the depth buffer for a new view. viewProj takes world space to D3D clip space, depth 0 to 1.
+        void Begin(const mat4x4& viewProj);
+
+        // Rasterizes a solid's faces, see IsOccluder for which ones are worth it.
+        void AddOccluder(const Solid& solid);
+
+        // Builds the depth pyramid, call after the last occluder and before testing.
+        void Finish();
+
+        // False if the box is off screen or behind occluders.
+        bool IsVisible(const AABB& bounds);
+
+        const Stats& GetStats() const { return m_stats; }
+
+        // Opaque solids without displacements that are at least minSize across in two directions,
+        // so walls and floors but not pillars or trim.
+        static bool IsOccluder(const Solid& solid, float minSize);
+
+    private:
+        struct ScreenRect
+        {
+            vec2  min;
+            vec2  max;
+            float nearest;
+        };
+
+        // False if the box is entirely off screen. Boxes crossing the near plane cover the whole screen.
+        bool Project(const AABB& bounds, ScreenRect& rect) const;
+
+        // Convex, vertices in pixels with depth in z. Only fills pixels it covers entirely.
+        void RasterizePolygon(std::span<const vec4> polygon);
+
+        mat4x4 m_viewProj = mat4x4(1.0f);
+
+        // Level 0 is the nearest occluder depth of each pixel, each level after is the farthest of 2x2 of the last.
+        std::array<std::vector<float>, Levels> m_depth;
+
+        std::vector<vec4> m_clipped; // Scratch for clipping faces against the near plane
+        std::vector<vec4> m_polygon;
+        std::vector<vec3> m_edges;   // Of m_polygon, see RasterizePolygon
+
+        Stats m_stats;
+    };
+}
@@ -1,41 +1,90 @@
 #include "chisel/Selection.h"
+#include "chisel/Core.h"
+
+#include <cassert>
 
 namespace chisel
 {
-    SelectionID Selectable::s_nextID = 1;
+    Selectable::Selectable()
+        : m_registered(true)
+    {
+        // Make a new slot while there's room and few enough freed, so the same few don't cycle
+        // through their generations while something still holds an old ID (like the last frame's ID buffer).
+        uint32_t index = uint32_t(s_slots.size());
+        bool full = index > SelectionIDs::IndexMask;
+        if (!s_freeSlots.empty() && (full || s_freeSlots.size() >= FreeSlotDelay))
+        {
+            index = s_freeSlots.front();
+            s_freeSlots.pop_front();
+        }
+        else if (full)
+        {
+            Console.Error("[Selection] Out of selection IDs!");
+            index = 0;
+        }
+        else
+            s_slots.emplace_back();
 
-//-------------------------------------------------------------------------------------------------
+        Slot& slot = s_slots[index];
+        slot.object = index ? this : nullptr;
+        m_id = index ? SelectionIDs::Make(index, 0, slot.generation) : 0;
+    }
 
-    inline SelectionID Selectable::NextID()
+    Selectable::Selectable(SelectionID partID)
+        : m_id(partID)
     {
-        if (s_freeIDs.empty())
-            return s_nextID++;
-        
-        SelectionID id = s_freeIDs.top();
-        s_freeIDs.pop();
-        return id;
     }
 
-    Selectable::Selectable()
-        : m_id(NextID())
+    Selectable::Selectable(const Selectable& other)
+        : m_id(other.m_id)
     {
-        s_map.emplace(m_id, this);
+    }
+
+    Selectable& Selectable::operator=(const Selectable& other)
+    {
+        if (!m_registered)
+            m_id = other.m_id;
+        return *this;
     }
 
     Selectable::~Selectable()
     {
-        s_freeIDs.push(m_id);
         Selection.Unselect(this);
-        s_map.erase(m_id);
+
+        uint32_t index = SelectionIDs::Index(m_id);
+        if (!m_registered || !index)
+            return;
+
+        Slot& slot = s_slots[index];
+        if (slot.object != this)
+            return;
+
+        slot.object = nullptr;
+        slot.generation++;
+        s_freeSlots.push_back(index);
+    }
+
+    void Selectable::SetSelected(bool selected)
+    {
+        m_selected = selected;
+        SelectionChanged();
+        Core.SceneChanged();
     }
 
     /*static*/ Selectable* Selectable::Find(SelectionID id)
     {
-        auto iter = s_map.find(id);
-        if (iter == s_map.end())
+        uint32_t index = SelectionIDs::Index(id);
+        if (index == 0 || index >= s_slots.size())
             return nullptr;
 
-        return iter->second;
+        const Slot& slot = s_slots[index];
+        if (!slot.object || (slot.generation & SelectionIDs::GenerationMask) != SelectionIDs::Generation(id))
+            return nullptr;
+
+        if (uint32_t part = SelectionIDs::Part(id))
+            return slot.object->FindPart(part - 1);
+
+        return slot.object;
     }
 
 //-------------------------------------------------------------------------------------------------
@@ -58,8 +107,19 @@ namespace chisel
         while ((resolved = ent->ResolveSelectable()) != ent)
             ent = resolved;
 
+        if (ent->m_selected)
+            return;
+
         ent->SetSelected(true);
+        ent->m_selectionIndex = uint32_t(m_selection.size());
         m_selection.emplace_back(ent);
+
+        // Growing the bounds doesn't need a full rebuild.
+        if (!m_boundsDirty)
+        {
+            if (auto bounds = ent->GetBounds())
+                m_bounds = m_bounds ? AABB::Extend(*m_bounds, *bounds) : *bounds;
+        }
     }
 
     void Selection::Unselect(Selectable* ent)
@@ -71,9 +131,18 @@ namespace chisel
         while ((resolved = ent->ResolveSelectable()) != ent)
             ent = resolved;
 
+        if (!ent->m_selected)
+            return;
+
+        // Move the last one into the gap.
+        uint32_t index = ent->m_selectionIndex;
+        assert(index < m_selection.size() && m_selection[index] == ent);
+        m_selection[index] = m_selection.back();
+        m_selection[index]->m_selectionIndex = index;
+        m_selection.pop_back();
+
         ent->SetSelected(false);
-        if (m_selection.size() > 0)
-            std::erase(m_selection, ent);
+        m_boundsDirty = true;
     }
 
     void Selection::Toggle(Selectable* ent)
@@ -89,6 +158,9 @@ namespace chisel
         for (const auto& selected : m_selection)
             selected->SetSelected(false);
         m_selection.clear();
+
+        m_bounds = std::nullopt;
+        m_boundsDirty = false;
     }
 
     Selectable* Selection::Find(SelectionID id)
@@ -100,28 +172,56 @@ namespace chisel
 
     std::optional<AABB> Selection::GetBounds() const
     {
-        std::optional<AABB> bounds;
+        if (!m_boundsDirty)
+            return m_bounds;
+
+        m_bounds = std::nullopt;
         for (Selectable* selectable : m_selection)
         {
             auto selectedBounds = selectable->GetBounds();
             if (!selectedBounds)
                 continue;
 
-            bounds = bounds
-                ? AABB::Extend(*bounds, *selectedBounds)
+            m_bounds = m_bounds
+                ? AABB::Extend(*m_bounds, *selectedBounds)
                 : *selectedBounds;
         }
-        
-        return bounds;
+
+        m_boundsDirty = false;
+        return m_bounds;
     }
 
-    void Selection::Delete()
+    void Selection::Transform(const mat4x4& matrix)
     {
-        for (Selectable* s : m_selection)
+        for (auto* s : m_selection)
+            s->Transform(matrix);
+
+        // Translating the bounds is exact, anything else has to be rebuilt.
+        bool translation = mat3x3(matrix) == glm::identity<mat3x3>();
+        if (translation && m_bounds && !m_boundsDirty)
         {
-            s->Delete();
+            vec3 offset = matrix[3];
+            m_bounds = AABB{ m_bounds->min + offset, m_bounds->max + offset };
         }
+        else
+            m_boundsDirty = true;
+    }
+
+    void Selection::AlignToGrid(vec3 gridSize)
+    {
+        for (auto* s : m_selection)
+            s->AlignToGrid(gridSize);
+        m_boundsDirty = true;
+    }
+
+    void Selection::Delete()
+    {
+        // Deleting unselects, so don't iterate m_selection itself.
+        std::vector<Selectable*> selection = m_selection;
         Clear();
+
+        for (Selectable* s : selection)
+            s->Delete();
     }
 
     bool Selection::Duplicate()
@@ -135,6 +235,7 @@ namespace chisel
             {
                 s->SetSelected(false);
                 duplicated->SetSelected(true);
+                duplicated->m_selectionIndex = s->m_selectionIndex;
                 s = duplicated;
             }
             else
@@ -5,20 +5,67 @@
 
 #include "math/AABB.h"
 #include "math/Math.h"
+#include <algorithm>
+#include <deque>
 #include <optional>
-#include <unordered_map>
-#include <stack>
+#include <vector>
 
 namespace chisel
 {
     using SelectionID = uint32_t;
 
+    /**
+     * Selection IDs are what gets written to the object ID buffer for picking.
+     * They pack an index into a dense registry, the generation of that registry slot
+     * (so stale IDs find nothing), and a part number so that parts of an object,
+     * like a solid's faces, can derive their ID from their owner's without registering.
+     *
+     *     [generation:8][part:7][index:17]
+     *
+     * 17 bits covers Source's limits of 8192 brushes and entities many times over,
+     * and 7 gives every side of a 128 sided brush bar one its own ID.
+     * Freed slots wait in line behind a good number of others before they're reused (see FreeSlotDelay),
+     * so it takes hundreds of thousands of objects made and destroyed for an ID to come back around.
+     */
+    namespace SelectionIDs
+    {
+        inline constexpr uint32_t IndexBits      = 17;
+        inline constexpr uint32_t PartBits       = 7;
+        inline constexpr uint32_t IndexMask      = (1u << IndexBits) - 1;
+        inline constexpr uint32_t PartMask       = (1u << PartBits) - 1;
+        inline constexpr uint32_t GenerationMask = (1u << (32 - IndexBits - PartBits)) - 1;
+        inline constexpr uint32_t LastPart       = PartMask - 1;
+
+        inline uint32_t Index(SelectionID id)      { return id & IndexMask; }
+        inline uint32_t Part(SelectionID id)       { return (id >> IndexBits) & PartMask; }
+        inline uint32_t Generation(SelectionID id) { return id >> (IndexBits + PartBits); }
+
+        inline SelectionID Make(uint32_t index, uint32_t part, uint32_t generation)
+        {
+            return index | (part << IndexBits) | ((generation & GenerationMask) << (IndexBits + PartBits));
+        }
+
+        // The ID of part n of an object, e.g. the face for side n of a solid.
+        // Parts past LastPart share its ID.
+        inline SelectionID MakePart(SelectionID owner, uint32_t n)
+        {
+            return Make(Index(owner), std::min(n, LastPart) + 1, Generation(owner));
+        }
+    }
+
     class Selectable
     {
     public:
         Selectable();
         virtual ~Selectable();
 
+        // Copies share the ID but not the registration or selection, which stay with the original.
+        // Assigning keeps the target's selection, and its ID too if it registered one.
+        Selectable(const Selectable& other);
+        Selectable(Selectable&& other) : Selectable(static_cast<const Selectable&>(other)) {}
+        Selectable& operator=(const Selectable& other);
+        Selectable& operator=(Selectable&& other) { return *this = static_cast<const Selectable&>(other); }
+
         SelectionID GetSelectionID() const { return m_id; }
         virtual bool IsSelected() const { return m_selected; }
 
@@ -28,20 +75,38 @@ namespace chisel
         virtual void AlignToGrid(vec3 gridSize) = 0;
         virtual Selectable* Duplicate() = 0;
         virtual Selectable* ResolveSelectable() { return this; }
+
+        // Finds a part made with SelectionIDs::MakePart.
+        virtual Selectable* FindPart(uint32_t n) { return nullptr; }
     protected:
         friend class Selection;
 
-        void SetSelected(bool selected) { m_selected = selected; }
+        // For parts of another selectable. Takes an ID from SelectionIDs::MakePart
+        // instead of registering one.
+        explicit Selectable(SelectionID partID);
+
+        void SetSelected(bool selected);
+        // Called after being selected or unselected.
+        virtual void SelectionChanged() {}
         static Selectable* Find(SelectionID id);
     private:
-        static SelectionID s_nextID;
-        static inline std::unordered_map<SelectionID, Selectable*> s_map;
-        static inline std::stack<SelectionID> s_freeIDs;
+        struct Slot
+        {
+            Selectable* object = nullptr;
+            uint32_t    generation = 0;
+        };
+
+        // Freed slots are only reused once there are this many waiting, oldest first.
+        static constexpr size_t FreeSlotDelay = 1024;
 
-        static inline SelectionID NextID();
+        // Index 0 is never used, the ID buffer is cleared to 0.
+        static inline std::vector<Slot>     s_slots = std::vector<Slot>(1);
+        static inline std::deque<uint32_t>  s_freeSlots;
 
         SelectionID m_id = 0;
+        bool m_registered = false;
         bool m_selected = false;
+        uint32_t m_selectionIndex = 0; // In Selection, when selected
     };
 
     extern class Selection
@@ -64,13 +129,19 @@ namespace chisel
     public:
     // Selectable Interface //
 
+        // Cached, call InvalidateBounds after changing selected things some other way.
         std::optional<AABB> GetBounds() const;
-        void Transform(const mat4x4& matrix) { for (auto* s : m_selection) s->Transform(matrix); }
+        void Transform(const mat4x4& matrix);
         void Delete();
-        void AlignToGrid(vec3 gridSize) { for (auto* s : m_selection) s->AlignToGrid(gridSize); }
+        void AlignToGrid(vec3 gridSize);
         bool Duplicate();
 
+        void InvalidateBounds() { m_boundsDirty = true; }
+
     private:
         std::vector<Selectable*> m_selection;
+
+        mutable std::optional<AABB> m_bounds;
+        mutable bool m_boundsDirty = false;
     } Selection;
 }
\ No newline at end of file
@@ -2,7 +2,18 @@
 
 #include "../map/Solid.h"
 #include "../map/Map.h"
-#include "../Chisel.h"
+#include "../Core.h"
+#include "Formats.h"
+
+#include "common/Filesystem.h"
+#include "common/Profiler.h"
+#include "common/Parallel.h"
+#include "console/Console.h"
+
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <unordered_map>
 
 #include "zstd.h"
 
@@ -73,42 +84,68 @@ namespace chisel
         return value;
     }
 
-    static void AddSolid(BrushEntity& map, yyjson_val* entity_val)
+    // A solid decoded and clipped off the main thread, waiting to be merged into the map.
+    struct BoxSolid
+    {
+        std::vector<Side>        sides;     // Without materials
+        std::vector<const char*> materials; // One per side, owned by the yyjson doc
+        SolidWindings            windings;
+    };
+
+    using BoxMaterialCache = std::unordered_map<std::string_view, Rc<Material>>;
+
+    // Only reads from the immutable DOM, so this is safe to run on any thread.
+    static void DecodeSolid(yyjson_val* solid, BoxSolid& out)
     {
-        yyjson_val* solids = yyjson_obj_get(entity_val, "solids");
-        size_t solid_idx, solid_max;
-        yyjson_val* solid;
-        yyjson_arr_foreach(solids, solid_idx, solid_max, solid)
+        yyjson_val* sides = yyjson_obj_get(solid, "sides");
+        out.sides.reserve(yyjson_arr_size(sides));
+        out.materials.reserve(yyjson_arr_size(sides));
+
+        size_t side_idx, side_max;
+        yyjson_val* side;
+        yyjson_arr_foreach(sides, side_idx, side_max, side)
         {
-            std::vector<Side> sideData;
+            Side thisSide{};
+            thisSide.plane = ReadPlane(yyjson_obj_get(side, "plane"));
+            thisSide.textureAxes = ReadTextureAxis(yyjson_obj_get(side, "texture_axis"));
+            thisSide.scale = ReadTextureScale(yyjson_obj_get(side, "scale"));
+            thisSide.rotate = yyjson_get_real(yyjson_obj_get(side, "rotate"));
+            thisSide.lightmapScale = yyjson_get_real(yyjson_obj_get(side, "lightmap_scale"));
+            thisSide.smoothing = yyjson_get_int(yyjson_obj_get(side, "smoothing_groups"));
+
+            out.sides.emplace_back(thisSide);
+            out.materials.push_back(yyjson_get_str(yyjson_obj_get(side, "material")));
+        }
+
+        Solid::ClipSides(out.sides, out.windings);
+    }
 
-            yyjson_val* sides = yyjson_obj_get(solid, "sides");
-            size_t side_idx, side_max;
-            yyjson_val* side;
-            yyjson_arr_foreach(sides, side_idx, side_max, side)
+    // Main thread only: loads materials and creates the solids and faces.
+    static void AddSolids(BrushEntity& ent, std::span<BoxSolid> solids, BoxMaterialCache& materials, std::vector<Solid*>& added)
+    {
+        for (BoxSolid& decoded : solids)
+        {
+            for (size_t i = 0; i < decoded.sides.size(); i++)
             {
-                Side thisSide{};
-                thisSide.plane = ReadPlane(yyjson_obj_get(side, "plane"));
-                thisSide.material = Assets.Load<Material>(yyjson_get_str(yyjson_obj_get(side, "material")));
-                thisSide.textureAxes = ReadTextureAxis(yyjson_obj_get(side, "texture_axis"));
-                thisSide.scale = ReadTextureScale(yyjson_obj_get(side, "scale"));
-                thisSide.rotate = yyjson_get_real(yyjson_obj_get(side, "rotate"));
-                thisSide.lightmapScale = yyjson_get_real(yyjson_obj_get(side, "lightmap_scale"));
-                thisSide.smoothing = yyjson_get_int(yyjson_obj_get(side, "smoothing_groups"));
-
-                sideData.emplace_back(thisSide);
+                const char* name = decoded.materials[i];
+                if (!name)
+                    continue;
+
+                auto [it, inserted] = materials.try_emplace(name);
+                if (inserted)
+                    it->second = Assets.Load<Material>(name);
+                decoded.sides[i].material = it->second;
             }
 
-            auto& brush = map.AddBrush(std::move(sideData));
-            brush.UpdateMesh();
-            sideData.clear();
+            Solid& brush = ent.AddBrush(std::move(decoded.sides), false);
+            brush.UpdateFaces(decoded.windings);
+            added.push_back(&brush);
         }
     }
 
-    static void AddEntity(Map& map, yyjson_val* entity_val)
+    static void AddEntity(Map& map, yyjson_val* entity_val, std::span<BoxSolid> solids, BoxMaterialCache& materials, std::vector<Solid*>& added)
     {
-        yyjson_val* solids = yyjson_obj_get(entity_val, "solids");
-        bool point = solids == nullptr;
+        bool point = yyjson_obj_get(entity_val, "solids") == nullptr;
         Entity* entity = nullptr;
         if (point)
         {
@@ -118,7 +155,7 @@ namespace chisel
         else
         {
             BrushEntity* brush = new BrushEntity(&map);
-            AddSolid(*brush, entity_val);
+            AddSolids(*brush, solids, materials, added);
             entity = brush;
         }
 
@@ -172,6 +209,7 @@ namespace chisel
                     abort();
                 }
             }
+            entity->ParseKeyValues();
         }
 
         map.AddEntity(entity);
@@ -179,6 +217,8 @@ namespace chisel
 
     bool ImportBox(std::string_view filepath, Map& map)
     {
+        PROFILE_SCOPE("ImportBox");
+
         auto file = fs::readFile(filepath);
         if (!file)
             return false;
@@ -197,23 +237,70 @@ namespace chisel
         const char* json = raw_data ? (const char*)raw_data.get() : (const char *) file->data();
         size_t json_size = raw_data ? raw_size : file->size();
 
-        Chisel.brushAllocator->open();
-
         yyjson_doc* doc = yyjson_read(json, json_size, 0);
+        if (!doc)
+            return false;
 
         yyjson_val* root = yyjson_doc_get_root(doc);
         yyjson_val* world = yyjson_obj_get(root, "world");
-        AddSolid(map, world);
-
         yyjson_val* entities = yyjson_obj_get(world, "entities");
+
+        // Gather every solid in file order, world first.
+        // Entity i owns solids [firstSolid[i], firstSolid[i + 1]).
+        std::vector<yyjson_val*> solidVals;
+        std::vector<size_t> firstSolid;
+        firstSolid.reserve(yyjson_arr_size(entities) + 2);
+
+        auto GatherSolids = [&](yyjson_val* entity_val)
+        {
+            firstSolid.push_back(solidVals.size());
+
+            yyjson_val* solids = yyjson_obj_get(entity_val, "solids");
+            size_t solid_idx, solid_max;
+            yyjson_val* solid;
+            yyjson_arr_foreach(solids, solid_idx, solid_max, solid)
+            {
+                solidVals.push_back(solid);
+            }
+        };
+
+        GatherSolids(world);
+
         size_t entity_idx, entity_max;
         yyjson_val* entity;
         yyjson_arr_foreach(entities, entity_idx, entity_max, entity)
         {
-            AddEntity(map, entity);
+            GatherSolids(entity);
+        }
+        firstSolid.push_back(solidVals.size());
+
+        // Decode and clip solids in parallel...
+        std::vector<BoxSolid> decoded(solidVals.size());
+        ParallelFor(solidVals.size(), [&](size_t i) {
+            DecodeSolid(solidVals[i], decoded[i]);
+        });
+
+        auto SolidsOf = [&](size_t i) {
+            return std::span(decoded).subspan(firstSolid[i], firstSolid[i + 1] - firstSolid[i]);
+        };
+
+        // ...then merge them into the map in order.
+        BoxMaterialCache materials;
+        std::vector<Solid*> added;
+        added.reserve(decoded.size());
+
+        AddSolids(map, SolidsOf(0), materials, added);
+
+        yyjson_arr_foreach(entities, entity_idx, entity_max, entity)
+        {
+            AddEntity(map, entity, SolidsOf(entity_idx + 1), materials, added);
         }
 
-        Chisel.brushAllocator->close();
+        // Upload everything in one go.
+        Core.brushAllocator->open();
+        for (Solid* solid : added)
+            solid->UpdateMeshes();
+        Core.brushAllocator->close();
 
         yyjson_doc_free(doc);
         return true;
@@ -398,7 +485,7 @@ namespace chisel
 
         // Now write the individual entities
         yyjson_mut_val *ent_arr = yyjson_mut_arr(doc);
-        for (Entity* ent : map.Entities())
+        for (Entity* ent : map.EntitiesInOrder())
         {
             yyjson_mut_val* ent_val = yyjson_mut_arr_add_obj(doc, ent_arr);
             if (ent->IsBrushEntity())
@@ -415,6 +502,8 @@ namespace chisel
 
     bool ExportBox(std::string_view filepath, Map& map)
     {
+        PROFILE_SCOPE("ExportBox");
+
         std::string path_string = std::string(filepath);
         FILE* file = fopen(path_string.c_str(), "wb");
         if (!file)
@@ -1,4 +1,8 @@
-#include "../Chisel.h"
+#include "../map/Map.h"
+#include "Formats.h"
+#include "common/Profiler.h"
+
+#include <fstream>
 
 namespace chisel
 {
@@ -93,7 +97,7 @@ namespace chisel
         out << "}\n";
 
         // Now write the individual entities
-        for (Entity* ent : map.Entities())
+        for (Entity* ent : map.EntitiesInOrder())
         {
             out << "{\n";
 
@@ -112,6 +116,8 @@ namespace chisel
 
     bool ExportMap(std::string_view filepath, Map& map)
     {
+        PROFILE_SCOPE("ExportMap");
+
         std::ofstream out = std::ofstream(std::string(filepath));
         if (out.bad())
         {
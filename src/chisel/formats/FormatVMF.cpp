@@ -1,5 +1,15 @@
-#include "../Chisel.h"
+#include "../Core.h"
 #include "../FGD/FGD.h"
+#include "../map/Map.h"
+#include "Formats.h"
+
+#include "common/Filesystem.h"
+#include "common/Parse.h"
+#include "common/Profiler.h"
+#include "common/String.h"
+#include "console/Console.h"
+
+#include <fstream>
 
 namespace chisel
 {
@@ -20,6 +30,25 @@ namespace chisel
         out << "\"" << key << "\"" << ' ' << "\"" << tmp << "\"\n";
     }
 
+    // Writes a block of raw keyvalues as-is, except for giving ids fresh values
+    static void WriteKeyValues(std::ofstream& out, std::string_view name, const kv::KeyValues& kv)
+    {
+        out << name << "\n";
+        out << "{\n";
+
+        for (const auto& [key, value] : kv)
+        {
+            if (value.GetType() == kv::Types::KeyValues)
+                WriteKeyValues(out, key, (kv::KeyValues&)value);
+            else if (key == "id")
+                WriteKVPair(out, "id", "%u", s_VMFUniqueID++);
+            else
+                WriteKVPair(out, key, (std::string_view)value);
+        }
+
+        out << "}\n";
+    }
+
     // Writes all KV pairs in an entity, including classname and targetname
     static void WriteEntityKVPairs(std::ofstream& out, const Entity& entity)
     {
@@ -120,6 +149,10 @@ namespace chisel
 
             out << "}\n";
         }
+
+        // Solids outside of the loaded region go back out the way they came in
+        for (const auto& solid : entity.DormantBrushes())
+            WriteKeyValues(out, "solid", *solid);
     }
 
     static void WriteMap(std::ofstream& out, Map& map)
@@ -134,7 +167,7 @@ namespace chisel
         out << "}\n";
 
         // Now write the individual entities
-        for (Entity* ent : map.Entities())
+        for (Entity* ent : map.EntitiesInOrder())
         {
             out << "entity\n";
             out << "{\n";
@@ -154,6 +187,8 @@ namespace chisel
 
     bool ExportVMF(std::string_view filepath, Map& map)
     {
+        PROFILE_SCOPE("ExportVMF");
+
         s_VMFUniqueID = 0;
 
         std::ofstream out = std::ofstream(std::string(filepath));
@@ -166,19 +201,22 @@ namespace chisel
         return true;
     }
 
-    static Plane ParsePlane(std::string_view string)
+    static std::array<vec3, 3> ParsePlanePoints(std::string_view string)
     {
         auto points = str::split(string, ")");
 
         std::array<vec3, 3> pointTrio{};
         // Parse points
-        for (int i = 0; i < 3; i++)
+        for (int i = 0; i < 3 && i < points.size(); i++)
         {
             // TODO: Why can't we remove the '(' with str::trim
             auto xyz = str::trim(points[i]);
             xyz.remove_prefix(1);
 
             auto coords = str::split(xyz, " ");
+            if (coords.size() < 3)
+                continue;
+
             float x = stream::ParseSimple<float>(coords[0]);
             float y = stream::ParseSimple<float>(coords[1]);
             float z = stream::ParseSimple<float>(coords[2]);
@@ -186,6 +224,12 @@ namespace chisel
             pointTrio[i] = vec3(x, y, z);
         }
 
+        return pointTrio;
+    }
+
+    static Plane ParsePlane(std::string_view string)
+    {
+        auto pointTrio = ParsePlanePoints(string);
         return Plane(pointTrio[0], pointTrio[1], pointTrio[2]);
     }
 
@@ -244,7 +288,7 @@ namespace chisel
         field.resize(obj.ChildCount());
         for (auto& [key, value] : obj)
         {
-            int i = key[3] - '0';
+            int i = key.str()[3] - '0';
             field[i] = ParseRow1(value);
         }
         return field;
@@ -256,52 +300,53 @@ namespace chisel
         field.resize(obj.ChildCount());
         for (auto& [key, value] : obj)
         {
-            int i = key[3] - '0';
+            int i = key.str()[3] - '0';
             field[i] = ParseRow3(value);
         }
         return field;
     }
 
 
-    static bool AddSolid(BrushEntity& map, kv::KeyValues& kvWorld, std::string& matNameScratch)
+    static void AddSolid(BrushEntity& ent, kv::KeyValues& kvSolid, std::string& matNameScratch)
     {
         std::vector<Side> sideData;
 
-        auto solids = kvWorld.FindAll("solid");
-        while (solids.first != solids.second)
+        auto sides = kvSolid.FindAll("side");
+        while (sides.first != sides.second)
         {
-            auto& solid = solids.first->second;
-            if (solid.GetType() != kv::Types::KeyValues)
-                return false;
-
-            kv::KeyValues& kvSolid = (kv::KeyValues&)solid;
-            auto sides = kvSolid.FindAll("side");
-            sideData.clear();
-            while (sides.first != sides.second)
+            auto& side = sides.first->second;
+            if (side.GetType() != kv::Types::KeyValues)
             {
-                auto& side = sides.first->second;
-                if (side.GetType() != kv::Types::KeyValues)
-                    return false;
+                sides.first++;
+                continue;
+            }
 
-                kv::KeyValues& kvSide = (kv::KeyValues&)side;
+            kv::KeyValues& kvSide = (kv::KeyValues&)side;
 
-                Side thisSide{};
-                thisSide.plane = ParsePlane(kvSide["plane"]);
-                matNameScratch = "materials/";
-                matNameScratch += (std::string_view)kvSide["material"];
-                matNameScratch += ".vmt";
+            Side thisSide{};
+            thisSide.plane = ParsePlane(kvSide["plane"]);
+            matNameScratch = "materials/";
+            matNameScratch += (std::string_view)kvSide["material"];
+            matNameScratch += ".vmt";
 
-                thisSide.material = Assets.Load<Material>(matNameScratch);
-                ParseAxis(kvSide["uaxis"], thisSide.textureAxes[0], thisSide.scale[0]);
-                ParseAxis(kvSide["vaxis"], thisSide.textureAxes[1], thisSide.scale[1]);
-                thisSide.rotate = kvSide["rotate"];
-                thisSide.lightmapScale = kvSide["lightmapscale"];
-                thisSide.smoothing = kvSide["smoothing_groups"];
+            thisSide.material = Assets.Load<Material>(matNameScratch);
+            ParseAxis(kvSide["uaxis"], thisSide.textureAxes[0], thisSide.scale[0]);
+            ParseAxis(kvSide["vaxis"], thisSide.textureAxes[1], thisSide.scale[1]);
+            thisSide.rotate = kvSide["rotate"];
+            thisSide.lightmapScale = kvSide["lightmapscale"];
+            thisSide.smoothing = kvSide["smoothing_groups"];
 
-                if (kvSide.Contains("dispinfo"))
+            if (kvSide.Contains("dispinfo"))
+            {
+                kv::KeyValues& kvDisp = kvSide["dispinfo"];
+                int power = kvDisp["power"];
+                if (!IsValidDispPower(power))
+                {
+                    Console.Warn("Ignoring displacement with power {}, only {} to {} are supported", power, DispMinPower, DispMaxPower);
+                }
+                else
                 {
-                    kv::KeyValues& kvDisp = kvSide["dispinfo"];
-                    thisSide.disp.emplace(int(kvDisp["power"]));
+                    thisSide.disp.emplace(power);
                     thisSide.disp->startPos = kvDisp["startposition"];
                     thisSide.disp->elevation = kvDisp["elevation"];
                     thisSide.disp->subdiv = kvDisp["subdiv"];
@@ -328,15 +373,107 @@ namespace chisel
                         }
                     }
                 }
+            }
 
-                sideData.emplace_back(thisSide);
+            sideData.emplace_back(thisSide);
 
-                sides.first++;
+            sides.first++;
+        }
+
+        ent.AddBrush(std::move(sideData));
+    }
+
+    // Checks if an object's editor block puts it in the given visgroup
+    static bool InVisgroup(kv::KeyValues& kvObject, int visgroup)
+    {
+        kv::KeyValues& kvEditor = kvObject["editor"];
+        auto ids = kvEditor.FindAll("visgroupid");
+        for (auto it = ids.first; it != ids.second; ++it)
+        {
+            if (int(it->second) == visgroup)
+                return true;
+        }
+        return false;
+    }
+
+    // Cheap region test for a solid, without doing any CSG:
+    // the three points of each side's plane lie on that face of the solid.
+    static bool SolidInRegion(kv::KeyValues& kvSolid, const MapRegion& region)
+    {
+        if (region.visgroup && !InVisgroup(kvSolid, *region.visgroup))
+            return false;
+
+        if (!region.bounds)
+            return true;
+
+        std::optional<AABB> bounds;
+        auto sides = kvSolid.FindAll("side");
+        for (auto it = sides.first; it != sides.second; ++it)
+        {
+            if (it->second.GetType() != kv::Types::KeyValues)
+                continue;
+
+            kv::KeyValues& kvSide = (kv::KeyValues&)it->second;
+            for (vec3 point : ParsePlanePoints(kvSide["plane"]))
+            {
+                bounds = bounds
+                    ? AABB::Extend(*bounds, point)
+                    : AABB{ point, point };
             }
+        }
+
+        return bounds && region.bounds->Intersects(*bounds);
+    }
+
+    static bool EntityInRegion(kv::KeyValues& kvEntity, const MapRegion& region)
+    {
+        if (region.entity.empty())
+            return true;
+
+        return kv::KeyEqual(region.entity, kvEntity["classname"])
+            || kv::KeyEqual(region.entity, kvEntity["targetname"]);
+    }
 
-            auto& brush = map.AddBrush(std::move(sideData));
-            brush.UpdateMesh();
-            sideData.clear();
+    static bool PointInRegion(kv::KeyValues& kvEntity, const MapRegion& region)
+    {
+        if (!EntityInRegion(kvEntity, region))
+            return false;
+
+        if (region.visgroup && !InVisgroup(kvEntity, *region.visgroup))
+            return false;
+
+        if (region.bounds)
+        {
+            vec3 origin = kvEntity["origin"];
+            if (!region.bounds->Intersects(AABB{ origin, origin }))
+                return false;
+        }
+
+        return true;
+    }
+
+    static bool AddSolids(BrushEntity& ent, kv::KeyValues& kvEntity, std::string& matNameScratch, const MapRegion& region)
+    {
+        bool entityInRegion = EntityInRegion(kvEntity, region);
+
+        auto solids = kvEntity.FindAll("solid");
+        while (solids.first != solids.second)
+        {
+            auto& solid = solids.first->second;
+            if (solid.GetType() != kv::Types::KeyValues)
+                return false;
+
+            kv::KeyValues& kvSolid = (kv::KeyValues&)solid;
+            if (region.Empty() || (entityInRegion && SolidInRegion(kvSolid, region)))
+            {
+                AddSolid(ent, kvSolid, matNameScratch);
+            }
+            else
+            {
+                // Steal the raw keyvalues, they get removed from the entity anyway.
+                auto* child = solid.GetPtr<kv::KeyValuesVariant::KeyValuesChild>(kv::Types::KeyValues);
+                ent.AddDormantBrush(std::move(*child));
+            }
 
             solids.first++;
         }
@@ -355,24 +492,28 @@ namespace chisel
         kvEntity.RemoveAllWithType("editor", kv::Types::KeyValues);
         kvEntity.RemoveAllWithType("solid", kv::Types::KeyValues);
         entity->kv = std::move(kvEntity);
+        entity->ParseKeyValues();
         if (entity != &map)
             map.AddEntity(entity);
         return true;
     }
 
-    static bool CreateEntity(Map& map, kv::KeyValues& kvEntity, std::string& matNameScratch)
+    static bool CreateEntity(Map& map, kv::KeyValues& kvEntity, std::string& matNameScratch, const MapRegion& region)
     {
         auto solids = kvEntity.FindAll("solid");
         std::string classname = std::string(kvEntity["classname"]);
         // Solid can also be the vphysics solid type.
         // Really annoying.
         bool point = solids.first == solids.second || solids.first->second.GetType() != kv::Types::KeyValues;
-        bool prop = Chisel.fgd->classes.contains(classname) && Chisel.fgd->classes[classname].isProp;
+        bool prop = Core.fgd && Core.fgd->classes.contains(classname) && Core.fgd->classes[classname].isProp;
         Entity* entity = nullptr;
         if (point && prop)
         {
             ModelEntity* model = new ModelEntity(&map);
-            model->model = Assets.Load<Mesh>((std::string)kvEntity["model"]);
+            // Only load models for what's in the region.
+            // The model key stays in the kv either way.
+            if (region.Empty() || PointInRegion(kvEntity, region))
+                model->model = Assets.Load<Mesh>((std::string)kvEntity["model"]);
             entity = model;
         }
         else if (point)
@@ -383,15 +524,17 @@ namespace chisel
         else
         {
             BrushEntity* brush = new BrushEntity(&map);
-            AddSolid(*brush, kvEntity, matNameScratch);
+            AddSolids(*brush, kvEntity, matNameScratch, region);
             entity = brush;
         }
 
         return AddEntity(map, entity, kvEntity);
     }
 
-    bool ImportVMF(std::string_view filepath, Map& map)
+    bool ImportVMF(std::string_view filepath, Map& map, const MapRegion& region)
     {
+        PROFILE_SCOPE("ImportVMF");
+
         auto text = fs::readTextFile(filepath);
         if (!text)
             return false;
@@ -405,14 +548,16 @@ namespace chisel
             return false;
 
         // Add solids.
-        Chisel.brushAllocator->open();
+        Core.brushAllocator->open();
         {
             std::string matname;
             kv::KeyValues& kvWorld = (kv::KeyValues&)world;
+            AddSolids(map, kvWorld, matname, region);
+
             // TODO: Do we want to parse the other "worldspawn" KVs?
             if (!AddEntity(map, &map, kvWorld))
             {
-                Chisel.brushAllocator->close();
+                Core.brushAllocator->close();
                 return false;
             }
 
@@ -424,20 +569,36 @@ namespace chisel
                     return false;
 
                 kv::KeyValues& kvEntity = (kv::KeyValues&)entity;
-                if (!CreateEntity(map, kvEntity, matname))
+                if (!CreateEntity(map, kvEntity, matname, region))
                 {
-                    Chisel.brushAllocator->close();
+                    Core.brushAllocator->close();
                     return false;
                 }
 
                 entities.first++;
             }
         }
-        Chisel.brushAllocator->close();
+        Core.brushAllocator->close();
 
         // TODO: Load cameras...
 
         return true;
     }
 
+    void LoadDormantSolids(Map& map)
+    {
+        std::string matname;
+        auto Load = [&](BrushEntity& ent)
+        {
+            for (auto& kvSolid : ent.TakeDormantBrushes())
+                AddSolid(ent, *kvSolid, matname);
+        };
+
+        Core.brushAllocator->open();
+        Load(map);
+        for (BrushEntity* ent : map.BrushEntities())
+            Load(*ent);
+        Core.brushAllocator->close();
+    }
+
 }
@@ -1,11 +1,39 @@
 #pragma once
 
+#include "math/AABB.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
 namespace chisel
 {
+    class Map;
+
+    /**
+     * Restricts which part of a map gets fully loaded.
+     * Solids outside of the region are kept as the raw data they were read
+     * from: no CSG, no mesh, no GPU memory and no material loads.
+     * They are written back untouched on save.
+     * An empty region loads everything.
+     */
+    struct MapRegion
+    {
+        std::optional<AABB> bounds;     // Solids/entities intersecting this box
+        std::optional<int>  visgroup;   // Solids/entities in this visgroup
+        std::string         entity;     // Brush/point entities with this classname or targetname
+
+        bool Empty() const { return !bounds && !visgroup && entity.empty(); }
+    };
+
     bool ExportBox(std::string_view filepath, Map& map);
     bool ExportMap(std::string_view filepath, Map& map);
     bool ExportVMF(std::string_view filepath, Map& map);
 
     bool ImportBox(std::string_view filepath, Map& map);
-    bool ImportVMF(std::string_view filepath, Map& map);
+    bool ImportVMF(std::string_view filepath, Map& map, const MapRegion& region = {});
+
+    // Fully loads any solids that were left out by a MapRegion.
+    // Needed before saving to a format other than the one they were read from.
+    void LoadDormantSolids(Map& map);
 }
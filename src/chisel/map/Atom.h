@@ -3,14 +3,28 @@
 #include "Types.h"
 #include "../Selection.h"
 
+#include <cstdint>
+#include <unordered_map>
+
 namespace chisel
 {
+    using AtomID = uint32_t;
+
     class Atom : public Selectable
     {
     public:
         Atom(BrushEntity* parent)
             : m_parent(parent)
+            , m_atomID(s_nextAtomID++)
+        {
+            s_atoms[m_atomID] = this;
+        }
+
+        ~Atom()
         {
+            auto iter = s_atoms.find(m_atomID);
+            if (iter != s_atoms.end() && iter->second == this)
+                s_atoms.erase(iter);
         }
 
         BrushEntity *GetParent() const
@@ -18,8 +32,38 @@ namespace chisel
             return m_parent;
         }
 
+        // Unlike selection IDs these are never reused, so the undo history
+        // can refer to atoms that have since been deleted and restored.
+        AtomID GetAtomID() const { return m_atomID; }
+
+        // Takes over an existing ID, e.g. when restoring a deleted atom.
+        void SetAtomID(AtomID id)
+        {
+            auto iter = s_atoms.find(m_atomID);
+            if (iter != s_atoms.end() && iter->second == this)
+                s_atoms.erase(iter);
+
+            m_atomID = id;
+            s_atoms[m_atomID] = this;
+        }
+
+        static Atom* FindAtom(AtomID id)
+        {
+            auto iter = s_atoms.find(id);
+            if (iter == s_atoms.end())
+                return nullptr;
+
+            return iter->second;
+        }
+
     protected:
         BrushEntity* m_parent;
+
+    private:
+        AtomID m_atomID;
+
+        static inline AtomID s_nextAtomID = 1;
+        static inline std::unordered_map<AtomID, Atom*> s_atoms;
     };
 
 }
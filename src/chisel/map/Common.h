@@ -6,6 +6,9 @@
 
 #include "../submodules/OffsetAllocator/offsetAllocator.hpp"
 
+#include <algorithm>
+#include <vector>
+
 namespace chisel
 {
     template <typename T>
@@ -49,81 +52,126 @@ namespace chisel
             VertexAttribute::For<uint>(1, VertexAttribute::Indices),
         };
     };
-    
-    struct BrushGPUAllocator
-    {
-    public:
-        static constexpr uint32_t BufferSize = 256 * 1024 * 1024; // 256 mb
-        static constexpr uint32_t MaxAllocations = 65535 * 4;
 
-        using Allocation = OffsetAllocator::Allocation;
-        
-        BrushGPUAllocator(render::RenderContext& rctx)
-            : m_rctx     (rctx)
-            , m_allocator(BufferSize, MaxAllocations)
+    /**
+     * Compact brush vertex, uploaded instead of VertexSolid with r_brush_packed_vertices.
+     * The normal is octahedral encoded and displacement alpha is 8 bit.
+     * The face ID is rebuilt in the shader from BrushState::faceBase plus the vertex's part.
+     */
+    struct VertexSolidPacked
+    {
+        vec3     position;
+        vec2     uv;
+        int16_t  normal[2];
+        uint8_t  part;  // See SelectionIDs::MakePart
+        uint8_t  alpha;
+        uint8_t  padding[2];
+
+        static inline D3D11_INPUT_ELEMENT_DESC InputLayout[] =
         {
-            D3D11_BUFFER_DESC desc
-            {
-                .ByteWidth      = BufferSize,
-                .Usage          = D3D11_USAGE_DYNAMIC,
-                .BindFlags      = D3D11_BIND_VERTEX_BUFFER,
-                .CPUAccessFlags = D3D11_CPU_ACCESS_WRITE,
-            };
-            m_rctx.device->CreateBuffer(&desc, nullptr, &m_buffer);
-        }
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,                            D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        };
 
-        void open()
+        static inline const VertexLayout Layout =
         {
-            if (m_refs++ == 0)
-            {
-                assert(m_base == nullptr);
-
-                D3D11_MAPPED_SUBRESOURCE mapped;
-                HRESULT hr = m_rctx.ctx->Map(m_buffer.ptr(), 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped);
-                if (FAILED(hr))
-                {
-                    abort();
-                }
-                m_base = (uint8_t*)mapped.pData;
-            }
-        }
-
-        void close()
+            VertexAttribute::For<float>(3, VertexAttribute::Position),
+            VertexAttribute::For<float>(2, VertexAttribute::TexCoord),
+            VertexAttribute::For<int16_t>(2, VertexAttribute::Normal, true),
+            VertexAttribute::For<uint8_t>(4, VertexAttribute::Indices),
+        };
+    };
+    static_assert(sizeof(VertexSolidPacked) == 28);
+    
+    /**
+     * Storage for brush vertices and indices.
+     * Solids write their meshes into it between open() and close().
+     * Storage may be split into several pages, each allocation lives in one.
+     */
+    struct BrushAllocator
+    {
+        struct Allocation : OffsetAllocator::Allocation
         {
-            if (--m_refs == 0)
-            {
-                assert(m_base != nullptr);
-                m_rctx.ctx->Unmap(m_buffer.ptr(), 0);
-                m_base = nullptr;
-            }
-        }
+            uint32_t page = 0;
+        };
 
-        uint8_t* data()
+        struct Stats
         {
-            assert(m_base != nullptr);
-            return m_base;
-        }
+            uint32_t pages       = 0;
+            size_t   capacity    = 0;
+            size_t   used        = 0;
+            size_t   free        = 0;
+            size_t   largestFree = 0; // Biggest allocation that fits without adding a page
+            size_t   pendingFree = 0; // Freed, waiting for the GPU to be done with it
+        };
+
+        virtual ~BrushAllocator() {}
 
-        Allocation alloc(uint32_t size)
+        virtual void open() = 0;
+        virtual void close() = 0;
+        // nullptr if the page couldn't be written to.
+        virtual uint8_t* data(uint32_t page) = 0;
+
+        // offset is NO_SPACE on failure.
+        virtual Allocation alloc(uint32_t size) = 0;
+        virtual void free(Allocation alloc) = 0;
+
+        virtual Stats stats() const = 0;
+    };
+
+    /**
+     * CPU-only brush storage, for running without a renderer.
+     */
+    struct NullBrushAllocator final : BrushAllocator
+    {
+        static constexpr uint32_t BufferSize = 256 * 1024 * 1024; // 256 mb
+        static constexpr uint32_t MaxAllocations = 65535 * 4;
+
+        NullBrushAllocator()
+            : m_allocator(BufferSize, MaxAllocations)
+        {}
+
+        void open() final override {}
+        void close() final override {}
+        uint8_t* data(uint32_t page) final override { return m_data.data(); }
+
+        Allocation alloc(uint32_t size) final override
         {
-            return m_allocator.allocate(size);
+            Allocation allocation = { m_allocator.allocate(size) };
+            if (allocation.offset != Allocation::NO_SPACE && allocation.offset + size > m_data.size())
+                m_data.resize(std::max<size_t>(allocation.offset + size, m_data.size() * 2));
+            if (allocation.offset != Allocation::NO_SPACE)
+                m_used += m_allocator.allocationSize(allocation);
+            return allocation;
         }
 
-        void free(Allocation alloc)
+        void free(Allocation alloc) final override
         {
+            m_used -= m_allocator.allocationSize(alloc);
             m_allocator.free(alloc);
         }
 
-        render::RenderContext& rctx() const { return m_rctx; }
+        Stats stats() const final override
+        {
+            OffsetAllocator::StorageReport report = m_allocator.storageReport();
+            return Stats
+            {
+                .pages       = 1,
+                .capacity    = BufferSize,
+                .used        = m_used,
+                .free        = report.totalFreeSpace,
+                .largestFree = report.largestFreeRegion,
+            };
+        }
 
-        ID3D11Buffer* buffer() const { return m_buffer.ptr(); }
+        // Bytes actually backed by memory
+        size_t size() const { return m_data.size(); }
 
     private:
-        render::RenderContext&     m_rctx;
         OffsetAllocator::Allocator m_allocator;
-
-        Com<ID3D11Buffer>          m_buffer;
-        uint8_t*                   m_base = nullptr;
-        uint32_t                   m_refs = 0;
+        std::vector<uint8_t>       m_data;
+        size_t                     m_used = 0;
     };
 }
@@ -0,0 +1,199 @@
+#include "chisel/map/Displacement.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace chisel
+{
+    static DispIndexPattern BuildDispIndexPattern(int power)
+    {
+        DispIndexPattern pattern;
+
+        uint32_t length = (1u << power) + 1;
+        for (int lod = 0; lod < int(DispMaxLODs) && (lod == 0 || power - lod >= 1); lod++)
+        {
+            uint32_t step  = 1u << lod;
+            uint32_t quads = (length - 1) / step;
+
+            DispLOD& range = pattern.lods[pattern.lodCount++];
+            range.firstIndex = uint32_t(pattern.indices.size());
+            range.indexCount = quads * quads * 6;
+
+            size_t first = pattern.indices.size();
+            pattern.indices.resize(first + range.indexCount);
+            uint32_t* out = &pattern.indices[first];
+
+            for (uint32_t y = 0; y < quads; y++)
+            {
+                for (uint32_t x = 0; x < quads; x++)
+                {
+                    uint32_t i0 = (y * step) * length + x * step; // Bottom left
+                    uint32_t i1 = i0 + step;                       // Bottom right
+                    uint32_t i2 = i0 + step * length;              // Top left
+                    uint32_t i3 = i2 + step;                       // Top right
+
+                    // Alternate the diagonal, as Hammer does. Rows have an odd number of vertices,
+                    // so this is a checkerboard at every LOD.
+                    if ((x + y) % 2 != 0)
+                    {
+                        // 1, 2, 0 (clockwise from bottom left)
+                        *out++ = i0; *out++ = i1; *out++ = i2;
+                        // 3, 0, 2
+                        *out++ = i3; *out++ = i2; *out++ = i1;
+                    }
+                    else
+                    {
+                        // 1, 0, 3
+                        *out++ = i3; *out++ = i2; *out++ = i0;
+                        // 3, 2, 1
+                        *out++ = i0; *out++ = i1; *out++ = i3;
+                    }
+                }
+            }
+        }
+
+        return pattern;
+    }
+
+    const DispIndexPattern& GetDispIndexPattern(int power)
+    {
+        static const std::array<DispIndexPattern, DispMaxPower - DispMinPower + 1> patterns = []
+        {
+            std::array<DispIndexPattern, DispMaxPower - DispMinPower + 1> patterns;
+            for (int power = DispMinPower; power <= DispMaxPower; power++)
+                patterns[power - DispMinPower] = BuildDispIndexPattern(power);
+            return patterns;
+        }();
+
+        if (IsValidDispPower(power)) [[likely]]
+            return patterns[power - DispMinPower];
+
+        // The plain sides of displacement brushes, one quad each, see Solid::UpdateMeshes.
+        static const DispIndexPattern plain = BuildDispIndexPattern(0);
+        if (power == 0)
+            return plain;
+
+        // Loaders turn these away, nothing to draw.
+        static const DispIndexPattern empty;
+        return empty;
+    }
+
+    void DispSurface::Resize(size_t count)
+    {
+        for (std::vector<float>* component : { &x, &y, &z, &nx, &ny, &nz, &u, &v })
+            component->resize(count);
+    }
+
+    void BuildDispSurface(const DispInfo& disp, std::span<const vec3, 4> corners, vec3 faceNormal, const DispMapping& mapping, DispSurface& out)
+    {
+        const uint32_t length = uint32_t(disp.length);
+        const uint32_t count  = length * length;
+        const float    slices = float(length - 1);
+
+        out.Resize(count);
+        float* px = out.x.data();
+        float* py = out.y.data();
+        float* pz = out.z.data();
+
+        const DispVert* verts = disp.verts.data();
+        const vec3 elevation = faceNormal * disp.elevation;
+
+        // Rows run from the edge corners[0] -> corners[1] to corners[3] -> corners[2].
+        const vec3 edge0 = (corners[1] - corners[0]) / slices;
+        const vec3 edge1 = (corners[2] - corners[3]) / slices;
+
+        for (uint32_t y = 0; y < length; y++)
+        {
+            vec3 start = corners[0] + edge0 * float(y);
+            vec3 end   = corners[3] + edge1 * float(y);
+            vec3 step  = (end - start) / slices;
+
+            // UVs are linear along a row of the flat face.
+            float u0 = glm::dot(mapping.uAxis, start) + mapping.uOffset;
+            float v0 = glm::dot(mapping.vAxis, start) + mapping.vOffset;
+            float du = glm::dot(mapping.uAxis, step);
+            float dv = glm::dot(mapping.vAxis, step);
+
+            start += elevation;
+
+            const uint32_t row = y * length;
+            const DispVert* rowVerts = verts + row;
+            float* rx = px + row;
+            float* ry = py + row;
+            float* rz = pz + row;
+            float* ru = out.u.data() + row;
+            float* rv = out.v.data() + row;
+
+            for (uint32_t x = 0; x < length; x++)
+            {
+                const DispVert& vert = rowVerts[x];
+                float t = float(x);
+
+                // Flat position, plus the subdivision offset (rarely used), plus the displacement along its normal.
+                rx[x] = start.x + step.x * t + vert.offset.x + vert.normal.x * vert.dist;
+                ry[x] = start.y + step.y * t + vert.offset.y + vert.normal.y * vert.dist;
+                rz[x] = start.z + step.z * t + vert.offset.z + vert.normal.z * vert.dist;
+                ru[x] = u0 + du * t;
+                rv[x] = v0 + dv * t;
+            }
+        }
+
+        // Bounds
+        {
+            float minX = std::numeric_limits<float>::max(), maxX = std::numeric_limits<float>::lowest();
+            float minY = minX, maxY = maxX;
+            float minZ = minX, maxZ = maxX;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                minX = std::min(minX, px[i]); maxX = std::max(maxX, px[i]);
+                minY = std::min(minY, py[i]); maxY = std::max(maxY, py[i]);
+                minZ = std::min(minZ, pz[i]); maxZ = std::max(maxZ, pz[i]);
+            }
+            out.bounds = AABB{ vec3(minX, minY, minZ), vec3(maxX, maxY, maxZ) };
+        }
+
+        // Smoothed normals from the differences to neighbouring vertices across and down the grid,
+        // one-sided along the edges. Flipped to face the same way as the face.
+        vec3 across = corners[3] - corners[0];
+        vec3 down   = corners[1] - corners[0];
+        float side  = glm::dot(glm::cross(across, down), faceNormal) < 0.0f ? -1.0f : 1.0f;
+
+        float* nx = out.nx.data();
+        float* ny = out.ny.data();
+        float* nz = out.nz.data();
+
+        for (uint32_t y = 0; y < length; y++)
+        {
+            const uint32_t row  = y * length;
+            const uint32_t prev = (y > 0 ? y - 1 : y) * length;
+            const uint32_t next = (y + 1 < length ? y + 1 : y) * length;
+
+            for (uint32_t x = 0; x < length; x++)
+            {
+                uint32_t left  = x > 0 ? x - 1 : x;
+                uint32_t right = x + 1 < length ? x + 1 : x;
+
+                float ax = px[row + right] - px[row + left];
+                float ay = py[row + right] - py[row + left];
+                float az = pz[row + right] - pz[row + left];
+
+                float dx = px[next + x] - px[prev + x];
+                float dy = py[next + x] - py[prev + x];
+                float dz = pz[next + x] - pz[prev + x];
+
+                float cx = (ay * dz - az * dy) * side;
+                float cy = (az * dx - ax * dz) * side;
+                float cz = (ax * dy - ay * dx) * side;
+
+                float lengthSq = cx * cx + cy * cy + cz * cz;
+                bool degenerate = lengthSq < 1e-12f;
+                float inv = degenerate ? 0.0f : 1.0f / std::sqrt(lengthSq);
+
+                nx[row + x] = degenerate ? faceNormal.x : cx * inv;
+                ny[row + x] = degenerate ? faceNormal.y : cy * inv;
+                nz[row + x] = degenerate ? faceNormal.z : cz * inv;
+            }
+        }
+    }
+}
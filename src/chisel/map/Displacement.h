@@ -1,12 +1,21 @@
 #pragma once
 
 #include "math/Math.h"
+#include "math/AABB.h"
 
+#include <array>
+#include <span>
 #include <vector>
 #include <memory>
 
 namespace chisel
 {
+    // Subdivision powers Hammer makes, 5x5 to 17x17 vertices.
+    static constexpr int DispMinPower = 2;
+    static constexpr int DispMaxPower = 4;
+
+    constexpr bool IsValidDispPower(int power) { return power >= DispMinPower && power <= DispMaxPower; }
+
     struct DispVert
     {
         vec3    normal;
@@ -46,7 +55,7 @@ namespace chisel
             return (2 * quadLength * quadLength) * 3;
         }
 
-        void UpdatePointStartIndex(const std::vector<vec3>& points)
+        void UpdatePointStartIndex(std::span<const vec3> points)
         {
             if (pointStartIndex != -1)
                 return;
@@ -68,4 +77,53 @@ namespace chisel
             pointStartIndex = minIndex;
         }
     };
+
+    // Lower detail versions of a displacement, drawn from its full grid of vertices with every
+    // other row and column dropped for each level. So they share the vertices, only the indices differ.
+    static constexpr uint32_t DispMaxLODs = 3;
+
+    struct DispLOD
+    {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    // Triangles for every displacement of one power, indices into its (length x length) grid.
+    // The full detail triangles first, then each LOD's.
+    struct DispIndexPattern
+    {
+        std::vector<uint32_t>              indices;
+        std::array<DispLOD, DispMaxLODs>   lods;
+        uint32_t                           lodCount = 0;
+    };
+
+    // Built once for each power and shared. Power 0 is a single quad.
+    // Empty for any other power that isn't IsValidDispPower.
+    const DispIndexPattern& GetDispIndexPattern(int power);
+
+    // Texture mapping of a face, already divided by its scale and texture size:
+    // u = dot(uAxis, pos) + uOffset
+    struct DispMapping
+    {
+        vec3  uAxis;
+        float uOffset;
+        vec3  vAxis;
+        float vOffset;
+    };
+
+    // A displaced grid with one array per component, so each step runs down whole arrays.
+    struct DispSurface
+    {
+        std::vector<float> x, y, z;
+        std::vector<float> nx, ny, nz;
+        std::vector<float> u, v;
+        AABB bounds;
+
+        void Resize(size_t count);
+    };
+
+    // Positions, smoothed normals, UVs and bounds of a displacement.
+    // corners are the face's points, starting from the one at disp.pointStartIndex.
+    // UVs are from the undisplaced face, like Hammer.
+    void BuildDispSurface(const DispInfo& disp, std::span<const vec3, 4> corners, vec3 faceNormal, const DispMapping& mapping, DispSurface& out);
 }
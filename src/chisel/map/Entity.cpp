@@ -3,6 +3,8 @@
 #include "Entity.h"
 #include "Map.h"
 #include "Convex.h"
+#include "chisel/Core.h"
+#include "chisel/FGD/FGD.h"
 
 namespace chisel
 {
@@ -10,14 +12,81 @@ namespace chisel
     // Base Entity
     /////////////////////
 
-    Entity::Entity(BrushEntity* parent)
+    Entity::Entity(BrushEntity* parent, EntityType type)
         : Atom(parent)
+        , m_type(type)
     {
     }
 
+    const FGD::Class* Entity::GetClass() const
+    {
+        if (!m_classResolved)
+        {
+            m_class = nullptr;
+            if (Core.fgd)
+            {
+                auto iter = Core.fgd->classes.find(classname);
+                if (iter != Core.fgd->classes.end())
+                    m_class = &iter->second;
+            }
+            m_classResolved = true;
+        }
+        return m_class;
+    }
+
+    void Entity::MarkDirty()
+    {
+        m_classResolved = false;
+        Core.SceneChanged();
+
+        if (m_parent && m_proxyIndex != ~0u && !m_proxyDirty)
+            static_cast<Map*>(m_parent)->ProxyChanged(*this);
+    }
+
+    kv::KeyValuesVariant Entity::ParseKeyValue(std::string_view key, std::string_view value) const
+    {
+        const FGD::Class* cls = GetClass();
+        if (const FGD::Var* var = cls ? cls->GetVar(HashString(key)) : nullptr)
+            return var->Parse(value);
+
+        return kv::KeyValuesVariant::Parse(value);
+    }
+
+    void Entity::SetKeyValue(std::string_view key, std::string_view value)
+    {
+        if (kv.Contains(key))
+            kv[key] = ParseKeyValue(key, value);
+        else
+            kv.CreateTypedChild(key, ParseKeyValue(key, value));
+    }
+
+    void Entity::ParseKeyValues()
+    {
+        const FGD::Class* cls = GetClass();
+        if (!cls)
+            return;
+
+        for (auto& [key, value] : kv)
+        {
+            if (value.GetType() == kv::Types::KeyValues)
+                continue;
+
+            const FGD::Var* var = cls->GetVar(HashString(key.str()));
+            if (!var || var->ValueType() == value.GetType())
+                continue;
+
+            // The text it was parsed from is kept, so this is lossless.
+            std::string text = std::string(value.Get<std::string_view>());
+            value = var->Parse(text);
+        }
+    }
+
     void Entity::Delete()
     {
         assert(m_parent->IsMap());
+        if (Core.map)
+            Core.map->Actions().EntityRemoved(*this);
+
         static_cast<Map*>(m_parent)->RemoveEntity(*this);
     }
 
@@ -25,8 +94,8 @@ namespace chisel
     // Point Entity
     /////////////////////
 
-    PointEntity::PointEntity(BrushEntity* parent)
-        : Entity(parent)
+    PointEntity::PointEntity(BrushEntity* parent, EntityType type)
+        : Entity(parent, type)
     {
     }
 
@@ -38,10 +107,12 @@ namespace chisel
     void PointEntity::Transform(const mat4x4& matrix)
     {
         origin = matrix * vec4(origin, 1.0f);
+        MarkDirty();
     }
     void PointEntity::AlignToGrid(vec3 gridSize)
     {
         origin = math::Snap(origin, gridSize);
+        MarkDirty();
     }
     Selectable* PointEntity::Duplicate()
     {
@@ -60,7 +131,7 @@ namespace chisel
     /////////////////////
 
     BrushEntity::BrushEntity(BrushEntity* parent)
-        : Entity(parent)
+        : Entity(parent, EntityType::Brush)
     {
     }
 
@@ -103,18 +174,39 @@ namespace chisel
         newEntity->kv = this->kv;
         for (Solid& brush : Brushes())
             newEntity->AddBrush(brush.GetSides());
+        for (auto& dormant : m_dormantSolids)
+            newEntity->AddDormantBrush(std::make_unique<kv::KeyValues>(*dormant));
         static_cast<Map*>(m_parent)->AddEntity(newEntity);
         return newEntity;
     }
 
-    Solid& BrushEntity::AddBrush(std::vector<Side> sides)
+    Solid& BrushEntity::AddBrush(std::vector<Side> sides, bool initMesh)
     {
-        return m_solids.emplace_back(this, sides);
+        auto [handle, solid] = m_solids.emplace(this, std::move(sides), initMesh);
+        solid.m_handle = handle;
+        return solid;
     }
 
     void BrushEntity::RemoveBrush(const Solid& brush)
     {
-        m_solids.remove(brush);
+        assert(brush.GetParent() == this);
+        m_solids.erase(brush.GetHandle());
+        Core.SceneChanged();
+    }
+
+    Solid* BrushEntity::FindBrush(PoolHandle handle)
+    {
+        return m_solids.get(handle);
+    }
+
+    void BrushEntity::AddDormantBrush(std::unique_ptr<kv::KeyValues> solid)
+    {
+        m_dormantSolids.emplace_back(std::move(solid));
+    }
+
+    std::vector<std::unique_ptr<kv::KeyValues>> BrushEntity::TakeDormantBrushes()
+    {
+        return std::exchange(m_dormantSolids, {});
     }
 
     std::optional<RayHit> BrushEntity::QueryRay(const Ray& ray) const
@@ -5,35 +5,82 @@
 #include "RayHit.h"
 #include "Solid.h"
 #include "formats/KeyValues.h"
+#include "chisel/FGD/FGD.h"
 #include <optional>
-#include <list>
+#include <memory>
 
 namespace chisel
 {
+    enum class EntityType : uint8_t
+    {
+        Point,
+        Model,
+        Brush,
+    };
+
     class Entity : public Atom
     {
     public:
-        Entity(BrushEntity* parent);
+        Entity(BrushEntity* parent, EntityType type);
 
         void Delete() final override;
 
-        virtual bool IsBrushEntity() const { return false;}
+        EntityType GetType() const { return m_type; }
+        bool IsBrushEntity() const { return m_type == EntityType::Brush; }
         virtual Rc<Mesh> GetModel() const { return nullptr; }
 
+        // Where this entity lives in the map's entity table.
+        PoolHandle GetHandle() const { return m_handle; }
+
+        // The FGD class for the classname, nullptr if the FGD doesn't have it.
+        // Resolved once, until MarkDirty.
+        const FGD::Class* GetClass() const;
+
+        // Call after changing classname, origin or model,
+        // so the cached class and the map's render proxy are rebuilt.
+        void MarkDirty();
+
+    // Keyvalues //
+
+        // Parses text as the type the FGD gives this key, or guesses if it doesn't know it.
+        kv::KeyValuesVariant ParseKeyValue(std::string_view key, std::string_view value) const;
+        // Sets a keyvalue from text, see ParseKeyValue.
+        void SetKeyValue(std::string_view key, std::string_view value);
+        // Parses every keyvalue again, e.g. after loading or changing classname,
+        // so reading them never has to.
+        void ParseKeyValues();
+
     // Public members
 
+        // Remember to MarkDirty after changing these!
         std::string classname;
         std::string targetname;
 
         glm::vec3 origin;
 
         kv::KeyValues kv;
+
+    protected:
+        void SelectionChanged() override { MarkDirty(); }
+
+    private:
+        friend class Map;
+
+        EntityType m_type;
+        PoolHandle m_handle;
+        uint64_t   m_order = 0;     // When it was added to the map, see Map::EntitiesInOrder
+        uint32_t   m_typeIndex = 0; // In the map's list of this type
+        uint32_t   m_proxyIndex = ~0u; // In the map's render proxies, point and model entities only
+        bool       m_proxyDirty = false;
+
+        mutable const FGD::Class* m_class = nullptr;
+        mutable bool              m_classResolved = false;
     };
 
     class PointEntity : public Entity
     {
     public:
-        PointEntity(BrushEntity* parent);
+        PointEntity(BrushEntity* parent, EntityType type = EntityType::Point);
 
     // Selectable Interface //
 
@@ -46,8 +93,9 @@ namespace chisel
     class ModelEntity final : public PointEntity
     {
     public:
-        using PointEntity::PointEntity;
-        
+        ModelEntity(BrushEntity* parent)
+            : PointEntity(parent, EntityType::Model) {}
+
         virtual Rc<Mesh> GetModel() const { return model; }
 
         Rc<Mesh> model;
@@ -67,22 +115,34 @@ namespace chisel
 
     // Entity Interface //
 
-        bool IsBrushEntity() const override { return true; }
-
-    //
-
         virtual bool IsMap() { return false; }
 
         auto Brushes() { return IteratorPassthru(m_solids); }
 
-        Solid& AddBrush(std::vector<Side> sides);
+        Solid& AddBrush(std::vector<Side> sides, bool initMesh = true);
 
         void RemoveBrush(const Solid& brush);
 
+        // nullptr if the solid has since been removed.
+        Solid* FindBrush(PoolHandle handle);
+
         std::optional<RayHit> QueryRay(const Ray& ray) const;
 
+    // Dormant solids //
+
+        // Solids left out of the loaded MapRegion. Kept as the raw keyvalues
+        // they were read from, so they cost no CSG, mesh or GPU memory,
+        // and are written back untouched on save.
+        auto DormantBrushes() { return IteratorPassthru(m_dormantSolids); }
+
+        void AddDormantBrush(std::unique_ptr<kv::KeyValues> solid);
+
+        // Returns the dormant solids, leaving none behind.
+        std::vector<std::unique_ptr<kv::KeyValues>> TakeDormantBrushes();
+
     protected:
 
-        std::list<Solid> m_solids;
+        Pool<Solid> m_solids;
+        std::vector<std::unique_ptr<kv::KeyValues>> m_dormantSolids;
     };
 }
\ No newline at end of file
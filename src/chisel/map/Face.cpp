@@ -3,6 +3,20 @@
 
 namespace chisel
 {
+    ConVar<bool>  trans_texture_lock("trans_texture_lock", true, "Enable texture lock for transformations.");
+    ConVar<bool>  trans_texture_scale_lock("trans_texture_scale_lock", false, "Enable scaling texture lock.");
+    ConVar<bool>  trans_texture_face_alignment("trans_texture_face_alignment", true, "Enable texture face alignment.");
+
+    Face::Face(Solid* brush, uint sideIdx, Side* side, std::span<const vec3> pts)
+        : Selectable(SelectionIDs::MakePart(brush->GetSelectionID(), sideIdx))
+        , solid(brush)
+        , side(side)
+        , points(pts)
+        , sideIdx(sideIdx)
+    {
+        UpdateBounds();
+    }
+
     void Face::UpdateBounds()
     {
         // Compute the bounds from face points.
@@ -9,6 +9,7 @@
 #include "Displacement.h"
 
 #include <array>
+#include <span>
 
 namespace chisel
 {
@@ -62,14 +63,9 @@ namespace chisel
 
     struct Face : public Selectable
     {
-        Face(Solid* brush, uint sideIdx, Side* side, std::vector<vec3> pts)
-            : solid(brush)
-            , side(side)
-            , points(std::move(pts))
-            , sideIdx(sideIdx)
-        {
-            UpdateBounds();
-        }
+        // The selection ID comes from the solid's and the side index,
+        // so it stays the same when faces are rebuilt.
+        Face(Solid* brush, uint sideIdx, Side* side, std::span<const vec3> pts);
 
         Face(Face&& other) = default;
         Face(const Face& other) = default;
@@ -77,7 +73,7 @@ namespace chisel
 
         Solid* solid;
         Side* side;
-        std::vector<vec3> points;
+        std::span<const vec3> points; // Into the solid's point buffer
         AABB bounds;
         uint meshIdx = 0;
         uint startIndex = 0;
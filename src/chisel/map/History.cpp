@@ -0,0 +1,856 @@
+#include "History.h"
+#include "Map.h"
+
+#include "assets/Assets.h"
+#include "console/ConCommand.h"
+#include "console/ConVar.h"
+#include "chisel/Core.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace chisel
+{
+    static ConVar<int> undo_memory_limit("undo_memory_limit", 64, "Maximum memory used by the undo history, in MB.");
+
+    static ConCommand undo_info("undo_info", "Print undo history memory usage.", []()
+    {
+        if (!Core.map)
+            return;
+
+        auto& history = Core.map->Actions();
+        Console.Log("Undo history: {} actions, {:.2f} / {:.2f} MB",
+            history.Count(),
+            history.MemoryUsage() / (1024.0 * 1024.0),
+            history.MemoryCapacity() / (1024.0 * 1024.0));
+    });
+
+//-------------------------------------------------------------------------------------------------
+// Serialization
+//-------------------------------------------------------------------------------------------------
+
+    struct HistoryWriter
+    {
+        std::vector<uint8_t>& out;
+
+        void WriteBytes(const void* data, size_t size)
+        {
+            size_t offset = out.size();
+            out.resize(offset + size);
+            if (size)
+                std::memcpy(&out[offset], data, size);
+        }
+
+        template <typename T>
+        void Write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            WriteBytes(&value, sizeof(T));
+        }
+
+        void WriteString(std::string_view str)
+        {
+            Write<uint32_t>(str.size());
+            WriteBytes(str.data(), str.size());
+        }
+
+        void WriteSides(const std::vector<Side>& sides)
+        {
+            Write<uint32_t>(sides.size());
+            for (const Side& side : sides)
+            {
+                Write(side.plane);
+                WriteString(side.material != nullptr ? std::string_view(side.material->GetPath()) : std::string_view());
+                Write(side.textureAxes);
+                Write(side.scale);
+                Write(side.rotate);
+                Write(side.lightmapScale);
+                Write(side.smoothing);
+
+                Write<uint8_t>(side.disp.has_value());
+                if (!side.disp)
+                    continue;
+
+                const DispInfo& disp = *side.disp;
+                Write(disp.power);
+                Write(disp.startPos);
+                Write(disp.elevation);
+                Write(disp.subdiv);
+                Write(disp.flags);
+                Write(disp.pointStartIndex);
+                WriteBytes(disp.verts.data(), disp.verts.size() * sizeof(DispVert));
+            }
+        }
+
+        // Values as the text they'd be saved as, children recursively.
+        void WriteKeyValues(const kv::KeyValues& values)
+        {
+            Write<uint32_t>(values.ChildCount());
+            for (const auto& [key, value] : values)
+            {
+                WriteString(std::string_view(key));
+                bool child = value.GetType() == kv::Types::KeyValues;
+                Write<uint8_t>(child);
+                if (child)
+                    WriteKeyValues((kv::KeyValues&)value);
+                else
+                    WriteString(std::string_view(value));
+            }
+        }
+
+        void WriteEntity(const Entity& entity)
+        {
+            Write(entity.GetAtomID());
+            Write(entity.GetType());
+            WriteString(entity.classname);
+            WriteString(entity.targetname);
+            Write(entity.origin);
+            WriteKeyValues(entity.kv);
+
+            if (!entity.IsBrushEntity())
+                return;
+
+            // Brush entities aren't changed by being written, Brushes() just isn't const.
+            auto& brushEntity = const_cast<BrushEntity&>(static_cast<const BrushEntity&>(entity));
+
+            uint32_t solids = 0;
+            for ([[maybe_unused]] const Solid& solid : brushEntity.Brushes())
+                solids++;
+            Write<uint32_t>(solids);
+            for (const Solid& solid : brushEntity.Brushes())
+            {
+                Write(solid.GetAtomID());
+                WriteSides(solid.GetSides());
+            }
+
+            uint32_t dormant = 0;
+            for ([[maybe_unused]] const auto& solid : brushEntity.DormantBrushes())
+                dormant++;
+            Write<uint32_t>(dormant);
+            for (const auto& solid : brushEntity.DormantBrushes())
+                WriteKeyValues(*solid);
+        }
+
+        void WriteGeometry(Solid& solid)
+        {
+            WriteSides(solid.GetSides());
+
+            std::optional<AABB> bounds = solid.GetBounds();
+            Write<uint8_t>(bounds.has_value());
+            if (bounds)
+                Write(*bounds);
+
+            Write<uint32_t>(solid.GetFaces().size());
+            for (const Face& face : solid.GetFaces())
+            {
+                Write<uint32_t>(face.sideIdx);
+                Write<uint32_t>(face.meshIdx);
+                Write<uint32_t>(face.startIndex);
+                Write<uint32_t>(face.points.data() - solid.GetPoints().data());
+                Write<uint32_t>(face.points.size());
+            }
+
+            Write<uint32_t>(solid.GetPoints().size());
+            WriteBytes(solid.GetPoints().data(), solid.GetPoints().size() * sizeof(vec3));
+
+            // The meshes are always saved, so restoring only uploads them, whatever r_keep_brush_geometry is.
+            // Without CPU copies they're built again here (no CSG), once when saved rather than on every undo.
+            bool kept = true;
+            for (const BrushMesh& mesh : solid.GetMeshes())
+                kept &= mesh.vertices.size() == mesh.vertexCount && mesh.indices.size() == mesh.indexCount;
+
+            std::span<const BrushMeshData> built;
+            if (!kept)
+                built = solid.BuildMeshData();
+
+            Write<uint32_t>(solid.GetMeshes().size());
+            for (size_t i = 0; i < solid.GetMeshes().size(); i++)
+            {
+                const BrushMesh& mesh = solid.GetMeshes()[i];
+                std::span<const VertexSolid> vertices = kept ? std::span<const VertexSolid>(mesh.vertices) : std::span<const VertexSolid>(built[i].vertices);
+                std::span<const uint32_t>    indices  = kept ? std::span<const uint32_t>(mesh.indices)     : std::span<const uint32_t>(built[i].indices);
+
+                WriteString(mesh.material != nullptr ? std::string_view(mesh.material->GetPath()) : std::string_view());
+                Write<uint32_t>(vertices.size());
+                WriteBytes(vertices.data(), vertices.size() * sizeof(VertexSolid));
+                Write<uint32_t>(indices.size());
+                WriteBytes(indices.data(), indices.size() * sizeof(uint32_t));
+                Write<uint32_t>(mesh.lodCount);
+                WriteBytes(mesh.lods.data(), mesh.lodCount * sizeof(DispLOD));
+            }
+        }
+    };
+
+    struct HistoryReader
+    {
+        const uint8_t* data;
+
+        void ReadBytes(void* dst, size_t size)
+        {
+            if (size)
+                std::memcpy(dst, data, size);
+            data += size;
+        }
+
+        template <typename T>
+        T Read()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            T value;
+            ReadBytes(&value, sizeof(T));
+            return value;
+        }
+
+        std::string_view ReadString()
+        {
+            uint32_t size = Read<uint32_t>();
+            std::string_view str((const char*)data, size);
+            data += size;
+            return str;
+        }
+
+        std::vector<Side> ReadSides()
+        {
+            std::vector<Side> sides(Read<uint32_t>());
+            for (Side& side : sides)
+            {
+                side.plane = Read<Plane>();
+                std::string_view material = ReadString();
+                if (!material.empty())
+                    side.material = Assets.Load<Material>(std::string(material));
+                side.textureAxes = Read<std::array<vec4, 2>>();
+                side.scale = Read<std::array<float, 2>>();
+                side.rotate = Read<float>();
+                side.lightmapScale = Read<float>();
+                side.smoothing = Read<uint32_t>();
+
+                if (!Read<uint8_t>())
+                    continue;
+
+                DispInfo& disp = side.disp.emplace(Read<int>());
+                disp.startPos = Read<vec3>();
+                disp.elevation = Read<float>();
+                disp.subdiv = Read<bool>();
+                disp.flags = Read<int>();
+                disp.pointStartIndex = Read<int>();
+                ReadBytes(disp.verts.data(), disp.verts.size() * sizeof(DispVert));
+            }
+            return sides;
+        }
+
+        void ReadKeyValues(kv::KeyValues& values)
+        {
+            uint32_t count = Read<uint32_t>();
+            for (uint32_t i = 0; i < count; i++)
+            {
+                std::string_view key = ReadString();
+                if (Read<uint8_t>())
+                {
+                    auto child = std::make_unique<kv::KeyValues>();
+                    ReadKeyValues(*child);
+                    values.CreateTypedChild(key, kv::KeyValuesVariant(std::move(child)));
+                }
+                else
+                    values.CreateChild(key, ReadString());
+            }
+        }
+
+        // Makes the entity back with the same atom IDs, not yet added to the map.
+        Entity* ReadEntity(Map& map)
+        {
+            AtomID     id   = Read<AtomID>();
+            EntityType type = Read<EntityType>();
+
+            Entity* entity;
+            switch (type)
+            {
+                case EntityType::Model: entity = new ModelEntity(&map); break;
+                case EntityType::Brush: entity = new BrushEntity(&map); break;
+                default:                entity = new PointEntity(&map); break;
+            }
+            entity->SetAtomID(id);
+
+            entity->classname  = ReadString();
+            entity->targetname = ReadString();
+            entity->origin     = Read<vec3>();
+            ReadKeyValues(entity->kv);
+            entity->ParseKeyValues();
+
+            if (type == EntityType::Model)
+                static_cast<ModelEntity*>(entity)->model = Assets.Load<Mesh>(std::string(entity->kv["model"]));
+
+            if (type != EntityType::Brush)
+                return entity;
+
+            auto* brushEntity = static_cast<BrushEntity*>(entity);
+            uint32_t solids = Read<uint32_t>();
+            for (uint32_t i = 0; i < solids; i++)
+            {
+                AtomID solidID = Read<AtomID>();
+                Solid& solid = brushEntity->AddBrush(ReadSides());
+                solid.SetAtomID(solidID);
+            }
+
+            uint32_t dormant = Read<uint32_t>();
+            for (uint32_t i = 0; i < dormant; i++)
+            {
+                auto solid = std::make_unique<kv::KeyValues>();
+                ReadKeyValues(*solid);
+                brushEntity->AddDormantBrush(std::move(solid));
+            }
+            return entity;
+        }
+
+        SolidGeometry ReadGeometry()
+        {
+            SolidGeometry geometry;
+            geometry.sides = ReadSides();
+
+            if (Read<uint8_t>())
+                geometry.bounds = Read<AABB>();
+
+            uint32_t faceCount = Read<uint32_t>();
+            geometry.windings.sides.resize(faceCount);
+            geometry.faceMeshes.resize(faceCount);
+            for (uint32_t i = 0; i < faceCount; i++)
+            {
+                SideWinding& winding = geometry.windings.sides[i];
+                winding.sideIdx = Read<uint32_t>();
+                geometry.faceMeshes[i].meshIdx    = Read<uint32_t>();
+                geometry.faceMeshes[i].startIndex = Read<uint32_t>();
+                winding.firstPoint = Read<uint32_t>();
+                winding.pointCount = Read<uint32_t>();
+            }
+
+            geometry.windings.points.resize(Read<uint32_t>());
+            ReadBytes(geometry.windings.points.data(), geometry.windings.points.size() * sizeof(vec3));
+
+            geometry.meshes.resize(Read<uint32_t>());
+            for (auto& mesh : geometry.meshes)
+            {
+                // The sides hold on to the materials, the meshes only point at them.
+                std::string_view material = ReadString();
+                for (const Side& side : geometry.sides)
+                {
+                    if (side.material != nullptr && side.material->GetPath() == material)
+                    {
+                        mesh.material = side.material.ptr();
+                        break;
+                    }
+                }
+
+                mesh.vertices.resize(Read<uint32_t>());
+                ReadBytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(VertexSolid));
+                mesh.indices.resize(Read<uint32_t>());
+                ReadBytes(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+                mesh.lodCount = Read<uint32_t>();
+                ReadBytes(mesh.lods.data(), mesh.lodCount * sizeof(DispLOD));
+            }
+            return geometry;
+        }
+    };
+
+    static void SetKeyValue(Entity& entity, std::string_view key, std::string_view value)
+    {
+        if (key == "classname")
+        {
+            entity.classname = value;
+            entity.MarkDirty();
+        }
+        else if (key == "origin")
+        {
+            std::sscanf(std::string(value).c_str(), "%f %f %f", &entity.origin.x, &entity.origin.y, &entity.origin.z);
+            entity.MarkDirty();
+        }
+        else if (key == "targetname")
+            entity.targetname = value;
+        else if (value.empty())
+            entity.kv.RemoveAll(key);
+        else
+            entity.SetKeyValue(key, value);
+    }
+
+//-------------------------------------------------------------------------------------------------
+// Recording
+//-------------------------------------------------------------------------------------------------
+
+    // Each delta is: [DeltaType][uint32_t payload size][payload]
+    static constexpr size_t DeltaHeaderSize = sizeof(uint8_t) + sizeof(uint32_t);
+
+    ActionHistory::ActionHistory()
+    {
+    }
+
+    void ActionHistory::Begin(const char* name)
+    {
+        assert(!m_recording);
+        m_recording = name;
+        m_scratch.clear();
+        m_lastEdit.entity = 0;
+    }
+
+    void ActionHistory::End()
+    {
+        assert(m_recording);
+        FlushSaved();
+        const char* name = std::exchange(m_recording, nullptr);
+
+        // Nothing changed, nothing to undo.
+        if (!m_scratch.empty())
+            Push(name, m_scratch);
+    }
+
+    size_t ActionHistory::BeginDelta(DeltaType type)
+    {
+        size_t header = m_scratch.size();
+        HistoryWriter out{ m_scratch };
+        out.Write(type);
+        out.Write<uint32_t>(0);
+        return header;
+    }
+
+    void ActionHistory::EndDelta(size_t header)
+    {
+        uint32_t size = uint32_t(m_scratch.size() - header - DeltaHeaderSize);
+        std::memcpy(&m_scratch[header + sizeof(uint8_t)], &size, sizeof(size));
+    }
+
+    void ActionHistory::SolidAdded(const Solid& solid)
+    {
+        bool single = !m_recording;
+        if (single)
+            Begin("Add Solid");
+
+        size_t header = BeginDelta(DeltaType::SolidAdded);
+        HistoryWriter out{ m_scratch };
+        out.Write(solid.GetParent()->GetAtomID());
+        out.Write(solid.GetAtomID());
+        out.WriteSides(solid.GetSides());
+        EndDelta(header);
+
+        if (single)
+            End();
+    }
+
+    void ActionHistory::SolidRemoved(const Solid& solid)
+    {
+        bool single = !m_recording;
+        if (single)
+            Begin("Remove Solid");
+
+        size_t header = BeginDelta(DeltaType::SolidRemoved);
+        HistoryWriter out{ m_scratch };
+        out.Write(solid.GetParent()->GetAtomID());
+        out.Write(solid.GetAtomID());
+        out.WriteSides(solid.GetSides());
+        EndDelta(header);
+
+        if (single)
+            End();
+    }
+
+    void ActionHistory::EntityAdded(const Entity& entity)
+    {
+        bool single = !m_recording;
+        if (single)
+            Begin("Add Entity");
+
+        size_t header = BeginDelta(DeltaType::EntityAdded);
+        HistoryWriter{ m_scratch }.WriteEntity(entity);
+        EndDelta(header);
+
+        if (single)
+            End();
+    }
+
+    void ActionHistory::EntityRemoved(const Entity& entity)
+    {
+        bool single = !m_recording;
+        if (single)
+            Begin("Remove Entity");
+
+        size_t header = BeginDelta(DeltaType::EntityRemoved);
+        HistoryWriter{ m_scratch }.WriteEntity(entity);
+        EndDelta(header);
+
+        if (single)
+            End();
+    }
+
+    void ActionHistory::SelectionAdded()
+    {
+        for (Selectable* selectable : Selection)
+        {
+            if (auto* solid = dynamic_cast<Solid*>(selectable))
+                SolidAdded(*solid);
+            else if (auto* entity = dynamic_cast<Entity*>(selectable))
+                EntityAdded(*entity);
+        }
+    }
+
+    void ActionHistory::SidesChanged(const Solid& solid, const std::vector<Side>& before)
+    {
+        bool single = !m_recording;
+        if (single)
+            Begin("Edit Solid");
+
+        size_t header = BeginDelta(DeltaType::SidesChanged);
+        HistoryWriter out{ m_scratch };
+        out.Write(solid.GetAtomID());
+        out.WriteSides(before);
+        out.WriteSides(solid.GetSides());
+        EndDelta(header);
+
+        if (single)
+            End();
+    }
+
+    void ActionHistory::KeyValueChanged(const Entity& entity, std::string_view key, std::string_view before, std::string_view after)
+    {
+        if (m_recording)
+        {
+            size_t header = BeginDelta(DeltaType::KeyValueChanged);
+            HistoryWriter out{ m_scratch };
+            out.Write(entity.GetAtomID());
+            out.WriteString(key);
+            out.WriteString(before);
+            out.WriteString(after);
+            EndDelta(header);
+            return;
+        }
+
+        // Typing or dragging a value edits it every frame, merge that into one action
+        // by replacing the last one if it was an edit of the same key.
+        bool merge = m_lastEdit.entity == entity.GetAtomID()
+            && m_lastEdit.key == key
+            && CanUndo() && !CanRedo();
+
+        std::string first = merge ? m_lastEdit.before : std::string(before);
+        if (merge)
+        {
+            m_records.pop_back();
+            m_cursor--;
+        }
+
+        Begin("Edit Keyvalue");
+        KeyValueChanged(entity, key, first, after);
+        End();
+
+        m_lastEdit.entity = entity.GetAtomID();
+        m_lastEdit.key    = key;
+        m_lastEdit.before = std::move(first);
+    }
+
+    void ActionHistory::SaveGeometry(Solid& solid)
+    {
+        assert(m_recording);
+        for (const SavedGeometry& saved : m_savedGeometry)
+        {
+            if (saved.solid == solid.GetAtomID())
+                return;
+        }
+
+        size_t offset = m_saved.size();
+        HistoryWriter out{ m_saved };
+        out.WriteGeometry(solid);
+        m_savedGeometry.push_back(SavedGeometry{ solid.GetAtomID(), offset, m_saved.size() - offset });
+    }
+
+    void ActionHistory::SaveOrigin(const Entity& entity)
+    {
+        assert(m_recording);
+        for (const auto& [id, origin] : m_savedOrigins)
+        {
+            if (id == entity.GetAtomID())
+                return;
+        }
+
+        m_savedOrigins.emplace_back(entity.GetAtomID(), entity.origin);
+    }
+
+    void ActionHistory::SaveSelection()
+    {
+        for (Selectable* selectable : Selection)
+        {
+            if (auto* solid = dynamic_cast<Solid*>(selectable))
+                SaveGeometry(*solid);
+            else if (auto* face = dynamic_cast<Face*>(selectable))
+                SaveGeometry(*face->solid);
+            else if (auto* brushEntity = dynamic_cast<BrushEntity*>(selectable))
+            {
+                for (Solid& solid : brushEntity->Brushes())
+                    SaveGeometry(solid);
+            }
+            else if (auto* entity = dynamic_cast<PointEntity*>(selectable))
+                SaveOrigin(*entity);
+        }
+    }
+
+    void ActionHistory::FlushSaved()
+    {
+        static std::vector<uint8_t> after;
+
+        for (const SavedGeometry& saved : m_savedGeometry)
+        {
+            auto* solid = static_cast<Solid*>(Atom::FindAtom(saved.solid));
+            if (!solid)
+                continue;
+
+            after.clear();
+            HistoryWriter{ after }.WriteGeometry(*solid);
+
+            std::span before(&m_saved[saved.offset], saved.size);
+            if (std::ranges::equal(before, after))
+                continue;
+
+            size_t header = BeginDelta(DeltaType::GeometryChanged);
+            HistoryWriter out{ m_scratch };
+            out.Write(solid->GetAtomID());
+            out.Write<uint32_t>(before.size());
+            out.WriteBytes(before.data(), before.size());
+            out.WriteBytes(after.data(), after.size());
+            EndDelta(header);
+        }
+
+        for (const auto& [id, origin] : m_savedOrigins)
+        {
+            auto* entity = static_cast<Entity*>(Atom::FindAtom(id));
+            if (!entity || entity->origin == origin)
+                continue;
+
+            std::string before = fmt::format("{} {} {}", origin.x, origin.y, origin.z);
+            std::string after  = fmt::format("{} {} {}", entity->origin.x, entity->origin.y, entity->origin.z);
+            KeyValueChanged(*entity, "origin", before, after);
+        }
+
+        m_savedGeometry.clear();
+        m_savedOrigins.clear();
+        m_saved.clear();
+    }
+
+//-------------------------------------------------------------------------------------------------
+// Storage
+//-------------------------------------------------------------------------------------------------
+
+    void ActionHistory::Push(const char* name, std::span<const uint8_t> data)
+    {
+        // Anything that could have been redone is gone now.
+        m_records.resize(m_cursor);
+
+        size_t limit = size_t(std::max(undo_memory_limit.value, 0)) * 1024 * 1024;
+        if (m_limit != limit)
+        {
+            if (!m_records.empty())
+                Console.Warn("[History] undo_memory_limit changed, clearing undo history.");
+
+            Clear();
+            m_arena = {};
+            m_limit = limit;
+        }
+
+        if (data.size() > m_limit)
+        {
+            Console.Warn("[History] '{}' needs {} bytes, more than undo_memory_limit. Clearing undo history.", name, data.size());
+            Clear();
+            return;
+        }
+
+        // Place after the newest record. Grow up to the limit first, then wrap around if it doesn't fit.
+        size_t offset = m_records.empty() ? 0 : m_records.back().offset + m_records.back().size;
+        if (offset + data.size() > m_arena.size() && m_arena.size() < m_limit)
+            m_arena.resize(std::min(m_limit, std::max(offset + data.size(), m_arena.size() * 2)));
+        if (offset + data.size() > m_arena.size())
+            offset = 0;
+
+        // Drop the oldest records that we're about to overwrite.
+        size_t evict = 0;
+        for (size_t i = 0; i < m_records.size(); i++)
+        {
+            const Record& record = m_records[i];
+            if (record.offset < offset + data.size() && offset < record.offset + record.size)
+                evict = i + 1;
+        }
+        m_records.erase(m_records.begin(), m_records.begin() + evict);
+
+        std::memcpy(&m_arena[offset], data.data(), data.size());
+        m_records.push_back(Record{ name, offset, data.size() });
+        m_cursor = m_records.size();
+    }
+
+    void ActionHistory::Clear()
+    {
+        m_records.clear();
+        m_cursor = 0;
+        m_lastEdit.entity = 0;
+    }
+
+    size_t ActionHistory::MemoryUsage() const
+    {
+        size_t usage = m_records.size() * sizeof(Record);
+        for (const Record& record : m_records)
+            usage += record.size;
+        return usage;
+    }
+
+//-------------------------------------------------------------------------------------------------
+// Undo/Redo
+//-------------------------------------------------------------------------------------------------
+
+    void ActionHistory::Undo()
+    {
+        // e.g. in the middle of a drag
+        if (m_recording || !CanUndo())
+            return;
+
+        m_lastEdit.entity = 0;
+        Apply(m_records[--m_cursor], true);
+    }
+
+    void ActionHistory::Redo()
+    {
+        // e.g. in the middle of a drag
+        if (m_recording || !CanRedo())
+            return;
+
+        m_lastEdit.entity = 0;
+        Apply(m_records[m_cursor++], false);
+    }
+
+    void ActionHistory::Apply(const Record& record, bool undo)
+    {
+        struct Delta
+        {
+            DeltaType type;
+            std::span<const uint8_t> payload;
+        };
+
+        static std::vector<Delta> deltas;
+        deltas.clear();
+
+        const uint8_t* data = &m_arena[record.offset];
+        const uint8_t* end  = data + record.size;
+        while (data < end)
+        {
+            HistoryReader in{ data };
+            DeltaType type = in.Read<DeltaType>();
+            uint32_t  size = in.Read<uint32_t>();
+            deltas.push_back(Delta{ type, std::span(in.data, size) });
+            data = in.data + size;
+        }
+
+        if (undo)
+        {
+            for (auto it = deltas.rbegin(); it != deltas.rend(); ++it)
+                ApplyDelta(it->type, it->payload, true);
+        }
+        else
+        {
+            for (const Delta& delta : deltas)
+                ApplyDelta(delta.type, delta.payload, false);
+        }
+
+        // Selected things may have moved.
+        Selection.InvalidateBounds();
+    }
+
+    void ActionHistory::ApplyDelta(DeltaType type, std::span<const uint8_t> payload, bool undo)
+    {
+        HistoryReader in{ payload.data() };
+
+        switch (type)
+        {
+            case DeltaType::SolidAdded:
+            case DeltaType::SolidRemoved:
+            {
+                AtomID parentID = in.Read<AtomID>();
+                AtomID solidID  = in.Read<AtomID>();
+
+                bool add = (type == DeltaType::SolidAdded) != undo;
+                if (add)
+                {
+                    auto* parent = static_cast<BrushEntity*>(Atom::FindAtom(parentID));
+                    if (!parent)
+                        return Console.Warn("[History] Can't restore solid, its entity no longer exists.");
+
+                    Solid& solid = parent->AddBrush(in.ReadSides());
+                    solid.SetAtomID(solidID);
+                }
+                else
+                {
+                    auto* solid = static_cast<Solid*>(Atom::FindAtom(solidID));
+                    if (!solid)
+                        return Console.Warn("[History] Can't remove solid, it no longer exists.");
+
+                    solid->GetParent()->RemoveBrush(*solid);
+                }
+                break;
+            }
+
+            case DeltaType::EntityAdded:
+            case DeltaType::EntityRemoved:
+            {
+                if (!Core.map)
+                    return;
+
+                bool add = (type == DeltaType::EntityAdded) != undo;
+                if (add)
+                {
+                    Core.map->AddEntity(in.ReadEntity(*Core.map));
+                }
+                else
+                {
+                    auto* entity = static_cast<Entity*>(Atom::FindAtom(in.Read<AtomID>()));
+                    if (!entity)
+                        return Console.Warn("[History] Can't remove entity, it no longer exists.");
+
+                    Core.map->RemoveEntity(*entity);
+                }
+                break;
+            }
+
+            case DeltaType::SidesChanged:
+            {
+                auto* solid = static_cast<Solid*>(Atom::FindAtom(in.Read<AtomID>()));
+                if (!solid)
+                    return Console.Warn("[History] Can't edit solid, it no longer exists.");
+
+                std::vector<Side> before = in.ReadSides();
+                std::vector<Side> after  = in.ReadSides();
+                solid->SetSides(undo ? std::move(before) : std::move(after));
+                solid->UpdateMesh();
+                break;
+            }
+
+            case DeltaType::KeyValueChanged:
+            {
+                auto* entity = static_cast<Entity*>(Atom::FindAtom(in.Read<AtomID>()));
+                if (!entity)
+                    return Console.Warn("[History] Can't edit keyvalue, its entity no longer exists.");
+
+                std::string_view key    = in.ReadString();
+                std::string_view before = in.ReadString();
+                std::string_view after  = in.ReadString();
+                SetKeyValue(*entity, key, undo ? before : after);
+                break;
+            }
+
+            case DeltaType::GeometryChanged:
+            {
+                auto* solid = static_cast<Solid*>(Atom::FindAtom(in.Read<AtomID>()));
+                if (!solid)
+                    return Console.Warn("[History] Can't restore solid, it no longer exists.");
+
+                // Skip over the one we don't want.
+                uint32_t beforeSize = in.Read<uint32_t>();
+                if (!undo)
+                    in.data += beforeSize;
+
+                solid->RestoreGeometry(in.ReadGeometry());
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Atom.h"
+#include "Face.h"
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace chisel
+{
+    /**
+     * Undo/redo history, stored as compact binary deltas in a ring buffer.
+     *
+     * Actions are recorded by describing what changed:
+     *
+     *     history.Begin("Add Cube");
+     *     Solid& cube = map.AddBrush(sides);
+     *     history.SolidAdded(cube);
+     *     history.End();
+     *
+     * Deltas recorded outside of Begin/End become an action of their own.
+     * Once the history is over undo_memory_limit, the oldest actions are dropped.
+     */
+    class ActionHistory
+    {
+    public:
+        ActionHistory();
+
+    // Recording //
+
+        void Begin(const char* name);
+        void End();
+        bool IsRecording() const { return m_recording != nullptr; }
+
+        // Call after adding a solid.
+        void SolidAdded(const Solid& solid);
+        // Call before removing a solid.
+        void SolidRemoved(const Solid& solid);
+        // Call after replacing a solid's sides.
+        void SidesChanged(const Solid& solid, const std::vector<Side>& before);
+        // Call after adding an entity, with its solids.
+        void EntityAdded(const Entity& entity);
+        // Call before removing an entity.
+        void EntityRemoved(const Entity& entity);
+        // SolidAdded/EntityAdded for everything in the selection, e.g. right after duplicating it.
+        void SelectionAdded();
+        // Call after changing a keyvalue. Repeated edits of the same key are merged.
+        void KeyValueChanged(const Entity& entity, std::string_view key, std::string_view before, std::string_view after);
+
+        // Call before transforming a solid while recording. Its built faces and meshes
+        // are saved now and again at End, so undo/redo restore them without rebuilding.
+        void SaveGeometry(Solid& solid);
+        // Call before moving a point entity while recording, its origin is saved at End.
+        void SaveOrigin(const Entity& entity);
+        // SaveGeometry/SaveOrigin for everything in the selection.
+        void SaveSelection();
+
+    // Undo/Redo //
+
+        bool CanUndo() const { return m_cursor > 0; }
+        bool CanRedo() const { return m_cursor < m_records.size(); }
+
+        void Undo();
+        void Redo();
+
+        void Clear();
+
+    // Memory //
+
+        size_t Count() const { return m_records.size(); }
+        size_t MemoryUsage() const;
+        // Allocated so far, grows as actions are added up to undo_memory_limit.
+        size_t MemoryCapacity() const { return m_arena.size(); }
+
+    private:
+        enum class DeltaType : uint8_t
+        {
+            SolidAdded,
+            SolidRemoved,
+            EntityAdded,
+            EntityRemoved,
+            SidesChanged,
+            KeyValueChanged,
+            GeometryChanged,
+        };
+
+        struct Record
+        {
+            const char* name;
+            size_t      offset; // Into m_arena
+            size_t      size;
+        };
+
+        size_t BeginDelta(DeltaType type);
+        void   EndDelta(size_t header);
+
+        void Push(const char* name, std::span<const uint8_t> data);
+        void Apply(const Record& record, bool undo);
+        void ApplyDelta(DeltaType type, std::span<const uint8_t> payload, bool undo);
+
+        std::vector<uint8_t> m_arena;
+        size_t               m_limit = 0; // undo_memory_limit when the arena was started
+        std::deque<Record>   m_records;
+        size_t               m_cursor = 0; // Records before this are done, the rest can be redone
+
+        // The action being recorded
+        const char*          m_recording = nullptr;
+        std::vector<uint8_t> m_scratch;
+
+        // Saved with SaveGeometry/SaveOrigin, to compare against at End
+        struct SavedGeometry
+        {
+            AtomID solid;
+            size_t offset; // Into m_saved
+            size_t size;
+        };
+        std::vector<SavedGeometry>              m_savedGeometry;
+        std::vector<std::pair<AtomID, vec3>>    m_savedOrigins;
+        std::vector<uint8_t>                    m_saved;
+
+        void FlushSaved();
+
+        // The last keyvalue edit, for merging
+        struct
+        {
+            AtomID      entity = 0;
+            std::string key;
+            std::string before;
+        } m_lastEdit;
+    };
+}
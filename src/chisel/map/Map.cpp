@@ -1,7 +1,32 @@
 #include "Map.h"
 
+#include "chisel/Core.h"
+#include "console/ConCommand.h"
+
+#include <algorithm>
+
 namespace chisel
 {
+    static ConCommand brush_memory("brush_memory", "Print memory used by brush geometry.", []()
+    {
+        if (!Core.map)
+            return;
+
+        auto MB = [](size_t bytes) { return bytes / (1024.0 * 1024.0); };
+
+        Map::BrushMemory memory = Core.map->GetBrushMemory();
+        Console.Log("Brushes: {} solids, {} faces", memory.solids, memory.faces);
+        Console.Log("  CPU:    {:.2f} MB sides/faces/points, {:.2f} MB mesh copies", MB(memory.cpu), MB(memory.meshes));
+        Console.Log("  GPU:    {:.2f} MB vertices/indices", MB(memory.gpu));
+
+        if (!Core.brushAllocator)
+            return;
+
+        BrushAllocator::Stats stats = Core.brushAllocator->stats();
+        Console.Log("  Arena:  {} pages, {:.2f} MB used of {:.2f} MB", stats.pages, MB(stats.used), MB(stats.capacity));
+        Console.Log("          {:.2f} MB free, largest free block {:.2f} MB, {:.2f} MB waiting on the GPU", MB(stats.free), MB(stats.largestFree), MB(stats.pendingFree));
+    });
+
     Map::Map()
         : BrushEntity(nullptr)
     {
@@ -16,15 +41,23 @@ namespace chisel
 
     bool Map::Empty() const
     {
-        return m_solids.empty() && m_entities.empty();
+        return m_solids.empty() && m_dormantSolids.empty() && m_entities.empty();
     }
 
     void Map::Clear()
     {
+        m_actions.Clear();
         m_solids.clear();
+        m_dormantSolids.clear();
         for (Entity* ent : m_entities)
             delete ent;
         m_entities.clear();
+        m_pointEntities.clear();
+        m_modelEntities.clear();
+        m_brushEntities.clear();
+        m_proxies.clear();
+        m_dirtyProxies.clear();
+        Core.SceneChanged();
     }
 
     bool Map::IsMap()
@@ -36,25 +69,159 @@ namespace chisel
     {
         PointEntity* ent = new PointEntity(this);
         ent->classname = classname;
-        m_entities.push_back(ent);
+        AddEntity(ent);
         return ent;
     }
 
     void Map::AddEntity(Entity* entity)
     {
-        // CHANGE ME
-        m_entities.push_back(entity);
+        auto [handle, slot] = m_entities.emplace(entity);
+        entity->m_handle = handle;
+        entity->m_order = m_nextOrder++;
+
+        switch (entity->GetType())
+        {
+            case EntityType::Point: AddToList(m_pointEntities, entity); break;
+            case EntityType::Model: AddToList(m_modelEntities, entity); break;
+            case EntityType::Brush: AddToList(m_brushEntities, entity); break;
+        }
+
+        if (!entity->IsBrushEntity())
+        {
+            // Built when it's next drawn, whatever gets set up after adding it.
+            entity->m_proxyIndex = uint32_t(m_proxies.size());
+            m_proxies.push_back(EntityProxy{ .entity = static_cast<PointEntity*>(entity) });
+            ProxyChanged(*entity);
+        }
     }
 
     void Map::RemoveEntity(Entity& entity)
     {
-        // SUCKS
-        m_entities.erase(std::remove_if(m_entities.begin(),
-            m_entities.end(),
-            [&](Entity* a)-> bool
-            { return a == &entity; }),
-            m_entities.end());
+        switch (entity.GetType())
+        {
+            case EntityType::Point: RemoveFromList(m_pointEntities, &entity); break;
+            case EntityType::Model: RemoveFromList(m_modelEntities, &entity); break;
+            case EntityType::Brush: RemoveFromList(m_brushEntities, &entity); break;
+        }
+
+        if (entity.m_proxyIndex != ~0u)
+        {
+            // Move the last one into the gap.
+            EntityProxy& last = m_proxies.back();
+            last.entity->m_proxyIndex = entity.m_proxyIndex;
+            m_proxies[entity.m_proxyIndex] = last;
+            m_proxies.pop_back();
+        }
 
+        m_entities.erase(entity.m_handle);
         delete &entity;
+        Core.SceneChanged();
+    }
+
+    std::vector<Entity*> Map::EntitiesInOrder()
+    {
+        std::vector<Entity*> entities(m_entities.begin(), m_entities.end());
+        std::sort(entities.begin(), entities.end(), [](const Entity* a, const Entity* b) { return a->m_order < b->m_order; });
+        return entities;
+    }
+
+    void Map::ProxyChanged(Entity& entity)
+    {
+        entity.m_proxyDirty = true;
+        m_dirtyProxies.push_back(entity.m_handle);
+        Core.SceneChanged();
+    }
+
+    static void BuildProxy(Map::EntityProxy& proxy, const Entity& entity)
+    {
+        const FGD::Class* cls = entity.GetClass();
+
+        proxy.cls      = cls;
+        proxy.origin   = entity.origin;
+        proxy.id       = entity.GetSelectionID();
+        proxy.selected = entity.IsSelected();
+        proxy.sprite   = cls ? cls->texture.ptr() : nullptr;
+        proxy.model    = nullptr;
+        if (cls)
+            proxy.model = cls->isProp ? entity.GetModel().ptr() : cls->model.ptr();
+
+        vec3 mins = cls ? vec3(cls->bbox[0]) : vec3(-8);
+        vec3 maxs = cls ? vec3(cls->bbox[1]) : vec3(8);
+        proxy.bounds = AABB{ entity.origin + mins, entity.origin + maxs };
+    }
+
+    std::span<const Map::EntityProxy> Map::EntityProxies()
+    {
+        for (PoolHandle handle : m_dirtyProxies)
+        {
+            // Might have been removed since.
+            Entity* entity = FindEntity(handle);
+            if (!entity)
+                continue;
+
+            entity->m_proxyDirty = false;
+            BuildProxy(m_proxies[entity->m_proxyIndex], *entity);
+        }
+        m_dirtyProxies.clear();
+
+        return m_proxies;
+    }
+
+    static void AddBrushMemory(BrushEntity& entity, Map::BrushMemory& memory)
+    {
+        for (const Solid& solid : entity.Brushes())
+        {
+            memory.solids++;
+            memory.faces += solid.GetFaces().size();
+
+            memory.cpu += sizeof(Solid);
+            memory.cpu += solid.GetSides().capacity() * sizeof(Side);
+            memory.cpu += solid.GetFaces().capacity() * sizeof(Face);
+            memory.cpu += solid.GetPoints().capacity() * sizeof(vec3);
+            for (const Side& side : solid.GetSides())
+            {
+                if (side.disp)
+                    memory.cpu += side.disp->verts.size() * sizeof(DispVert);
+            }
+
+            for (const BrushMesh& mesh : solid.GetMeshes())
+            {
+                memory.cpu    += sizeof(BrushMesh);
+                memory.meshes += mesh.vertices.capacity() * sizeof(VertexSolid) + mesh.indices.capacity() * sizeof(uint32_t);
+                memory.gpu    += mesh.vertexCount * BrushVertexStride() + mesh.indexCount * sizeof(uint32_t);
+            }
+        }
+    }
+
+    Map::BrushMemory Map::GetBrushMemory()
+    {
+        BrushMemory memory;
+        AddBrushMemory(*this, memory);
+        for (BrushEntity* entity : m_brushEntities)
+            AddBrushMemory(*entity, memory);
+        return memory;
+    }
+
+    Entity* Map::FindEntity(PoolHandle handle)
+    {
+        Entity** entity = m_entities.get(handle);
+        return entity ? *entity : nullptr;
+    }
+
+    template <typename T>
+    void Map::AddToList(std::vector<T*>& list, Entity* entity)
+    {
+        entity->m_typeIndex = uint32_t(list.size());
+        list.push_back(static_cast<T*>(entity));
+    }
+
+    // Swaps the last one into the gap.
+    template <typename T>
+    void Map::RemoveFromList(std::vector<T*>& list, Entity* entity)
+    {
+        uint32_t index = entity->m_typeIndex;
+        list[index] = list.back();
+        list[index]->m_typeIndex = index;
+        list.pop_back();
     }
 }
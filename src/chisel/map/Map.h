@@ -1,9 +1,9 @@
 #pragma once
 
-#include <list>
-
 #include "Entity.h"
-#include "Action.h"
+#include "History.h"
+
+#include <span>
 
 namespace chisel
 {
@@ -27,13 +27,72 @@ namespace chisel
         void AddEntity(Entity *entity);
         void RemoveEntity(Entity& entity);
 
+        // nullptr if the entity has since been removed.
+        Entity* FindEntity(PoolHandle handle);
+
+        // Every entity, in no particular order: removed entities' slots are reused by the next added.
         auto Entities() { return IteratorPassthru(m_entities); }
-        ActionList& Actions() { return m_actions; }
+
+        // Every entity in the order they were added, for writing files that diff well between saves.
+        std::vector<Entity*> EntitiesInOrder();
+
+        // Entities split by type, for loops that only care about one kind.
+        auto PointEntities() { return IteratorPassthru(m_pointEntities); }
+        auto ModelEntities() { return IteratorPassthru(m_modelEntities); }
+        auto BrushEntities() { return IteratorPassthru(m_brushEntities); }
+
+        ActionHistory& Actions() { return m_actions; }
+
+    // Render proxies //
+
+        // Everything needed to draw a point or model entity, without going back to the entity or FGD.
+        struct EntityProxy
+        {
+            const FGD::Class* cls    = nullptr; // nullptr if the FGD doesn't have it
+            Texture*          sprite = nullptr;
+            Mesh*             model  = nullptr;
+            AABB              bounds;
+            vec3              origin;
+            SelectionID       id       = 0;
+            bool              selected = false;
+            PointEntity*      entity   = nullptr;
+        };
+
+        // One per point and model entity, in no particular order.
+        // Rebuilds the ones marked dirty since the last call.
+        std::span<const EntityProxy> EntityProxies();
+
+        struct BrushMemory
+        {
+            size_t solids = 0;
+            size_t faces  = 0;
+            size_t cpu    = 0; // Sides, faces and points
+            size_t meshes = 0; // CPU mesh copies kept by r_keep_brush_geometry
+            size_t gpu    = 0; // Uploaded vertices and indices
+        };
+
+        // Memory used by the solids of the world and every brush entity.
+        BrushMemory GetBrushMemory();
 
     private:
-        // TODO: Polymorphic linked list
-        std::vector<Entity*> m_entities;
+        template <typename T>
+        void AddToList(std::vector<T*>& list, Entity* entity);
+        template <typename T>
+        void RemoveFromList(std::vector<T*>& list, Entity* entity);
+
+        friend class Entity;
+        void ProxyChanged(Entity& entity);
+
+        Pool<Entity*> m_entities;
+        uint64_t      m_nextOrder = 0;
+
+        std::vector<PointEntity*> m_pointEntities;
+        std::vector<ModelEntity*> m_modelEntities;
+        std::vector<BrushEntity*> m_brushEntities;
+
+        std::vector<EntityProxy> m_proxies;
+        std::vector<PoolHandle>  m_dirtyProxies;
 
-        ActionList m_actions;
+        ActionHistory m_actions;
     };
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "chisel/map/Solid.h"
-#include "chisel/Chisel.h"
+#include "chisel/map/Map.h"
+#include "chisel/Core.h"
 #include "common/Bit.h"
+#include "common/Profiler.h"
 #include "math/Winding.h"
 
 #include <unordered_set>
@@ -9,7 +11,10 @@ namespace chisel
 {
     static auto RebuildDisplacements = [](bool& b)
     {
-        for (auto& solid : Chisel.map.Brushes()) {
+        if (!Core.map)
+            return;
+
+        for (auto& solid : Core.map->Brushes()) {
             if (solid.HasDisplacement())
                 solid.UpdateMesh();
         }
@@ -17,6 +22,34 @@ namespace chisel
 
     ConVar<bool> r_displacements("r_displacements", true, "Render displacements", RebuildDisplacements);
     ConVar<bool> r_disp_mask_solid("r_disp_mask_solid", true, "Hide unused faces of displacement brushes", RebuildDisplacements);
+    static void RebuildMeshes(BrushEntity& entity)
+    {
+        for (auto& solid : entity.Brushes())
+            solid.UpdateMeshes();
+    }
+
+    ConVar<bool> r_brush_packed_vertices("r_brush_packed_vertices", false, "Upload brushes with the compact VertexSolidPacked format.", [](bool& b)
+    {
+        // Nothing could draw them.
+        if (b && !Core.packedBrushShaders)
+        {
+            Console.Warn("r_brush_packed_vertices: The packed brush shaders haven't been compiled, run shaders/build.bat.");
+            b = false;
+        }
+
+        if (!Core.map)
+            return;
+
+        RebuildMeshes(*Core.map);
+        for (BrushEntity* entity : Core.map->BrushEntities())
+            RebuildMeshes(*entity);
+    });
+
+    ConVar<bool> r_keep_brush_geometry("r_keep_brush_geometry", false, "Keep a CPU copy of brush vertices and indices once uploaded. Lets compaction move meshes without rebuilding them, and undo save them without building them again, at the cost of memory.");
+
+    // Meshes are built here, uploaded, then only copied to the BrushMesh with r_keep_brush_geometry.
+    // Per thread, meshes can be built on several at once.
+    static thread_local std::vector<BrushMeshData> s_meshData;
 
     Solid::Solid(BrushEntity* parent)
         : Atom(parent)
@@ -41,19 +74,6 @@ namespace chisel
             UpdateMesh();
     }
 
-    Solid::Solid(Solid&& other)
-        : Atom(other.m_parent)
-    {
-        this->m_displacement = other.m_displacement;
-        this->m_meshes = std::move(other.m_meshes);
-        this->m_sides = std::move(other.m_sides);
-        this->m_faces = std::move(other.m_faces);
-        this->m_bounds = other.m_bounds;
-
-        for (auto& face : m_faces)
-            face.solid = this;
-    }
-        
     Solid::~Solid()
     {
     }
@@ -63,32 +83,35 @@ namespace chisel
         m_sides.emplace_back(std::move(side));
     }
 
-    void Solid::UpdateMesh()
+    void Solid::SetSides(std::vector<Side> sides)
     {
-        static bit::bitvector shouldUse;
-        static bit::bitvector sideSelected;
-        static std::unordered_set<AssetID> uniqueMaterials;
+        m_sides = std::move(sides);
 
-        BrushGPUAllocator& a = *Chisel.brushAllocator;
+        m_displacement = false;
+        for (Side& side : m_sides)
+            m_displacement |= side.disp.has_value();
+    }
 
-        // TODO: Avoid clearing meshes out every time.
-        for (auto& mesh : m_meshes)
-        {
-            if (mesh.alloc)
-            {
-                a.free(*mesh.alloc);
-                mesh.alloc = std::nullopt;
-            }
-        }
+    void Solid::UpdateMesh()
+    {
+        PROFILE_SCOPE("Solid::UpdateMesh");
+        UpdateFaces();
+        UpdateMeshes();
+    }
 
-        uniqueMaterials.clear();
-        uniqueMaterials.reserve(m_sides.size());
-        m_meshes.clear();
-        m_meshes.reserve(m_sides.size());
-        shouldUse.clearAll();
-        shouldUse.ensureSize(m_sides.size());
+    void Solid::UpdateFaces()
+    {
+        // Gets the previous solid's point buffer back, so rebuilding doesn't allocate.
+        static thread_local SolidWindings windings;
+        ClipSides(m_sides, windings);
+        UpdateFaces(windings);
+    }
 
-        bool displacement = r_displacements && HasDisplacement();
+    void Solid::UpdateFaces(SolidWindings& windings)
+    {
+        PROFILE_SCOPE("Solid::UpdateFaces");
+
+        static thread_local bit::bitvector sideSelected;
 
         sideSelected.clearAll();
         sideSelected.ensureSize(m_sides.size());
@@ -100,21 +123,44 @@ namespace chisel
             }
         }
         m_faces.clear();
-        m_faces.reserve(m_sides.size());
+        m_faces.reserve(windings.sides.size());
+        std::swap(m_points, windings.points);
+
+        for (const SideWinding& winding : windings.sides)
+        {
+            std::span<const vec3> points(m_points.data() + winding.firstPoint, winding.pointCount);
+            auto& face = m_faces.emplace_back(this, winding.sideIdx, &m_sides[winding.sideIdx], points);
+            if (sideSelected.get(winding.sideIdx))
+                Selection.Select(&face);
+        }
+    }
+
+    /*static*/ void Solid::ClipSides(const std::vector<Side>& sides, SolidWindings& windings)
+    {
+        // Called from import threads
+        thread_local bit::bitvector shouldUse;
+
+        shouldUse.clearAll();
+        shouldUse.ensureSize(sides.size());
+
+        bool displacement = false;
+        if (r_displacements)
+        {
+            for (const Side& side : sides)
+                displacement |= side.disp.has_value();
+        }
 
-        for (uint32_t i = 0; i < m_sides.size(); i++)
+        windings.clear();
+        windings.sides.reserve(sides.size());
+
+        for (uint32_t i = 0; i < sides.size(); i++)
         {
             // Displacements: exclude unused sides
-            if (displacement && r_disp_mask_solid && !m_sides[i].disp.has_value())
+            if (displacement && r_disp_mask_solid && !sides[i].disp.has_value())
                 continue;
 
-            AssetID id = InvalidAssetID;
-            if (m_sides[i].material != nullptr)
-                id = m_sides[i].material->id;
-            uniqueMaterials.insert(id);
-
-            glm::vec3 normal0 = m_sides[i].plane.normal;
-            float dist0 = m_sides[i].plane.Dist();
+            glm::vec3 normal0 = sides[i].plane.normal;
+            float dist0 = sides[i].plane.Dist();
             if (normal0 == glm::vec3(0.0f))
             {
                 shouldUse.set(i, false);
@@ -124,8 +170,8 @@ namespace chisel
             shouldUse.set(i, true);
             for (uint32_t j = 0; j < i; j++)
             {
-                glm::vec3 normal1 = m_sides[j].plane.normal;
-                float dist1 = m_sides[j].plane.Dist();
+                glm::vec3 normal1 = sides[j].plane.normal;
+                float dist1 = sides[j].plane.Dist();
 
                 if (glm::dot(normal0, normal1) > 0.999f && (fabsf(dist0 - dist1) < 0.01f))
                 {
@@ -142,17 +188,17 @@ namespace chisel
             {
                 uint32_t sideIdx = i * 32 + idx;
 
-                Side& side = m_sides[sideIdx];
+                const Side& side = sides[sideIdx];
 
                 Winding scratchWindings[2];
                 auto* currentWinding = &scratchWindings[0];
 
                 Winding::CreateFromPlane(side.plane, *currentWinding);
-                for (uint32_t j = 0; j < m_sides.size() && currentWinding; j++)
+                for (uint32_t j = 0; j < sides.size() && currentWinding; j++)
                 {
                     if (j != sideIdx)
                     {
-                        Plane clipPlane = Plane(-m_sides[j].plane.normal, -m_sides[j].plane.offset);
+                        Plane clipPlane = Plane(-sides[j].plane.normal, -sides[j].plane.offset);
 
                         currentWinding = Winding::Clip(clipPlane, *currentWinding, currentWinding == &scratchWindings[0] ? scratchWindings[1] : scratchWindings[0]);
                     }
@@ -196,39 +242,94 @@ namespace chisel
                     }
 #endif
                     
-                    auto& face = m_faces.emplace_back(this, sideIdx, &side, std::vector<vec3>(currentWinding->points, currentWinding->points + currentWinding->count));
-                    if (sideSelected.get(sideIdx))
-                        Selection.Select(&face);
+                    windings.sides.emplace_back(SideWinding {
+                        sideIdx,
+                        uint(windings.points.size()),
+                        uint(currentWinding->count)
+                    });
+                    windings.points.insert(windings.points.end(), currentWinding->points, currentWinding->points + currentWinding->count);
                 }
             }
         }
+    }
+
+    void Solid::UpdateMeshes()
+    {
+        PROFILE_SCOPE("Solid::UpdateMeshes");
+
+        Core.SceneChanged();
+
+        // TODO: Avoid clearing meshes out every time.
+        FreeMeshes();
+        m_meshes.clear();
+
+        BuildMeshes();
+
+        // Upload all meshes after they're complete
+        BrushAllocator& a = *Core.brushAllocator;
+        a.open();
+        for (size_t i = 0; i < m_meshes.size(); i++)
+        {
+            UploadMesh(a, m_meshes[i], s_meshData[i].vertices, s_meshData[i].indices);
+            if (r_keep_brush_geometry)
+            {
+                m_meshes[i].vertices = s_meshData[i].vertices;
+                m_meshes[i].indices  = s_meshData[i].indices;
+            }
+        }
+        a.close();
+    }
+
+    std::span<const BrushMeshData> Solid::BuildMeshData()
+    {
+        BuildMeshes();
+        return std::span(s_meshData.data(), m_meshes.size());
+    }
+
+    void Solid::BuildMeshes()
+    {
+        static thread_local std::unordered_set<AssetID> uniqueMaterials;
+
+        bool displacement = r_displacements && HasDisplacement();
+
+        uniqueMaterials.clear();
+        uniqueMaterials.reserve(m_faces.size());
+        for (auto& face : m_faces)
+        {
+            AssetID id = InvalidAssetID;
+            if (face.side->material != nullptr)
+                id = face.side->material->id;
+            uniqueMaterials.insert(id);
+        }
 
         if (displacement)
             m_meshes.resize(m_faces.size());
         else
             m_meshes.resize(uniqueMaterials.size());
 
+        if (s_meshData.size() < m_meshes.size())
+            s_meshData.resize(m_meshes.size());
+        for (size_t i = 0; i < m_meshes.size(); i++)
+        {
+            s_meshData[i].vertices.clear();
+            s_meshData[i].indices.clear();
+        }
+
         m_bounds = std::nullopt;
 
         uint faceIdx = 0;
 
-        static DispInfo dispDefault = DispInfo(0);
+        static thread_local DispInfo dispDefault = DispInfo(0);
 
         // Create mesh from faces
         for (auto& face : m_faces)
         {
-            auto ComputeUV = [&](vec3 pos) {
-                float mappingWidth = 32.0f;
-                float mappingHeight = 32.0f;
-                if (face.side->material != nullptr && face.side->material->baseTexture != nullptr && face.side->material->baseTexture->texture != nullptr)
-                {
-                    D3D11_TEXTURE2D_DESC desc;
-                    face.side->material->baseTexture->texture->GetDesc(&desc);
-
-                    mappingWidth = float(desc.Width);
-                    mappingHeight = float(desc.Height);
-                }
+            // Texture size only changes with the material, not per vertex.
+            uint2 mappingSize = face.side->material != nullptr ? face.side->material->GetMappingSize() : Material::DefaultMappingSize;
+            float mappingWidth = float(mappingSize.x);
+            float mappingHeight = float(mappingSize.y);
 
+            auto ComputeUV = [&](vec3 pos) {
                 float u = glm::dot(vec3(face.side->textureAxes[0].xyz), vec3(pos)) / face.side->scale[0] + face.side->textureAxes[0].w;
                 float v = glm::dot(vec3(face.side->textureAxes[1].xyz), vec3(pos)) / face.side->scale[1] + face.side->textureAxes[1].w;
 
@@ -243,97 +344,55 @@ namespace chisel
                 DispInfo& disp = face.side->disp.has_value() ? *(face.side->disp) : dispDefault;
 
                 assert(face.points.size() >= 3);
-                
-                uint numVertices = disp.verts.size();
-                int length = disp.length;
-                int numSlices = length - 1;
-                uint numIndices = disp.GetIndexCount();
 
                 disp.UpdatePointStartIndex(face.points);
 
-                vec3 edgeInt[2];
-                edgeInt[0] = (face.points[(1 + disp.pointStartIndex) % 4] - face.points[(0 + disp.pointStartIndex) % 4]) / float(length - 1);
-                edgeInt[1] = (face.points[(2 + disp.pointStartIndex) % 4] - face.points[(3 + disp.pointStartIndex) % 4]) / float(length - 1);
+                vec3 corners[4];
+                for (uint i = 0; i < 4; i++)
+                    corners[i] = face.points[(i + disp.pointStartIndex) % 4];
 
-                auto& mesh = m_meshes[faceIdx];
-                mesh.material = face.side->material.ptr();
-                mesh.brush = this;
-                mesh.vertices.reserve(numVertices);
-                mesh.indices.reserve(numIndices);
-
-                for (uint y = 0; y < length; y++)
-                {
-                    vec3 endPts[2];
-                    endPts[0] = (edgeInt[0] * float(y)) + face.points[(0 + disp.pointStartIndex) % 4];
-                    endPts[1] = (edgeInt[1] * float(y)) + face.points[(3 + disp.pointStartIndex) % 4];
-
-                    vec3 seg = endPts[1] - endPts[0];
-                    vec3 segInt = seg / float(length - 1);
-
-                    for (uint x = 0; x < length; x++)
-                    {
-                        float xPercent = float(x) / float(numSlices);
-                        float yPercent = float(y) / float(numSlices);
-
-                        vec3 pos = endPts[0] + segInt * float(x);
-                        vec2 uv  = ComputeUV(pos);
+                // ComputeUV, with the divides folded in
+                DispMapping mapping;
+                float uScale = mappingWidth  ? 1.0f / (face.side->scale[0] * mappingWidth)  : 0.0f;
+                float vScale = mappingHeight ? 1.0f / (face.side->scale[1] * mappingHeight) : 0.0f;
+                mapping.uAxis   = vec3(face.side->textureAxes[0].xyz) * uScale;
+                mapping.vAxis   = vec3(face.side->textureAxes[1].xyz) * vScale;
+                mapping.uOffset = mappingWidth  ? face.side->textureAxes[0].w / mappingWidth  : 0.0f;
+                mapping.vOffset = mappingHeight ? face.side->textureAxes[1].w / mappingHeight : 0.0f;
 
-                        DispVert& vert = disp[y][x];
+                static thread_local DispSurface surface;
+                BuildDispSurface(disp, corners, face.side->plane.normal, mapping, surface);
 
-                        // Add elevation if any
-                        pos += face.side->plane.normal * disp.elevation;
+                m_bounds = m_bounds
+                    ? AABB::Extend(*m_bounds, surface.bounds)
+                    : surface.bounds;
 
-                        // Apply subdivision surface offset (not typically used)
-                        pos += vert.offset;
-
-                        // Add displacement field direction (normal) scaled by distance
-                        pos += vert.normal * vert.dist;
+                auto& mesh = m_meshes[faceIdx];
+                auto& data = s_meshData[faceIdx];
+                mesh.material = face.side->material.ptr();
+                mesh.brush = this;
 
-                        // Extend bounds
-                        m_bounds = m_bounds
-                            ? AABB::Extend(*m_bounds, pos)
-                            : AABB { pos, pos };
+                face.meshIdx = faceIdx;
+                face.startIndex = 0;
 
-                        mesh.vertices.emplace_back(VertexSolid {
-                            pos,
-                            face.side->plane.normal,
-                            vec3(uv, vert.alpha / 255.f),
-                            face.GetSelectionID()
-                        });
-                    }
-                }
-
-                for (uint y = 0; y < numSlices; y++)
+                uint32_t numVertices = uint32_t(disp.verts.size());
+                SelectionID id = face.GetSelectionID();
+                data.vertices.resize(numVertices);
+                for (uint32_t i = 0; i < numVertices; i++)
                 {
-                    for (uint x = 0; x < numSlices; x++)
-                    {
-                        bool even = (y * length + x) % 2 == 0;
-                        if (!even)
-                        {
-                            // 1, 2, 0 (clockwise from bottom left)
-                            mesh.indices.push_back(y * length + x);
-                            mesh.indices.push_back(y * length + x + 1);
-                            mesh.indices.push_back((y + 1) * length + x);
-
-                            // 3, 0, 2
-                            mesh.indices.push_back((y + 1) * length + x + 1);
-                            mesh.indices.push_back((y + 1) * length + x);
-                            mesh.indices.push_back(y * length + x + 1);
-                        }
-                        else
-                        {
-                            // 1, 0, 3
-                            mesh.indices.push_back((y + 1) * length + x + 1);
-                            mesh.indices.push_back((y + 1) * length + x);
-                            mesh.indices.push_back(y * length + x);
-
-                            // 3, 2, 1
-                            mesh.indices.push_back(y * length + x);
-                            mesh.indices.push_back(y * length + x + 1);
-                            mesh.indices.push_back((y + 1) * length + x + 1);
-                        }
-                    }
+                    data.vertices[i] = VertexSolid {
+                        vec3(surface.x[i], surface.y[i], surface.z[i]),
+                        vec3(surface.nx[i], surface.ny[i], surface.nz[i]),
+                        vec3(surface.u[i], surface.v[i], disp.verts[i].alpha / 255.f),
+                        id
+                    };
                 }
+
+                // Same triangles for every displacement of this power, and the LODs after them.
+                const DispIndexPattern& pattern = GetDispIndexPattern(disp.power);
+                data.indices.assign(pattern.indices.begin(), pattern.indices.end());
+                mesh.lods = pattern.lods;
+                mesh.lodCount = pattern.lodCount;
             }
             else // regular brush
             {
@@ -348,12 +407,13 @@ namespace chisel
 
                 uint32_t meshIdx = std::distance(uniqueMaterials.begin(), uniqueMaterials.find(id));
                 auto& mesh = m_meshes[meshIdx];
+                auto& data = s_meshData[meshIdx];
                 mesh.material = face.side->material.ptr();
                 mesh.brush = this;
-                uint32_t startingVertex = mesh.vertices.size();
-                uint32_t startingIndex = mesh.indices.size();
-                mesh.vertices.reserve(startingVertex + numVertices);
-                mesh.indices.reserve(startingIndex + numIndices);
+                uint32_t startingVertex = data.vertices.size();
+                uint32_t startingIndex = data.indices.size();
+                data.vertices.reserve(startingVertex + numVertices);
+                data.indices.reserve(startingIndex + numIndices);
 
                 face.meshIdx = meshIdx;
                 face.startIndex = startingIndex;
@@ -362,7 +422,7 @@ namespace chisel
                 {
                     vec3 pos = face.points[i];
 
-                    mesh.vertices.emplace_back(VertexSolid {
+                    data.vertices.emplace_back(VertexSolid {
                         pos,
                         face.side->plane.normal,
                         glm::vec3(ComputeUV(pos), 0.0f),
@@ -378,24 +438,160 @@ namespace chisel
                 const uint32_t numPolygons = numIndices / 3;
                 for (uint32_t i = 0; i < numPolygons; i++)
                 {
-                    mesh.indices.emplace_back(startingVertex + i + 2);
-                    mesh.indices.emplace_back(startingVertex + i + 1);
-                    mesh.indices.emplace_back(startingVertex);
+                    data.indices.emplace_back(startingVertex + i + 2);
+                    data.indices.emplace_back(startingVertex + i + 1);
+                    data.indices.emplace_back(startingVertex);
                 }
             }
             faceIdx++;
         }
+    }
 
-        // Upload all meshes after they're complete
+    void Solid::RestoreGeometry(SolidGeometry geometry)
+    {
+        Core.SceneChanged();
+
+        FreeMeshes();
+        SetSides(std::move(geometry.sides));
+
+        UpdateFaces(geometry.windings);
+
+        for (size_t i = 0; i < m_faces.size(); i++)
+        {
+            m_faces[i].meshIdx    = geometry.faceMeshes[i].meshIdx;
+            m_faces[i].startIndex = geometry.faceMeshes[i].startIndex;
+        }
+
+        // Face IDs come from this solid's and the side index,
+        // so the vertices still refer to the right faces.
+        m_meshes = std::move(geometry.meshes);
+        for (auto& mesh : m_meshes)
+            mesh.brush = this;
+
+        m_bounds = geometry.bounds;
+
+        BrushAllocator& a = *Core.brushAllocator;
         a.open();
         for (auto& mesh : m_meshes)
         {
-            uint32_t verticesSize = sizeof(VertexSolid) * mesh.vertices.size();
-            uint32_t indicesSize = sizeof(uint32_t) * mesh.indices.size();
-            mesh.alloc = a.alloc(verticesSize + indicesSize);
-            // Store vertices then indices.
-            memcpy(&a.data()[mesh.alloc->offset + 0],            mesh.vertices.data(), verticesSize);
-            memcpy(&a.data()[mesh.alloc->offset + verticesSize], mesh.indices.data(),  indicesSize);
+            UploadMesh(a, mesh, mesh.vertices, mesh.indices);
+            if (!r_keep_brush_geometry)
+            {
+                mesh.vertices = {};
+                mesh.indices  = {};
+            }
+        }
+        a.close();
+    }
+
+    void Solid::FreeMeshes()
+    {
+        BrushAllocator& a = *Core.brushAllocator;
+        for (auto& mesh : m_meshes)
+        {
+            if (mesh.alloc)
+            {
+                a.free(*mesh.alloc);
+                mesh.alloc = std::nullopt;
+            }
+        }
+    }
+
+    uint32_t BrushVertexStride()
+    {
+        return r_brush_packed_vertices ? sizeof(VertexSolidPacked) : sizeof(VertexSolid);
+    }
+
+    static void OctEncode(vec3 n, int16_t out[2])
+    {
+        auto signNotZero = [](vec2 v) { return vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f); };
+
+        vec2 p = vec2(n.x, n.y) / (fabsf(n.x) + fabsf(n.y) + fabsf(n.z));
+        if (n.z < 0.0f)
+            p = (1.0f - glm::abs(vec2(p.y, p.x))) * signNotZero(p);
+
+        p = glm::clamp(p, -1.0f, 1.0f);
+        out[0] = int16_t(roundf(p.x * 32767.0f));
+        out[1] = int16_t(roundf(p.y * 32767.0f));
+    }
+
+    static VertexSolidPacked PackVertex(const VertexSolid& vertex)
+    {
+        VertexSolidPacked packed{};
+        packed.position = vertex.position;
+        packed.uv       = vec2(vertex.uv.x, vertex.uv.y);
+        packed.part     = uint8_t(SelectionIDs::Part(vertex.face));
+        packed.alpha    = uint8_t(glm::clamp(vertex.uv.z, 0.0f, 1.0f) * 255.0f + 0.5f);
+        OctEncode(vertex.normal, packed.normal);
+        return packed;
+    }
+
+    /*static*/ void Solid::UploadMesh(BrushAllocator& a, BrushMesh& mesh, std::span<const VertexSolid> vertices, std::span<const uint32_t> indices)
+    {
+        static thread_local std::vector<VertexSolidPacked> packed;
+
+        mesh.vertexCount = uint32_t(vertices.size());
+        mesh.indexCount  = uint32_t(indices.size());
+
+        const void* vertexData = vertices.data();
+        if (r_brush_packed_vertices)
+        {
+            packed.resize(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++)
+                packed[i] = PackVertex(vertices[i]);
+            vertexData = packed.data();
+        }
+
+        uint32_t verticesSize = BrushVertexStride() * vertices.size();
+        uint32_t indicesSize = sizeof(uint32_t) * indices.size();
+
+        mesh.alloc = std::nullopt;
+        BrushAllocator::Allocation alloc = a.alloc(verticesSize + indicesSize);
+        if (alloc.offset == BrushAllocator::Allocation::NO_SPACE)
+        {
+            Console.Error("[Brushes] Out of brush memory!");
+            return;
+        }
+
+        uint8_t* data = a.data(alloc.page);
+        if (!data)
+        {
+            a.free(alloc);
+            return;
+        }
+
+        // Store vertices then indices.
+        mesh.alloc = alloc;
+        memcpy(&data[alloc.offset + 0],            vertexData,     verticesSize);
+        memcpy(&data[alloc.offset + verticesSize], indices.data(), indicesSize);
+    }
+
+    void Solid::ReuploadMeshes()
+    {
+        Core.SceneChanged();
+
+        bool kept = std::all_of(m_meshes.begin(), m_meshes.end(), [](const BrushMesh& mesh)
+        {
+            return mesh.vertexCount == 0 || !mesh.vertices.empty();
+        });
+
+        // Without CPU copies, build them again (but no CSG).
+        if (!kept)
+        {
+            UpdateMeshes();
+            return;
+        }
+
+        BrushAllocator& a = *Core.brushAllocator;
+        a.open();
+        for (auto& mesh : m_meshes)
+        {
+            auto old = mesh.alloc;
+            UploadMesh(a, mesh, mesh.vertices, mesh.indices);
+            if (!mesh.alloc)
+                mesh.alloc = old; // Stay where it was
+            else if (old)
+                a.free(*old);
         }
         a.close();
     }
@@ -495,7 +691,7 @@ namespace chisel
 
     Selectable* Solid::ResolveSelectable()
     {
-        if (Chisel.selectMode == SelectMode::Solids)
+        if (Core.selectMode == SelectMode::Solids)
             return this;
 
         // Groups/Objects
@@ -505,6 +701,16 @@ namespace chisel
         return m_parent;
     }
 
+    Selectable* Solid::FindPart(uint32_t n)
+    {
+        for (auto& face : m_faces)
+        {
+            if (face.sideIdx == n || (n == SelectionIDs::LastPart && face.sideIdx > n))
+                return &face;
+        }
+        return nullptr;
+    }
+
     bool Solid::IsSelected() const
     {
         return Atom::IsSelected() || m_parent->IsSelected();
@@ -512,6 +718,9 @@ namespace chisel
 
     void Solid::Delete()
     {
+        if (Core.map)
+            Core.map->Actions().SolidRemoved(*this);
+
         m_parent->RemoveBrush(*this);
     }
 
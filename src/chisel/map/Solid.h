@@ -7,11 +7,15 @@
 #include "Atom.h"
 
 #include "math/Color.h"
+#include "common/Pool.h"
 
 #include "Common.h"
 #include "Face.h"
 
+#include <algorithm>
+#include <array>
 #include <memory>
+#include <span>
 #include <unordered_map>
 
 namespace chisel
@@ -19,39 +23,128 @@ namespace chisel
     class Solid;
     class BrushEntity;
 
+    extern ConVar<bool> r_brush_packed_vertices;
+    extern ConVar<bool> r_disp_mask_solid;
+
+    // Bytes per brush vertex on the GPU, VertexSolid or VertexSolidPacked.
+    uint32_t BrushVertexStride();
+
+    struct BrushMeshData
+    {
+        std::vector<VertexSolid> vertices;
+        std::vector<uint32_t>    indices;
+    };
+
     struct BrushMesh
     {
+        // CPU copy of what was uploaded, empty unless r_keep_brush_geometry is set.
         std::vector<VertexSolid> vertices;
         std::vector<uint32_t>    indices;
 
-        std::optional<BrushGPUAllocator::Allocation> alloc;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount  = 0;
+
+        // Displacements only: where each level of detail is in the indices, see DispIndexPattern.
+        // Other meshes have none and draw every index.
+        std::array<DispLOD, DispMaxLODs> lods = {};
+        uint32_t lodCount = 0;
+
+        DispLOD GetLOD(uint32_t lod) const
+        {
+            if (lodCount == 0)
+                return DispLOD{ 0, indexCount };
+            return lods[std::min(lod, lodCount - 1)];
+        }
+
+        std::optional<BrushAllocator::Allocation> alloc;
         Material *material = nullptr;
         Solid *brush = nullptr;
     };
 
+    // What's left of a side after clipping it against the rest of the solid.
+    struct SideWinding
+    {
+        uint sideIdx;
+        uint firstPoint; // Into SolidWindings::points
+        uint pointCount;
+    };
+
+    // The windings of every visible side, with their points in one buffer.
+    struct SolidWindings
+    {
+        std::vector<SideWinding> sides;
+        std::vector<vec3>        points;
+
+        void clear()
+        {
+            sides.clear();
+            points.clear();
+        }
+    };
+
+    // A solid's built faces and meshes, so they can be put back exactly
+    // as they were without any CSG, meshing or UVs.
+    struct SolidGeometry
+    {
+        struct FaceMesh
+        {
+            uint meshIdx;
+            uint startIndex;
+        };
+
+        std::vector<Side>      sides;
+        SolidWindings          windings;
+        std::vector<FaceMesh>  faceMeshes; // One per winding
+        std::vector<BrushMesh> meshes;
+        std::optional<AABB>    bounds;
+    };
+
     class Solid : public Atom
     {
     public:
         Solid(BrushEntity* parent);
         Solid(BrushEntity* parent, std::vector<Side> sides, bool initMesh = true);
-        Solid(Solid&& other);
+        Solid(Solid&& other) = delete;
         ~Solid();
 
-        // What the fuck, why do I need this?
-        bool operator == (const Solid& other) const
-        {
-            return this == &other;
-        }
+        // Where this solid lives in its entity's pool.
+        PoolHandle GetHandle() const { return m_handle; }
 
         bool HasDisplacement() const { return m_displacement; }
         std::vector<BrushMesh>& GetMeshes() { return m_meshes; }
+        const std::vector<BrushMesh>& GetMeshes() const { return m_meshes; }
         const std::vector<Side>& GetSides() const { return m_sides; }
         const std::vector<Face>& GetFaces() const { return m_faces; }
+        // Every face's points, each face has a slice of these.
+        const std::vector<vec3>& GetPoints() const { return m_points; }
 
         void Clip(Side side); // Remember to UpdateMesh after this!
+        void SetSides(std::vector<Side> sides); // Remember to UpdateMesh after this!
 
+        // Rebuilds faces, then meshes.
         void UpdateMesh();
 
+        // Clips the sides against each other to get the faces (CSG).
+        void UpdateFaces();
+        // Creates the faces from sides that have already been clipped.
+        // Swaps the points out of windings, leaving it with the old ones.
+        void UpdateFaces(SolidWindings& windings);
+        // Builds and uploads meshes from the current faces.
+        void UpdateMeshes();
+
+        // Builds the meshes' vertices and indices again without uploading them, one per mesh.
+        // Only valid until the next mesh is built on this thread.
+        std::span<const BrushMeshData> BuildMeshData();
+
+        // Moves the meshes to new allocations, e.g. to empty out a page of brush memory.
+        void ReuploadMeshes();
+
+        // Replaces sides, faces and meshes with ones saved earlier, e.g. by the undo history.
+        void RestoreGeometry(SolidGeometry geometry);
+
+        // The CSG behind UpdateFaces. Doesn't touch any Solid or Selection state,
+        // so it's safe to call from any thread.
+        static void ClipSides(const std::vector<Side>& sides, SolidWindings& windings);
 
     // Selectable Interface //
 
@@ -61,6 +154,7 @@ namespace chisel
         void AlignToGrid(vec3 gridSize) final override;
 
         Selectable* ResolveSelectable() final override;
+        Selectable* FindPart(uint32_t n) final override;
         bool IsSelected() const final override;
 
         void Delete() final override;
@@ -69,7 +163,15 @@ namespace chisel
 
     private:
         friend struct Face;
+        friend class BrushEntity;
+
+        void FreeMeshes();
+        // Builds into the thread's scratch meshes and lays out m_meshes and the faces for them.
+        // Gives the same layout every time for the same faces.
+        void BuildMeshes();
+        static void UploadMesh(BrushAllocator& a, BrushMesh& mesh, std::span<const VertexSolid> vertices, std::span<const uint32_t> indices);
 
+        PoolHandle m_handle;
         bool m_displacement = false;
 
         std::vector<BrushMesh> m_meshes;
@@ -77,6 +179,7 @@ namespace chisel
         std::optional<AABB> m_bounds;
 
         std::vector<Face> m_faces;
+        std::vector<vec3> m_points;
     };
 
     std::vector<Side> CreateCubeBrush(Material* material, vec3 size = vec3(64.f), const mat4x4& transform = glm::identity<mat4x4>());
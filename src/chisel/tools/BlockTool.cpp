@@ -115,22 +115,16 @@ namespace chisel
         bool degenerate = math::CloseEnough(size.x, 0.0f) || math::CloseEnough(size.y, 0.0f) || math::CloseEnough(size.z, 0.0f);
         if (!degenerate)
         {
-            Chisel.map.Actions().PerformAction("Add Cube",
-                // Do
-                [this, solids = CreateCubeBrush(Chisel.activeMaterial.ptr(), size, mtx)](
-                    std::any& userdata)
-                {
-                    auto& cube = Chisel.map.AddBrush(solids);
-                    Selection.Clear();
-                    Selection.Select(&cube);
-                    userdata = &cube;
-                },
-                // Undo
-                [ this ] (std::any& userdata)
-                {
-                    Solid *cube = std::any_cast<Solid*>(userdata);
-                    cube->Delete();
-                });
+            auto& history = Chisel.map.Actions();
+            history.Begin("Add Cube");
+
+            auto& cube = Chisel.map.AddBrush(CreateCubeBrush(Chisel.activeMaterial.ptr(), size, mtx));
+            history.SolidAdded(cube);
+
+            history.End();
+
+            Selection.Clear();
+            Selection.Select(&cube);
         }
     }
 }
@@ -18,6 +18,9 @@ namespace chisel
 
         // Called every frame. Handle rendering and input logic go here.
         virtual void DrawHandles(Viewport& viewport) {}
+
+        // Called when another tool is picked.
+        virtual void OnDeactivate() {}
         
         // Tool Properties GUI
         virtual bool HasPropertiesGUI() { return false; }
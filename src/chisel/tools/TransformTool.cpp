@@ -36,22 +36,43 @@ namespace chisel
             size = view_grid_size;
         }
 
+        auto& history = Chisel.map.Actions();
+
+        // Finish the drag once the mouse is let go, even if the handles stop being drawn.
+        if (!m_hooked)
+        {
+            Engine.OnEndFrame += [this](render::RenderContext&)
+            {
+                if (m_recording && !Mouse.GetButton(MouseButton::Left))
+                    EndDrag();
+            };
+            m_hooked = true;
+        }
+
         std::optional<AABB> bounds = Selection.GetBounds();
 
         if (!bounds)
             return;
 
-        static bool s_duplicated = false;
-
         if (!Keyboard.shift || !Mouse.GetButton(MouseButton::Left))
-            s_duplicated = false;
+            m_duplicated = false;
 
         if (auto transform = Handles.Manipulate(bounds.value(), view, proj, Type, Chisel.transformSpace, snap, size))
         {
-            if (Keyboard.shift && !s_duplicated)
+            if (!m_recording && !history.IsRecording())
+            {
+                history.Begin("Transform");
+                history.SaveSelection();
+                m_recording = true;
+            }
+
+            // Copies go in as added where they start, the drag then moves them like anything else.
+            if (Keyboard.shift && !m_duplicated && m_recording)
             {
                 Selection.Duplicate();
-                s_duplicated = true;
+                history.SelectionAdded();
+                history.SaveSelection();
+                m_duplicated = true;
             }
 
             Selection.Transform(transform.value());
@@ -59,4 +80,21 @@ namespace chisel
             //brush->GetBrush().AlignToGrid(view_grid_size);
         }
     }
+
+    template <TransformType Type>
+    void TransformTool<Type>::OnDeactivate()
+    {
+        EndDrag();
+        m_duplicated = false;
+    }
+
+    template <TransformType Type>
+    void TransformTool<Type>::EndDrag()
+    {
+        if (!m_recording)
+            return;
+
+        Chisel.map.Actions().End();
+        m_recording = false;
+    }
 }
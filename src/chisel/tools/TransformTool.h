@@ -10,6 +10,14 @@ namespace chisel
     {
         using SelectTool::SelectTool;
         virtual void DrawHandles(Viewport& viewport);
+        virtual void OnDeactivate();
+
+    private:
+        void EndDrag();
+
+        bool m_recording  = false; // The whole drag is one undo action
+        bool m_duplicated = false;
+        bool m_hooked     = false;
     };
 
     using BoundsTool = TransformTool<TransformType::Bounds>;
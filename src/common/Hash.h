@@ -38,13 +38,22 @@ namespace chisel
     constexpr Hash HashStringLower(const char* str, size_t count) {
         return !count
             ? FNV_1a<Hash>::offset
-            : (HashStringLower(str, count - 1) ^ std::tolower(str[count-1])) * FNV_1a<Hash>::prime;
+            : (HashStringLower(str, count - 1) ^ std::tolower((unsigned char)str[count-1])) * FNV_1a<Hash>::prime;
     }
 
     constexpr Hash HashStringLower(std::string_view str) {
         return HashStringLower(str.data(), str.size());
     }
 
+    // FNV 1a over raw bytes, 64 bit. Pass the last result as hash to chain several.
+    inline uint64 HashBytes(const void* data, size_t size, uint64 hash = FNV_1a<uint64>::offset)
+    {
+        const uint8* bytes = static_cast<const uint8*>(data);
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * FNV_1a<uint64>::prime;
+        return hash;
+    }
+
     struct HashedString
     {
         Hash hash;
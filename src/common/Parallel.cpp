@@ -0,0 +1,89 @@
+#include "common/Parallel.h"
+
+namespace chisel
+{
+    static thread_local bool t_isWorker = false;
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::unique_lock lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+
+        for (auto& thread : m_threads)
+            thread.join();
+    }
+
+    void ThreadPool::Start()
+    {
+        size_t workers = ThreadCount() - 1;
+        m_threads.reserve(workers);
+        for (size_t i = 0; i < workers; i++)
+            m_threads.emplace_back([this] { Work(); });
+    }
+
+    void ThreadPool::Run(size_t count, void (*task)(void* data, size_t t), void* data)
+    {
+        // Nested, or another thread has the workers: don't wait on them.
+        std::unique_lock run(m_runMutex, std::defer_lock);
+        if (t_isWorker || !run.try_lock())
+        {
+            for (size_t t = 0; t < count; t++)
+                task(data, t);
+            return;
+        }
+
+        if (m_threads.empty())
+            Start();
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_task  = task;
+            m_data  = data;
+            m_count = count;
+            m_next.store(0, std::memory_order_relaxed);
+            m_busy  = m_threads.size();
+            m_job++;
+        }
+        m_wake.notify_all();
+
+        RunTasks();
+
+        // Every worker has to be out of the job before the next one can change it.
+        std::unique_lock lock(m_mutex);
+        m_done.wait(lock, [this] { return m_busy == 0; });
+        m_task = nullptr;
+        m_data = nullptr;
+    }
+
+    void ThreadPool::Work()
+    {
+        t_isWorker = true;
+
+        uint64_t job = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_stop || m_job != job; });
+                if (m_stop)
+                    return;
+                job = m_job;
+            }
+
+            RunTasks();
+
+            std::unique_lock lock(m_mutex);
+            if (--m_busy == 0)
+                m_done.notify_one();
+        }
+    }
+
+    void ThreadPool::RunTasks()
+    {
+        for (size_t t = m_next.fetch_add(1, std::memory_order_relaxed); t < m_count; t = m_next.fetch_add(1, std::memory_order_relaxed))
+            m_task(m_data, t);
+    }
+}
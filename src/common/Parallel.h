@@ -0,0 +1,86 @@
+#pragma once
+
+// Before ThreadPool so the profiler outlives it, workers give their rings back when they exit.
+#include "common/Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chisel
+{
+    /**
+     * Worker threads kept for the life of the program, started the first time they're needed.
+     * Only one job runs at a time. Jobs started from a worker, or while another thread's job
+     * is running, run on the calling thread instead of waiting.
+     */
+    inline struct ThreadPool
+    {
+        ~ThreadPool();
+
+        // Workers plus the calling thread.
+        size_t ThreadCount() const { return std::max(1u, std::thread::hardware_concurrency()); }
+
+        // Calls fn(t) for every t in [0, count), on the workers and the calling thread. Blocks until they're all done.
+        template <typename Fn>
+        void Run(size_t count, Fn& fn)
+        {
+            Run(count, [](void* data, size_t t) { (*static_cast<Fn*>(data))(t); }, &fn);
+        }
+
+        void Run(size_t count, void (*task)(void* data, size_t t), void* data);
+
+    private:
+        void Start();
+        void Work();
+        void RunTasks();
+
+        std::mutex               m_runMutex; // Held for a whole job
+        std::mutex               m_mutex;
+        std::condition_variable  m_wake;
+        std::condition_variable  m_done;
+        std::vector<std::thread> m_threads;
+
+        // The current job, only written while no worker is in it.
+        void (*m_task)(void*, size_t) = nullptr;
+        void*               m_data    = nullptr;
+        size_t              m_count   = 0;
+        std::atomic<size_t> m_next    = 0;
+        uint64_t            m_job     = 0; // Bumped for every job, workers take part in each one once
+        size_t              m_busy    = 0; // Workers yet to finish the current job
+        bool                m_stop    = false;
+    } ThreadPool;
+
+    /**
+     * Calls fn(i) for every i in [0, count), split into contiguous index
+     * ranges, one per hardware thread. Blocks until every range is done.
+     * fn must be safe to call from multiple threads at once.
+     */
+    template <typename Fn>
+    void ParallelFor(size_t count, Fn&& fn)
+    {
+        size_t rangeCount = std::min(ThreadPool.ThreadCount(), count);
+        if (rangeCount <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+
+        size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+
+        auto range = [count, rangeSize, &fn](size_t r)
+        {
+            size_t begin = r * rangeSize;
+            size_t end   = std::min(count, begin + rangeSize);
+            for (size_t i = begin; i < end; i++)
+                fn(i);
+        };
+        ThreadPool.Run(rangeCount, range);
+    }
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "common/AlignedStorage.h"
+
+namespace chisel
+{
+    // Refers to an element of a Pool. Goes stale (rather than dangling)
+    // once the element is erased, even if its slot gets reused.
+    struct PoolHandle
+    {
+        uint32_t index      = ~0u;
+        uint32_t generation = 0;
+
+        bool operator == (const PoolHandle& other) const = default;
+        explicit operator bool() const { return index != ~0u; }
+    };
+
+    /**
+     * Slot map storing elements in fixed size chunks.
+     * Elements never move, so pointers to them stay valid until they're erased.
+     * Erasing is O(1), and iterating walks the chunks in order, skipping free slots.
+     */
+    template <typename T, size_t ChunkSize = 256>
+    class Pool
+    {
+        using Storage = AlignedStorage<sizeof(T), alignof(T)>;
+
+        struct Chunk
+        {
+            Storage  slots[ChunkSize];
+            uint32_t generations[ChunkSize] = {};
+            bool     alive[ChunkSize] = {};
+        };
+
+    public:
+        Pool() {}
+        ~Pool() { clear(); }
+
+        Pool             (const Pool&) = delete;
+        Pool& operator = (const Pool&) = delete;
+
+        template <typename... Args>
+        std::pair<PoolHandle, T&> emplace(Args&&... args)
+        {
+            uint32_t index;
+            if (!m_free.empty())
+            {
+                index = m_free.back();
+                m_free.pop_back();
+            }
+            else
+            {
+                index = m_end++;
+                if (index / ChunkSize >= m_chunks.size())
+                    m_chunks.push_back(std::make_unique<Chunk>());
+            }
+
+            Chunk& chunk = ChunkOf(index);
+            size_t slot  = index % ChunkSize;
+
+            T* ptr = new (&chunk.slots[slot]) T(std::forward<Args>(args)...);
+            chunk.alive[slot] = true;
+            m_size++;
+
+            return { PoolHandle{ index, chunk.generations[slot] }, *ptr };
+        }
+
+        void erase(PoolHandle handle)
+        {
+            if (!contains(handle))
+                return;
+
+            Chunk& chunk = ChunkOf(handle.index);
+            size_t slot  = handle.index % ChunkSize;
+
+            chunk.alive[slot] = false;
+            chunk.generations[slot]++;
+            m_free.push_back(handle.index);
+            m_size--;
+
+            // Marked dead first, so the destructor doesn't see itself when iterating.
+            Ptr(handle.index)->~T();
+        }
+
+        bool contains(PoolHandle handle) const
+        {
+            if (handle.index >= m_end)
+                return false;
+
+            const Chunk& chunk = ChunkOf(handle.index);
+            size_t slot = handle.index % ChunkSize;
+            return chunk.alive[slot] && chunk.generations[slot] == handle.generation;
+        }
+
+        // nullptr if the handle is stale.
+        T* get(PoolHandle handle)
+        {
+            return contains(handle) ? Ptr(handle.index) : nullptr;
+        }
+
+        const T* get(PoolHandle handle) const
+        {
+            return contains(handle) ? Ptr(handle.index) : nullptr;
+        }
+
+        void clear()
+        {
+            for (uint32_t i = 0; i < m_end; i++)
+            {
+                Chunk& chunk = ChunkOf(i);
+                size_t slot  = i % ChunkSize;
+                if (!chunk.alive[slot])
+                    continue;
+
+                chunk.alive[slot] = false;
+                chunk.generations[slot]++;
+                Ptr(i)->~T();
+            }
+
+            // Keep the chunks around, and the generations in them.
+            m_free.clear();
+            m_end  = 0;
+            m_size = 0;
+        }
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+    // Iteration //
+
+        template <typename Value, typename Owner>
+        class Iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = T;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = Value*;
+            using reference         = Value&;
+
+            Iterator() {}
+            Iterator(Owner* pool, uint32_t index)
+                : m_pool(pool), m_index(index) { SkipDead(); }
+
+            reference operator *  () const { return *m_pool->Ptr(m_index); }
+            pointer   operator -> () const { return m_pool->Ptr(m_index); }
+
+            Iterator& operator ++ () { m_index++; SkipDead(); return *this; }
+            Iterator  operator ++ (int) { Iterator it = *this; ++*this; return it; }
+
+            bool operator == (const Iterator& other) const { return m_index == other.m_index; }
+
+        private:
+            void SkipDead()
+            {
+                while (m_index < m_pool->m_end && !m_pool->ChunkOf(m_index).alive[m_index % ChunkSize])
+                    m_index++;
+            }
+
+            Owner*   m_pool  = nullptr;
+            uint32_t m_index = 0;
+        };
+
+        using iterator       = Iterator<T, Pool>;
+        using const_iterator = Iterator<const T, const Pool>;
+
+        iterator begin() { return iterator(this, 0); }
+        iterator end()   { return iterator(this, m_end); }
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end()   const { return const_iterator(this, m_end); }
+
+    private:
+        Chunk&       ChunkOf(uint32_t index)       { return *m_chunks[index / ChunkSize]; }
+        const Chunk& ChunkOf(uint32_t index) const { return *m_chunks[index / ChunkSize]; }
+
+        T*       Ptr(uint32_t index)       { return std::launder(reinterpret_cast<T*>(&ChunkOf(index).slots[index % ChunkSize])); }
+        const T* Ptr(uint32_t index) const { return std::launder(reinterpret_cast<const T*>(&ChunkOf(index).slots[index % ChunkSize])); }
+
+        std::vector<std::unique_ptr<Chunk>> m_chunks;
+        std::vector<uint32_t>               m_free;
+        uint32_t                            m_end  = 0; // One past the highest slot in use
+        size_t                              m_size = 0;
+    };
+}
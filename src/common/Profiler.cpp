@@ -0,0 +1,186 @@
+#include "common/Profiler.h"
+#include "common/Filesystem.h"
+#include "console/Console.h"
+#include "console/ConCommand.h"
+#include "console/ConVar.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace chisel
+{
+    static ConVar<bool> profile_enabled("profile_enabled", true, "Record profiler zones.");
+
+    static ConCommand profile_dump("profile_dump", "Write recent profiler zones to a Chrome/Perfetto trace JSON file.", [](ConCmd& cmd)
+    {
+        std::string path = cmd.argc > 0 ? std::string(cmd.argv[0]) : "profile.json";
+        if (Profiler.WriteTrace(path))
+            Console.Log("Wrote profile to '{}'", path);
+        else
+            Console.Error("Failed to write profile to '{}'", path);
+    });
+
+    // Gives a thread's ring back when the thread exits, so short lived threads don't pile up rings.
+    struct ThreadRingOwner
+    {
+        Profiler::ThreadRing* ring = nullptr;
+
+        ~ThreadRingOwner()
+        {
+            if (ring)
+                Profiler.ReleaseThreadRing(ring);
+        }
+    };
+
+    Profiler::ThreadRing& Profiler::GetThreadRing()
+    {
+        static thread_local ThreadRingOwner owner;
+        if (owner.ring) [[likely]]
+            return *owner.ring;
+
+        std::unique_lock lock(m_ringMutex);
+        if (!m_freeRings.empty())
+        {
+            owner.ring = m_freeRings.back();
+            m_freeRings.pop_back();
+        }
+        else
+        {
+            auto& ring = m_rings.emplace_back(std::make_unique<ThreadRing>());
+            ring->id = uint32_t(m_rings.size() - 1);
+            owner.ring = ring.get();
+        }
+        return *owner.ring;
+    }
+
+    void Profiler::ReleaseThreadRing(ThreadRing* ring)
+    {
+        std::unique_lock lock(m_ringMutex);
+        ring->depth = 0;
+        m_freeRings.push_back(ring);
+    }
+
+    void Profiler::BeginFrame()
+    {
+        // The convar is read once a frame so scopes only need an atomic load.
+        enabled.store(profile_enabled, std::memory_order_relaxed);
+        m_frameStart = Now();
+    }
+
+    void Profiler::EndFrame()
+    {
+        std::unique_lock lock(m_frameMutex);
+        m_frames[m_frameCount % FrameHistory] = Frame{ m_frameStart, Now() };
+        m_frameCount++;
+    }
+
+    std::vector<Profiler::Frame> Profiler::GetFrames(uint32_t count) const
+    {
+        std::unique_lock lock(m_frameMutex);
+
+        std::vector<Frame> frames;
+        uint64_t available = std::min<uint64_t>(m_frameCount, std::min(count, FrameHistory));
+        frames.reserve(available);
+        for (uint64_t i = 0; i < available; i++)
+            frames.push_back(m_frames[(m_frameCount - 1 - i) % FrameHistory]);
+        return frames;
+    }
+
+    void Profiler::Collect(std::vector<ZoneRecord>& out, Ticks start, Ticks end) const
+    {
+        std::unique_lock lock(m_ringMutex);
+
+        for (const auto& ring : m_rings)
+        {
+            uint64_t head  = ring->head.load(std::memory_order_acquire);
+            uint64_t first = head > RingSize ? head - RingSize : 0;
+
+            for (uint64_t i = first; i < head; i++)
+            {
+                Zone zone = ring->zones[i & (RingSize - 1)];
+
+                // The owner keeps recording while we copy and may have lapped us.
+                // Keep the zone only if its slot wasn't reused, rather than lock the writer.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (ring->head.load(std::memory_order_relaxed) - i >= RingSize)
+                    continue;
+
+                if (zone.end >= start && zone.start <= end)
+                    out.push_back(ZoneRecord{ zone, ring->id });
+            }
+        }
+    }
+
+    const char* Profiler::Intern(std::string_view name)
+    {
+        std::unique_lock lock(m_internMutex);
+        return m_interned.emplace(name).first->c_str();
+    }
+
+    static void AppendEscaped(std::string& json, const char* text)
+    {
+        for (; *text; text++)
+        {
+            char c = *text;
+            if (c == '"' || c == '\\')
+                json += '\\';
+            if (uint8_t(c) < 0x20)
+                continue;
+            json += c;
+        }
+    }
+
+    bool Profiler::WriteTrace(const std::string& path) const
+    {
+        std::vector<ZoneRecord> zones;
+        Collect(zones);
+
+        std::sort(zones.begin(), zones.end(), [](const ZoneRecord& a, const ZoneRecord& b)
+        {
+            return a.zone.start < b.zone.start;
+        });
+
+        std::string json;
+        json.reserve(zones.size() * 96 + 256);
+        json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        uint32_t threads;
+        {
+            std::unique_lock lock(m_ringMutex);
+            threads = uint32_t(m_rings.size());
+        }
+        for (uint32_t i = 0; i < threads; i++)
+        {
+            fmt::format_to(std::back_inserter(json),
+                "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}},\n",
+                i, i == 0 ? std::string("Main") : fmt::format("Worker {}", i));
+        }
+
+        // Frames get their own track above the threads.
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":-1,\"args\":{\"name\":\"Frames\"}},\n";
+        for (const Frame& frame : GetFrames())
+        {
+            fmt::format_to(std::back_inserter(json),
+                "{{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":-1,\"ts\":{:.3f},\"dur\":{:.3f}}},\n",
+                frame.start / 1000.0, (frame.end - frame.start) / 1000.0);
+        }
+
+        for (const ZoneRecord& record : zones)
+        {
+            json += "{\"name\":\"";
+            AppendEscaped(json, record.zone.name);
+            fmt::format_to(std::back_inserter(json),
+                "\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}},\n",
+                record.thread, record.zone.start / 1000.0, (record.zone.end - record.zone.start) / 1000.0);
+        }
+
+        // Trailing comma
+        if (json.ends_with(",\n"))
+            json.resize(json.size() - 2);
+        json += "\n]}\n";
+
+        return fs::writeFile(path, json);
+    }
+}
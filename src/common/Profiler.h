@@ -0,0 +1,152 @@
+#pragma once
+
+#include "common/Common.h"
+
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/** Profiler.h: Scoped CPU timers, per thread.
+ *
+ * Each thread writes the zones it finishes into its own ring of the most recent ones,
+ * so recording never takes a lock. Readers copy out whatever has been published.
+ * Doesn't need a window, so chisel-bench can record and dump traces too.
+ *
+ *     void Solid::UpdateMesh()
+ *     {
+ *         PROFILE_SCOPE("Solid::UpdateMesh");
+ *         ...
+ *     }
+ */
+
+namespace chisel
+{
+    inline struct Profiler
+    {
+        using Ticks = int64_t; // Nanoseconds since the profiler started
+
+        static constexpr uint32_t RingSize     = 1 << 14; // Zones kept per thread, a power of two
+        static constexpr uint32_t FrameHistory = 256;
+
+        struct Zone
+        {
+            const char* name;  // Must outlive the profiler, see Intern
+            Ticks       start;
+            Ticks       end;
+            uint32_t    depth; // Zones open on this thread when it started
+        };
+
+        struct ThreadRing
+        {
+            uint32_t                 id;        // Stable, used as the trace's tid
+            std::unique_ptr<Zone[]>  zones = std::make_unique<Zone[]>(RingSize);
+            std::atomic<uint64_t>    head  = 0; // Zones ever written, the newest is at (head - 1) % RingSize
+            uint32_t                 depth = 0; // Only touched by the owning thread
+        };
+
+        struct ZoneRecord
+        {
+            Zone     zone;
+            uint32_t thread;
+        };
+
+        // Frame boundaries, from BeginFrame/EndFrame on the main thread.
+        struct Frame
+        {
+            Ticks start = 0;
+            Ticks end   = 0;
+        };
+
+        std::atomic<bool> enabled = true;
+
+        static Ticks Now()
+        {
+            using namespace std::chrono;
+            static const steady_clock::time_point epoch = steady_clock::now();
+            return duration_cast<nanoseconds>(steady_clock::now() - epoch).count();
+        }
+
+        // Ring for the calling thread. Threads that exit give theirs back to be reused,
+        // so ring 0 is the first thread to record (the main thread) and the rest are lanes for workers.
+        ThreadRing& GetThreadRing();
+
+        void BeginFrame();
+        void EndFrame();
+
+        // Most recent finished frame first, up to count.
+        std::vector<Frame> GetFrames(uint32_t count = FrameHistory) const;
+
+        // Every zone still in a ring that overlaps [start, end]. Safe while other threads record.
+        void Collect(std::vector<ZoneRecord>& out, Ticks start = 0, Ticks end = INT64_MAX) const;
+
+        // Keeps a copy of a name for zones that aren't string literals, like asset paths.
+        const char* Intern(std::string_view name);
+
+        // Writes everything still in the rings in Chrome trace format (chrome://tracing, ui.perfetto.dev).
+        bool WriteTrace(const std::string& path) const;
+
+    private:
+        friend struct ThreadRingOwner;
+        void ReleaseThreadRing(ThreadRing* ring);
+
+        mutable std::mutex                       m_ringMutex;
+        std::vector<std::unique_ptr<ThreadRing>> m_rings;
+        std::vector<ThreadRing*>                 m_freeRings;
+
+        std::mutex                      m_internMutex;
+        std::unordered_set<std::string> m_interned;
+
+        mutable std::mutex m_frameMutex;
+        Frame              m_frames[FrameHistory];
+        uint64_t           m_frameCount = 0;
+        Ticks              m_frameStart = 0;
+    } Profiler;
+
+    struct ProfileScope
+    {
+        explicit ProfileScope(const char* name)
+        {
+            if (!Profiler.enabled.load(std::memory_order_relaxed))
+                return;
+
+            m_ring = &Profiler.GetThreadRing();
+            m_zone.name  = name;
+            m_zone.depth = m_ring->depth++;
+            m_zone.start = Profiler::Now();
+        }
+
+        ~ProfileScope()
+        {
+            if (!m_ring)
+                return;
+
+            m_zone.end = Profiler::Now();
+            m_ring->depth--;
+
+            // Only this thread writes the ring, publish the slot by bumping head after filling it.
+            uint64_t head = m_ring->head.load(std::memory_order_relaxed);
+            m_ring->zones[head & (Profiler::RingSize - 1)] = m_zone;
+            m_ring->head.store(head + 1, std::memory_order_release);
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        Profiler::ThreadRing* m_ring = nullptr;
+        Profiler::Zone        m_zone;
+    };
+}
+
+#define CHISEL_PROFILE_CONCAT2(a, b) a##b
+#define CHISEL_PROFILE_CONCAT(a, b) CHISEL_PROFILE_CONCAT2(a, b)
+
+// Times the rest of the enclosing scope. name must be a string literal or from Profiler.Intern.
+#define PROFILE_SCOPE(name) ::chisel::ProfileScope CHISEL_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
@@ -8,6 +8,7 @@
 #include <type_traits>
 
 #include "common/Ranges.h"
+#include "common/Profiler.h"
 
 namespace chisel
 {
@@ -36,6 +37,7 @@ namespace chisel
         struct Callback {
             System* system;
             SystemFunc* func;
+            const char* name; // For the profiler
         };
 
         struct SystemRecord {
@@ -67,7 +69,9 @@ namespace chisel
             record.Update = OnUpdate.end();
             record.Tick   = OnTick.end();
 
-            record.Start = RegisterCallback(OnStart, sys, [](System* sys) { static_cast<Sys*>(sys)->Start(); });
+            const char* name = typeid(Sys).name();
+
+            record.Start = RegisterCallback(OnStart, sys, name, [](System* sys) { static_cast<Sys*>(sys)->Start(); });
 
             // If Start() has already been called, then call
             // it on new systems as soon as they're created.
@@ -75,9 +79,9 @@ namespace chisel
                 system->Start();
             }
 
-            record.Update = RegisterCallback(OnUpdate, sys, [](System* sys) { static_cast<Sys*>(sys)->Update(); });
+            record.Update = RegisterCallback(OnUpdate, sys, name, [](System* sys) { static_cast<Sys*>(sys)->Update(); });
 
-            record.Tick = RegisterCallback(OnTick, sys, [](System* sys) { static_cast<Sys*>(sys)->Tick(); });
+            record.Tick = RegisterCallback(OnTick, sys, name, [](System* sys) { static_cast<Sys*>(sys)->Tick(); });
 
             return *sys;
         }
@@ -145,15 +149,16 @@ namespace chisel
 
         inline void Call(auto& event) {
             int i = 0;
-            for (auto& [sys, Func] : event) {
+            for (auto& [sys, Func, name] : event) {
                 // TODO: Why is this necessary?
                 if (i++ > event.size()) return;
+                PROFILE_SCOPE(name);
                 Func(sys);
             }
         }
 
-        inline auto RegisterCallback(auto& event, System* system, SystemFunc* func) {
-            return event.insert(event.end(), Callback {system, func});
+        inline auto RegisterCallback(auto& event, System* system, const char* name, SystemFunc* func) {
+            return event.insert(event.end(), Callback {system, func, name});
         }
 
         inline void UnregisterCallbacks(const SystemRecord& record)
@@ -6,6 +6,7 @@
 #include "common/Ranges.h"
 #include "common/Enum.h"
 
+#include <atomic>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -15,6 +16,10 @@
 
 namespace chisel
 {
+    // Bumped whenever any ConVar is set, for anything that caches what it made from them.
+    // Atomic like Core.sceneRevision, viewports are recorded on several threads.
+    inline std::atomic<uint64_t> ConVarRevision = 0;
+
     /** Represents a console variable. */
     template <typename T = const char*>
     struct ConVar : public ConCommand
@@ -48,6 +53,7 @@ namespace chisel
         inline void SetValue(T t)
         {
             value = t;
+            ConVarRevision.fetch_add(1, std::memory_order_relaxed);
             
             // Allow callback to set the value without recursing!
             if (!inCallback && callback)
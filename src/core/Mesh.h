@@ -3,10 +3,14 @@
 #include "common/Common.h"
 #include "assets/Asset.h"
 #include "math/Math.h"
+#include "math/AABB.h"
 #include "VertexLayout.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
 
+#include <algorithm>
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace chisel
@@ -18,14 +22,28 @@ namespace chisel
     struct Mesh : Asset
     {
         struct Group {
-            // TODO: Allow sharing buffers between groups but drawing different ranges
+            // Groups can share buffers (same pointer), each drawing its own range of indices.
             VertexBuffer vertices = VertexBuffer();
             IndexBuffer indices = IndexBuffer();
             int material = -1;
+            uint firstIndex = 0;
+            uint indexCount = ~0u; // To the end
+
+            uint IndexCount() const {
+                return std::min(indexCount, indices.count - firstIndex);
+            }
+        };
+
+        // A level of detail, a range of groups. LOD 0 is the most detailed.
+        struct LOD {
+            uint firstGroup = 0;
+            uint groupCount = 0;
         };
 
         std::vector<Group> groups;
         std::vector<Rc<Material>> materials;
+        std::vector<LOD> lods; // Empty if every group is drawn
+        std::optional<AABB> bounds;
         bool uploaded = false;
 
         using Asset::Asset;
@@ -38,6 +56,18 @@ namespace chisel
             return groups.emplace_back();
         }
 
+        uint LODCount() const {
+            return lods.empty() ? 1 : uint(lods.size());
+        }
+
+        // The groups to draw for a level of detail, clamped to the ones there are.
+        std::span<const Group> LODGroups(uint lod) const {
+            if (lods.empty())
+                return groups;
+            const LOD& range = lods[std::min<size_t>(lod, lods.size() - 1)];
+            return std::span<const Group>(groups).subspan(range.firstGroup, range.groupCount);
+        }
+
         Mesh(VertexLayout& layout, auto& vertices, auto& indices) {
             Init(layout, vertices, indices);
         }
@@ -53,6 +83,8 @@ namespace chisel
             }
             groups = other.groups;
             materials = other.materials;
+            lods = other.lods;
+            bounds = other.bounds;
             uploaded = false;
             return *this;
         }
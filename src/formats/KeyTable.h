@@ -0,0 +1,158 @@
+#pragma once
+
+#include "common/Hash.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace chisel::kv
+{
+    // Keyvalue keys are case insensitive.
+    inline bool KeyEqual(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+            return false;
+
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            if (std::tolower((unsigned char)a[i]) != std::tolower((unsigned char)b[i]))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * An interned keyvalue key.
+     * Each name is stored once in the KeyTable however many keyvalues use it,
+     * and comparing keys is comparing integers. Names that only differ by case are the same key.
+     */
+    class Key
+    {
+    public:
+        Key() {}
+
+        // Adds the name to the table if it isn't there yet.
+        static Key Intern(std::string_view name);
+        // Invalid if the name was never interned, nothing can have it as a key then.
+        static Key Find(std::string_view name);
+
+        bool IsValid() const { return m_id != Invalid; }
+        uint32_t ID() const { return m_id; }
+
+        // As it was first interned.
+        const std::string& str() const;
+        const char* c_str() const { return str().c_str(); }
+        operator std::string_view() const { return str(); }
+
+        bool operator == (const Key& other) const = default;
+        auto operator <=> (const Key& other) const = default;
+
+        bool operator == (std::string_view name) const { return KeyEqual(str(), name); }
+
+    private:
+        friend struct KeyTable;
+
+        static constexpr uint32_t Invalid = ~0u;
+
+        explicit Key(uint32_t id) : m_id(id) {}
+
+        uint32_t m_id = Invalid;
+    };
+
+    /**
+     * Every key name seen so far, found by a case folded hash.
+     * Interning isn't thread safe. Finding is, as long as nothing is being interned.
+     */
+    inline struct KeyTable
+    {
+        Key Intern(std::string_view name)
+        {
+            Hash hash = HashStringLower(name);
+            uint32_t slot = FindSlot(name, hash);
+            if (m_slots.size() && m_slots[slot] != 0)
+                return Key(m_slots[slot] - 1);
+
+            // Keep at most half full.
+            if ((m_entries.size() + 1) * 2 > m_slots.size())
+            {
+                Grow();
+                slot = FindSlot(name, hash);
+            }
+
+            uint32_t id = uint32_t(m_entries.size());
+            m_entries.push_back(Entry{ hash, std::string(name) });
+            m_slots[slot] = id + 1;
+            return Key(id);
+        }
+
+        Key Find(std::string_view name) const
+        {
+            if (m_slots.empty())
+                return Key();
+
+            uint32_t slot = FindSlot(name, HashStringLower(name));
+            return m_slots[slot] != 0 ? Key(m_slots[slot] - 1) : Key();
+        }
+
+        const std::string& Name(Key key) const
+        {
+            static const std::string empty;
+            return key.IsValid() ? m_entries[key.m_id].name : empty;
+        }
+
+        size_t Count() const { return m_entries.size(); }
+
+    private:
+        struct Entry
+        {
+            Hash        hash;
+            std::string name;
+        };
+
+        // The slot holding the name, or the empty slot it would go in.
+        uint32_t FindSlot(std::string_view name, Hash hash) const
+        {
+            if (m_slots.empty())
+                return 0;
+
+            uint32_t mask = uint32_t(m_slots.size() - 1);
+            for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask)
+            {
+                uint32_t id = m_slots[slot];
+                if (id == 0)
+                    return slot;
+
+                const Entry& entry = m_entries[id - 1];
+                if (entry.hash == hash && KeyEqual(entry.name, name))
+                    return slot;
+            }
+        }
+
+        void Grow()
+        {
+            std::vector<uint32_t> slots(std::max<size_t>(m_slots.size() * 2, 256));
+            uint32_t mask = uint32_t(slots.size() - 1);
+            for (uint32_t id = 0; id < m_entries.size(); id++)
+            {
+                uint32_t slot = m_entries[id].hash & mask;
+                while (slots[slot] != 0)
+                    slot = (slot + 1) & mask;
+                slots[slot] = id + 1;
+            }
+            m_slots = std::move(slots);
+        }
+
+        std::deque<Entry>     m_entries; // By key ID, a deque so names never move
+        std::vector<uint32_t> m_slots;   // Key ID + 1, 0 if empty
+    } KeyTable;
+
+    inline Key Key::Intern(std::string_view name) { return KeyTable.Intern(name); }
+    inline Key Key::Find(std::string_view name)   { return KeyTable.Find(name); }
+
+    inline const std::string& Key::str() const { return KeyTable.Name(*this); }
+}
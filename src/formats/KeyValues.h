@@ -5,9 +5,12 @@
 #include "common/Parse.h"
 #include "common/Span.h"
 #include "common/String.h"
+#include "formats/KeyTable.h"
 #include "math/Color.h"
 
-#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <vector>
 #include <cstdint>
 #include <string>
 #include <cstring>
@@ -36,38 +39,6 @@ namespace chisel::kv
 
     class KeyValues;
 
-    #define fast_toupper( c ) ( ( ( (c) >= 'a' ) && ( (c) <= 'z' ) ) ? ( (c) - 32 ) : (c) )
-    #define fast_tolower( c ) ( ( ( (c) >= 'A' ) && ( (c) <= 'Z' ) ) ? ( (c) + 32 ) : (c) )
-
-    template <typename T>
-    static void hash_combine(size_t& s, const T& v)
-    {
-	    std::hash<T> h;
-	    s^= h(v) + 0x9e3779b9 + (s<< 6) + (s>> 2);
-    }
-
-    struct KVStringHash
-    {
-        size_t operator()(const std::string& key) const
-        {
-            size_t hash = 0;
-            for (char c : key)
-                hash_combine(hash, fast_tolower(c));
-            return hash;
-        }
-    };
-
-    struct KVStringEqual
-    {
-        bool operator()(const std::string& a, const std::string& b) const
-        {
-            if (a.size() != b.size())
-                return false;
-
-            return std::equal(a.begin(), a.end(), b.begin(), [](char a, char b) { return fast_tolower(a) == fast_tolower(b); });
-        }
-    };
-
     class KeyValuesVariant
     {
     public:
@@ -84,7 +55,7 @@ namespace chisel::kv
             Set(arg);
         }
 
-        KeyValuesVariant(KeyValuesVariant&& other)
+        KeyValuesVariant(KeyValuesVariant&& other) noexcept
             : m_type(other.m_type)
             , m_str(std::move(other.m_str))
             , m_data(std::move(other.m_data))
@@ -166,8 +137,13 @@ namespace chisel::kv
         void Set(uint64_t val)           { Clear(); m_type = Types::Int;       m_data.Get<int64_t>() = val; }
         void Set(KeyValuesChild val)     { Clear(); m_type = Types::KeyValues; m_data.Get<KeyValuesChild>() = std::move(val); }
 
-        KeyValuesVariant& operator = (KeyValuesVariant&& other)
+        KeyValuesVariant& operator = (KeyValuesVariant&& other) noexcept
         {
+            if (this == &other)
+                return *this;
+
+            // Children get shuffled around by move when their parent's sorted storage changes.
+            Clear();
             m_type = other.m_type;
             m_str = std::move(other.m_str);
             m_data = std::move(other.m_data);
@@ -216,6 +192,10 @@ namespace chisel::kv
         KeyValuesType GetType() const { return m_type; }
 
         static KeyValuesVariant Parse(std::string_view view);
+        // Parses as a known type, e.g. from the FGD, instead of guessing.
+        // Keeps the text, so it's written back out as it was until the value changes.
+        // Missing vector components are filled in, and it's a String if it doesn't parse at all.
+        static KeyValuesVariant Parse(std::string_view view, KeyValuesType type, float fill = 0.0f);
 
         bool IsDefault() const;
     private:
@@ -225,6 +205,8 @@ namespace chisel::kv
 
         KeyValuesType m_type = Types::None;
 
+        // The value of a String. For other types, the text they were parsed from (so files are written back
+        // as they were read), or what they last printed as. Only allocates for text longer than the small buffer.
         mutable KeyValuesString m_str;
 
         Variant<
@@ -239,17 +221,34 @@ namespace chisel::kv
     };
     inline KeyValuesVariant KeyValuesVariant::s_Nothing;
 
+    /**
+     * Keyvalues stored flat, sorted by key.
+     * Children with the same key keep the order they were added in.
+     */
     class KeyValues
     {
     public:
+        using Child = std::pair<Key, KeyValuesVariant>;
+
         KeyValues()
         {
         }
 
         KeyValues(const KeyValues& other)
         {
-            for (const auto& [name, child] : m_children)
-                m_children.emplace(name, KeyValuesVariant(child));
+            m_children.reserve(other.m_children.size());
+            for (const auto& [key, child] : other.m_children)
+                m_children.emplace_back(key, KeyValuesVariant(child));
+        }
+
+        KeyValues(KeyValues&& other) = default;
+        KeyValues& operator = (KeyValues&& other) = default;
+
+        KeyValues& operator = (const KeyValues& other)
+        {
+            if (this != &other)
+                *this = KeyValues(other);
+            return *this;
         }
 
         static std::unique_ptr<KeyValues> ParseFromUTF8(StringView buffer)
@@ -264,33 +263,38 @@ namespace chisel::kv
             return s_Nothing;
         }
 
-        KeyValuesVariant& operator [](std::string_view string)
+        KeyValuesVariant& operator [](Key key)
         {
-            auto iter = m_children.find(std::string(string));
+            auto iter = Find(key);
             if (iter == m_children.end())
-            {
-                //std::cerr << "Returning KeyValuesVariant empty value: " << string << std::endl;
                 return KeyValuesVariant::GetEmptyValue();
-            }
 
             return iter->second;
         }
 
-        const KeyValuesVariant& operator [] (std::string_view string) const
+        const KeyValuesVariant& operator [](Key key) const
         {
-            auto iter = m_children.find(std::string(string));
+            auto iter = Find(key);
             if (iter == m_children.end())
-            {
-                //std::cerr << "Returning KeyValuesVariant empty value: " << string << std::endl;
                 return KeyValuesVariant::GetEmptyValue();
-            }
 
             return iter->second;
         }
 
+        KeyValuesVariant& operator [](std::string_view string)             { return (*this)[Key::Find(string)]; }
+        const KeyValuesVariant& operator [](std::string_view string) const { return (*this)[Key::Find(string)]; }
+
+        auto FindAll(Key key)
+        {
+            if (!key.IsValid())
+                return std::make_pair(m_children.end(), m_children.end());
+
+            return std::equal_range(m_children.begin(), m_children.end(), key, KeyLess{});
+        }
+
         auto FindAll(std::string_view string)
         {
-            return m_children.equal_range(std::string(string));
+            return FindAll(Key::Find(string));
         }
 
         auto begin() { return m_children.begin(); }
@@ -300,47 +304,41 @@ namespace chisel::kv
 
         auto ChildCount() const { return m_children.size(); }
 
-        bool Contains(std::string_view name)
+        bool Contains(Key key) const
+        {
+            return Find(key) != m_children.end();
+        }
+
+        bool Contains(std::string_view name) const
         {
-            return m_children.contains(std::string(name));
+            return Contains(Key::Find(name));
         }
 
         template <typename... Args>
         KeyValuesVariant& CreateChild(std::string_view name, Args... args)
         {
-            return m_children.emplace(std::string(name), KeyValuesVariant::Parse(std::forward<Args>(args)...))->second;
+            return Insert(Key::Intern(name), KeyValuesVariant::Parse(std::forward<Args>(args)...));
         }
 
         template <typename T>
         KeyValuesVariant& CreateTypedChild(std::string_view name, const T& thing)
         {
-            return m_children.emplace(std::string(name), KeyValuesVariant(thing))->second;
+            return Insert(Key::Intern(name), KeyValuesVariant(thing));
         }
 
         bool empty() const { return m_children.empty(); }
 
         void RemoveAll(std::string_view name)
         {
-            auto range = m_children.equal_range(std::string(name));
-            if (range.first == range.second)
-                return;
+            auto range = FindAll(name);
             m_children.erase(range.first, range.second);
         }
 
         void RemoveAllWithType(std::string_view name, KeyValuesType type)
         {
-            auto range = m_children.equal_range(std::string(name));
-            if (range.first == range.second)
-                return;
-
-            for (auto it = range.first; it != range.second;) {
-                if (it->first == name && it->second.GetType() == type)
-                {
-                    it = m_children.erase(it);
-                }
-                else
-                    it++;
-            }
+            auto range = FindAll(name);
+            auto last = std::remove_if(range.first, range.second, [type](const Child& child) { return child.second.GetType() == type; });
+            m_children.erase(last, range.second);
         }
     private:
         static KeyValues s_Nothing;
@@ -386,7 +384,7 @@ namespace chisel::kv
                     if (*start == '{')
                     {
                         auto child = ParseChild(start, end);
-                        kv->m_children.emplace(key, std::move(child));
+                        kv->Insert(Key::Intern(key), KeyValuesVariant(std::move(child)));
 
                         fillingInValue = false;
                         key.clear();
@@ -436,7 +434,34 @@ namespace chisel::kv
             return kv;
         }
 
-        std::unordered_multimap<std::string, KeyValuesVariant, KVStringHash, KVStringEqual> m_children;
+        struct KeyLess
+        {
+            bool operator()(const Child& child, Key key) const { return child.first < key; }
+            bool operator()(Key key, const Child& child) const { return key < child.first; }
+        };
+
+        std::vector<Child>::const_iterator Find(Key key) const
+        {
+            if (!key.IsValid())
+                return m_children.end();
+
+            auto iter = std::lower_bound(m_children.begin(), m_children.end(), key, KeyLess{});
+            return iter != m_children.end() && iter->first == key ? iter : m_children.end();
+        }
+
+        std::vector<Child>::iterator Find(Key key)
+        {
+            return m_children.begin() + (std::as_const(*this).Find(key) - m_children.cbegin());
+        }
+
+        // After any children with the same key.
+        KeyValuesVariant& Insert(Key key, KeyValuesVariant value)
+        {
+            auto iter = std::upper_bound(m_children.begin(), m_children.end(), key, KeyLess{});
+            return m_children.emplace(iter, key, std::move(value))->second;
+        }
+
+        std::vector<Child> m_children;
     };
     inline KeyValues KeyValues::s_Nothing;
 
@@ -695,6 +720,15 @@ namespace chisel::kv
         if (view.empty())
             return KeyValuesVariant();
 
+        // Keep the text, so numbers are written back out as they were until they change.
+        const std::string_view text = view;
+        auto Typed = [text](auto value)
+        {
+            KeyValuesVariant variant(value);
+            variant.m_str = text;
+            return variant;
+        };
+
         if (view[0] == '[' && view[view.size() - 1] == ']')
         {
             view.remove_prefix(1);
@@ -710,12 +744,12 @@ namespace chisel::kv
                 if (hasDecimal)
                 {
                     auto r_double = stream::Parse<double>(view);
-                    if (r_double) return KeyValuesVariant(*r_double);
+                    if (r_double) return Typed(*r_double);
                 }
                 else
                 {
                     auto r_int64 = stream::Parse<int64>(view);
-                    if (r_int64) return KeyValuesVariant(*r_int64);
+                    if (r_int64) return Typed(*r_int64);
                 }
             }
             else if (vec.size() == 2)
@@ -723,7 +757,7 @@ namespace chisel::kv
                 auto r_x = stream::Parse<float>(vec[0]);
                 auto r_y = stream::Parse<float>(vec[1]);
                 if (r_x && r_y)
-                    return KeyValuesVariant(vec2(*r_x, *r_y));
+                    return Typed(vec2(*r_x, *r_y));
             }
             else if (vec.size() == 3)
             {
@@ -731,7 +765,7 @@ namespace chisel::kv
                 auto r_y = stream::Parse<float>(vec[1]);
                 auto r_z = stream::Parse<float>(vec[2]);
                 if (r_x && r_y && r_z)
-                    return KeyValuesVariant(vec3(*r_x, *r_y, *r_z));
+                    return Typed(vec3(*r_x, *r_y, *r_z));
             }
             else if (vec.size() == 4)
             {
@@ -740,13 +774,72 @@ namespace chisel::kv
                 auto r_z = stream::Parse<float>(vec[2]);
                 auto r_w = stream::Parse<float>(vec[3]);
                 if (r_x && r_y && r_z && r_w)
-                    return KeyValuesVariant(vec4(*r_x, *r_y, *r_z, *r_w));
+                    return Typed(vec4(*r_x, *r_y, *r_z, *r_w));
             }
         }
 
         return KeyValuesVariant(view);
     }
 
+    inline KeyValuesVariant KeyValuesVariant::Parse(std::string_view view, KeyValuesType type, float fill)
+    {
+        KeyValuesVariant value;
+        switch (type)
+        {
+            case Types::Int:
+            {
+                // Take "1.0" as 1, rather than not an integer.
+                if (auto r_int64 = stream::Parse<int64>(view); r_int64 && view.find('.') == std::string_view::npos)
+                    value.Set(*r_int64);
+                else if (auto r_double = stream::Parse<double>(view))
+                    value.Set(int64_t(*r_double));
+                else
+                    return KeyValuesVariant(view);
+                break;
+            }
+            case Types::Float:
+            {
+                auto r_double = stream::Parse<double>(view);
+                if (!r_double)
+                    return KeyValuesVariant(view);
+                value.Set(*r_double);
+                break;
+            }
+            case Types::Vector2:
+            case Types::Vector3:
+            case Types::Vector4:
+            {
+                const int count = type - Types::Vector2 + 2;
+
+                vec4 vec = vec4(fill);
+                int parsed = 0;
+                for (std::string_view component : str::split(view, " "))
+                {
+                    if (parsed == count)
+                        break;
+
+                    auto r_float = stream::Parse<float>(component);
+                    if (!r_float)
+                        break;
+                    vec[parsed++] = *r_float;
+                }
+
+                if (parsed == 0)
+                    return KeyValuesVariant(view);
+
+                if      (type == Types::Vector2) value.Set(vec2(vec));
+                else if (type == Types::Vector3) value.Set(vec3(vec));
+                else                             value.Set(vec);
+                break;
+            }
+            default:
+                return KeyValuesVariant(view);
+        }
+
+        value.m_str = view;
+        return value;
+    }
+
     inline void KeyValuesVariant::EnsureType(KeyValuesType type)
     {
         if (m_type == type)
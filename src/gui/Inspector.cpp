@@ -89,7 +89,7 @@ namespace chisel
 
     void Inspector::DrawEntityInspector(Entity* ent)
     {
-        const FGD::Class& cls = Chisel.fgd->classes[ent->classname];
+        const FGD::Class& cls = Core.fgd->classes[ent->classname];
 
         constexpr float iconSize = 64;
         constexpr float iconPadding = 8;
@@ -134,7 +134,11 @@ namespace chisel
         ImGui::SetCursorPos({cursorPos.x + iconSize + iconPadding, cursorPos.y});
 
         // Draw classname picker
-        ClassnamePicker(&ent->classname, cls.type == FGD::SolidClass);
+        if (ClassnamePicker(&ent->classname, cls.type == FGD::SolidClass))
+        {
+            ent->MarkDirty();
+            ent->ParseKeyValues();
+        }
 
         // Draw help icon
         ImGui::BeginDisabled(!hasHelp);
@@ -222,12 +226,13 @@ namespace chisel
         ImGui::EndTable();
     }
 
-    void Inspector::ClassnamePicker(std::string* classname, bool solids, const char* label)
+    bool Inspector::ClassnamePicker(std::string* classname, bool solids, const char* label)
     {
+        bool modified = false;
         ImGui::PushFont(GUI::FontMonospace);
         if (ImGui::BeginCombo("##classname", classname->c_str()))
         {
-            for (auto& [name, cls] : Chisel.fgd->classes)
+            for (auto& [name, cls] : Core.fgd->classes)
             {
                 if (cls.type == FGD::BaseClass)
                     continue;
@@ -243,6 +248,7 @@ namespace chisel
                 bool selected = *classname == name;
                 if (ImGui::Selectable(name.c_str(), selected)) {
                     *classname = name;
+                    modified = true;
                 }
                 if (selected)
                     ImGui::SetItemDefaultFocus();
@@ -255,6 +261,7 @@ namespace chisel
             ImGui::SameLine();
             ImGui::TextUnformatted(label);
         }
+        return modified;
     }
 
     inline bool Inspector::ValueInput(const char* name, const FGD::Var& var, kv::KeyValuesVariant& kv)
@@ -264,8 +271,8 @@ namespace chisel
        
         auto type = var.type;
         
-        // If a non-string type has a string value (i.e. from VMF
-        // or raw edit mode), then make it non-editable
+        // If a non-string type has a string value (i.e. text that
+        // didn't parse as its type), then make it non-editable
         switch (type)
         {
             case StudioModel:
@@ -347,7 +354,7 @@ namespace chisel
                     if (ImGui::Selectable(name.c_str(), selected))
                     {
                         modified = true;
-                        kv = std::move(kv::KeyValuesVariant::Parse(key));
+                        kv = var.Parse(key);
                     }
                     if (selected)
                         ImGui::SetItemDefaultFocus();
@@ -397,7 +404,7 @@ namespace chisel
     {
         std::string text = std::string(value.Get<std::string_view>());
         if (ImGui::InputText((std::string("##") + var.name).c_str(), &text)) {
-            value = kv::KeyValuesVariant::Parse(text);
+            value = var.Parse(text);
             return true;
         }
         return false;
@@ -410,7 +417,7 @@ namespace chisel
             kv = &ent->kv[var.name];
         else
         {
-            kv = &ent->kv.CreateChild(var.name, var.defaultValue.c_str());
+            kv = &ent->kv.CreateTypedChild(var.name, var.Parse(var.defaultValue));
             defaultVal = true;
         }
 
@@ -430,8 +437,14 @@ namespace chisel
         kv::KeyValuesVariant *kv = nullptr;
         const bool defaultVal = GetKV(var, ent, kv);
 
+        const bool editing = m_editEntity == ent->GetAtomID() && m_editVar == var.hash;
+        std::string before;
+        if (editing)
+            before = std::string(kv->Get<std::string_view>());
+
         ImGui::PushID(var.name.c_str());
         ImGui::BeginDisabled(var.readOnly);
+        ImGui::BeginGroup();
 
         float cursorX, width = -FLT_MIN;
 
@@ -456,15 +469,26 @@ namespace chisel
 
             if (ImGui::Button(ICON_MC_ARROW_U_LEFT_TOP))
             {
-                *kv = std::move(kv::KeyValuesVariant::Parse(var.defaultValue));
+                *kv = var.Parse(var.defaultValue);
                 modified = true;
             }
 
             ImGui::EndDisabled();
         }
 
+        ImGui::EndGroup();
+        if (ImGui::IsItemHovered() || ImGui::IsItemActive())
+        {
+            m_editEntity = ent->GetAtomID();
+            m_editVar    = var.hash;
+        }
+
         if (modified)
+        {
             kv->ValueChanged();
+            if (editing)
+                Chisel.map.Actions().KeyValueChanged(*ent, var.name, before, kv->Get<std::string_view>());
+        }
 
         ImGui::EndDisabled();
         ImGui::PopID();
@@ -564,12 +588,17 @@ namespace chisel
                 }
                 else if (hash == "origin"_hash && cls->type != FGD::SolidClass)
                 {
-                    if (PointEntity* point = dynamic_cast<PointEntity*>(ent))
+                    if (!ent->IsBrushEntity())
                     {
+                        PointEntity* point = static_cast<PointEntity*>(ent);
                         ImGui::TableNextRow(); ImGui::TableNextColumn();
                         VarLabel("Position", "The absolute position of this entity.", "origin");
                         ImGui::SetNextItemWidth(-FLT_MIN);
-                        ImGui::DragFloat3("##position", &point->origin.x, 1.f, 0.f, 0.f, "%g", ImGuiSliderFlags_NoRoundToFormat);
+                        if (ImGui::DragFloat3("##position", &point->origin.x, 1.f, 0.f, 0.f, "%g", ImGuiSliderFlags_NoRoundToFormat))
+                        {
+                            point->MarkDirty();
+                            Selection.InvalidateBounds();
+                        }
                     }
                 }
                 else if (var && hash == "spawnflags"_hash)
@@ -22,7 +22,8 @@ namespace chisel
         void DrawEntityInspector(Entity* ent);
         void DrawFaceInspector(Face *side);
 
-        static void ClassnamePicker(std::string* classname, bool solids = false, const char* label = nullptr);
+        // True if the classname was changed.
+        static bool ClassnamePicker(std::string* classname, bool solids = false, const char* label = nullptr);
 
         Rc<Texture> defaultIcons[4];
         uint32_t defaultIconIndex = 1;
@@ -46,5 +47,11 @@ namespace chisel
         }
 
         static constexpr uint32 ModifiedColor = 0xff332e1f;
+
+    private:
+        // The last row the mouse was over or that was being edited. Only it can change
+        // this frame, so only its value is kept for undo. Stays put while its popups are open.
+        uint32_t m_editEntity = 0; // AtomID
+        Hash     m_editVar    = 0;
     };
 }
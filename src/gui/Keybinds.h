@@ -44,7 +44,9 @@ namespace chisel
             }
 
             if (Keyboard.GetKeyUp(Key::Delete)) {
+                map.Actions().Begin("Delete");
                 Selection.Delete();
+                map.Actions().End();
             }
         }
     };
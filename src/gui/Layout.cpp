@@ -37,10 +37,14 @@ namespace chisel
 
     void SelectionModeToolbar::Option(const char* name, SelectMode mode)
     {
-        bool selected = Chisel.selectMode == mode;
+        bool selected = Core.selectMode == mode;
 
-        if (RadioButton(name, selected))
-            Chisel.selectMode = mode;
+        // Changes what hovering and clicking pick, so views draw again.
+        if (RadioButton(name, selected) && !selected)
+        {
+            Core.selectMode = mode;
+            Core.SceneChanged();
+        }
     }
 
     //--------------------------------------------------
@@ -260,7 +264,7 @@ namespace chisel
         ImGui::PushStyleColor(ImGuiCol_Button, ImGui::GetStyleColorVec4(col));
 
         if (ImGui::Button(icon)) {
-            Chisel.tool = tool;
+            Chisel.SetTool(tool);
         }
         if (ImGui::IsItemHovered()) {
             ImGui::SetTooltip(name);
@@ -347,6 +351,7 @@ namespace chisel
                 }
 
                 MenuItem(ICON_MC_COG " Settings", "", &Chisel.settingsWindow->open);
+                MenuItem(Chisel.profilerWindow->name.c_str(), "", &Chisel.profilerWindow->open);
                 MenuItem(ICON_MC_APPLICATION_OUTLINE " GUI Demo", "", &gui_demo.value);
                 ImGui::EndMenu();
             }
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Window.h"
+#include <imgui.h>
+
+#include "common/Profiler.h"
+#include "console/Console.h"
+
+#include "gui/Common.h"
+#include "gui/IconsMaterialCommunity.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace chisel::GUI
+{
+    // Frame times and where the last frame went, by zone.
+    struct ProfilerWindow : public Window
+    {
+        ProfilerWindow() : Window(ICON_MC_CHART_BAR, "Profiler", 512, 512, false) {}
+
+        struct ZoneTotal
+        {
+            const char* name;
+            uint32_t    depth;
+            uint32_t    calls = 0;
+            double      totalMs = 0;
+            double      maxMs = 0;
+        };
+
+        bool paused = false;
+        char tracePath[260] = "profile.json";
+
+        std::vector<Profiler::Frame>      frames;
+        std::vector<Profiler::ZoneRecord> zones;
+        std::vector<ZoneTotal>            totals;
+        std::vector<float>                frameMs;
+
+        void Draw() final override
+        {
+            if (!paused)
+                Capture();
+
+            ImGui::Checkbox("Pause", &paused);
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(200);
+            ImGui::InputText("##TracePath", tracePath, sizeof(tracePath));
+            ImGui::SameLine();
+            if (ImGui::Button("Dump Trace"))
+                Console.Execute(std::string("profile_dump ") + tracePath);
+
+            if (frameMs.empty())
+            {
+                ImGui::TextUnformatted("No frames recorded.");
+                return;
+            }
+
+            float worst = *std::max_element(frameMs.begin(), frameMs.end());
+            std::string overlay = fmt::format("{:.2f} ms (worst {:.2f} ms)", frameMs.back(), worst);
+            ImGui::PlotLines("##FrameTimes", frameMs.data(), int(frameMs.size()), 0, overlay.c_str(), 0.0f, std::max(worst, 16.7f), ImVec2(-FLT_MIN, 80));
+
+            ImGuiTableFlags tableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+            if (ImGui::BeginTable("Zones", 4, tableFlags))
+            {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                ImGui::TableSetupColumn("Zone", ImGuiTableColumnFlags_WidthStretch);
+                ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_WidthFixed, 50);
+                ImGui::TableSetupColumn("Total ms", ImGuiTableColumnFlags_WidthFixed, 70);
+                ImGui::TableSetupColumn("Max ms", ImGuiTableColumnFlags_WidthFixed, 70);
+                ImGui::TableHeadersRow();
+
+                ImGui::PushFont(GUI::FontMonospace);
+                for (const ZoneTotal& total : totals)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Indent(float(total.depth) * 10.0f + 0.001f);
+                    ImGui::TextUnformatted(total.name);
+                    ImGui::Unindent(float(total.depth) * 10.0f + 0.001f);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", total.calls);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", total.totalMs);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", total.maxMs);
+                }
+                ImGui::PopFont();
+
+                ImGui::EndTable();
+            }
+        }
+
+        // Totals for the last finished frame, on every thread.
+        void Capture()
+        {
+            frames = Profiler.GetFrames();
+
+            frameMs.clear();
+            for (auto it = frames.rbegin(); it != frames.rend(); ++it)
+                frameMs.push_back(float((it->end - it->start) / 1e6));
+
+            totals.clear();
+            if (frames.empty())
+                return;
+
+            zones.clear();
+            Profiler.Collect(zones, frames[0].start, frames[0].end);
+
+            std::unordered_map<const char*, size_t> byName;
+            for (const Profiler::ZoneRecord& record : zones)
+            {
+                auto [it, inserted] = byName.try_emplace(record.zone.name, totals.size());
+                if (inserted)
+                    totals.push_back(ZoneTotal{ record.zone.name, record.zone.depth });
+
+                ZoneTotal& total = totals[it->second];
+                double ms = (record.zone.end - record.zone.start) / 1e6;
+                total.depth = std::min(total.depth, record.zone.depth);
+                total.calls++;
+                total.totalMs += ms;
+                total.maxMs = std::max(total.maxMs, ms);
+            }
+
+            std::sort(totals.begin(), totals.end(), [](const ZoneTotal& a, const ZoneTotal& b) { return a.totalMs > b.totalMs; });
+        }
+    };
+}
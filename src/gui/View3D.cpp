@@ -89,6 +89,7 @@ namespace chisel
     void View3D::PostDraw()
     {
         ResetPadding();
+        handleCommands.Reset();
 
         if (!visible)
             return;
@@ -104,7 +105,7 @@ namespace chisel
 
         // Draw grid
         if (view_grid_show)
-            Handles.DrawGrid(camera, view_grid_size);
+            Handles.DrawGrid(handleCommands, camera, view_grid_size);
 
         OnPostDraw();
     }
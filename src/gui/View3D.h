@@ -4,6 +4,7 @@
 #include "console/ConVar.h"
 #include "core/Camera.h"
 #include "render/Render.h"
+#include "render/CommandList.h"
 
 namespace chisel
 {
@@ -15,10 +16,6 @@ namespace chisel
     inline ConVar<bool>  view_rotate_snap("view_rotate_snap", true, "Snap rotation angles.");
     inline ConVar<float>  view_rotate_snap_angle("view_rotate_snap_angle", 15.f, "Snap rotation angles.");
 
-    inline ConVar<bool>  trans_texture_lock("trans_texture_lock", true, "Enable texture lock for transformations.");
-    inline ConVar<bool>  trans_texture_scale_lock("trans_texture_scale_lock", false, "Enable scaling texture lock.");
-    inline ConVar<bool>  trans_texture_face_alignment("trans_texture_face_alignment", true, "Enable texture face alignment.");
-
     struct View3D : public GUI::Window
     {
         View3D(auto... args) : GUI::Window(args...) { }
@@ -32,6 +29,9 @@ namespace chisel
         bool  mouseOver      = false;
         bool  popupOpen      = false;
 
+        // Handles and grid, recorded while the window is drawn and submitted over the scene.
+        render::CommandList handleCommands;
+
     // Rendering //
         virtual void  Render() = 0;
         virtual void* GetMainTexture() = 0;
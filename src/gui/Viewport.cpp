@@ -46,10 +46,11 @@ namespace chisel
     void Viewport::DrawHandles(mat4x4& view, mat4x4& proj)
     {
         // Draw general handles
-        Chisel.Renderer->DrawHandles(view, proj);
+        Chisel.Renderer->DrawHandles(*this, handleCommands);
 
         // Draw transform handles
         Chisel.tool->DrawHandles(*this);
+        Chisel.Renderer->FlushHandles(handleCommands);
         
         // Draw view cube
         {
@@ -97,15 +98,27 @@ namespace chisel
                 ImGui::Selectable( ICON_MC_CLIPBOARD " Paste (TODO)");
                 if (ImGui::Selectable( ICON_MC_TRASH_CAN " Delete"))
                 {
+                    map.Actions().Begin("Delete");
                     Selection.Delete();
+                    map.Actions().End();
                 }
                 ImGui::Separator();
 
                 if (ImGui::Selectable( ICON_MC_GRID " Align to Grid"))
+                {
+                    map.Actions().Begin("Align to Grid");
+                    map.Actions().SaveSelection();
                     Selection.AlignToGrid(view_grid_size);
+                    map.Actions().End();
+                }
 
                 if (ImGui::Selectable( ICON_MC_CONTENT_DUPLICATE " Duplicate"))
+                {
+                    map.Actions().Begin("Duplicate");
                     Selection.Duplicate();
+                    map.Actions().SelectionAdded();
+                    map.Actions().End();
+                }
 
                 ImGui::EndPopup();
             }
@@ -23,6 +23,11 @@ namespace chisel
         Rc<render::DepthStencil> ds_SceneView;
         Rc<render::RenderTarget> rt_ObjectID;
 
+        // Recorded by MapRender once the UI is done, maybe on another thread.
+        render::CommandList sceneCommands;
+        // MapRender::ViewportKey of what's in the render targets.
+        uint64_t drawnKey = 0;
+
     // Rendering //
         void  Render() override;
         void* GetMainTexture() override;
@@ -14,6 +14,8 @@ namespace chisel
         bool GetButtonDown(E key) const { return keysDown[key]; }
         // True if button was released this frame
         bool GetButtonUp(E key) const { return keysUp[key]; }
+        // True if any button is held down
+        bool AnyHeld() const { return !keys.Empty(); }
 
         void SetButton(E key, bool down)
         {
@@ -49,6 +49,8 @@ namespace chisel
 
         // True if any of the keys are currently held down
         bool AnyKey(auto... keys) const { return (GetKey(keys) || ...); }
+        // True if any key at all is held down
+        bool AnyKeyHeld() const { return keys.AnyHeld(); }
 
         // Modifier keys
         bool ctrl  = false;
@@ -35,6 +35,8 @@ namespace chisel
         bool GetButtonDown(MouseButton btn) const { return buttons.GetButtonDown(btn); }
         // True if mouse button was released this frame
         bool GetButtonUp(MouseButton btn) const { return buttons.GetButtonUp(btn); }
+        // True if any mouse button is held down
+        bool AnyButtonHeld() const { return buttons.AnyHeld(); }
 
         // Relative (delta) motion accumulated since last frame
         int2 GetMotion() { return motion; }
@@ -50,6 +50,13 @@ namespace chisel
         // Present if necessary.
         virtual void Update() { }
 
+        // Blocks until an event arrives or timeout seconds pass, whichever is first.
+        // Returns false if it timed out. Backends that can't wait return straight away.
+        virtual bool WaitForEvents(double timeout) { return true; }
+
+        // Events read by the last PreUpdate.
+        uint eventCount = 0;
+
         virtual uint2 GetSize() = 0;
         virtual const char* GetTitle() = 0;
 
@@ -118,9 +118,12 @@ namespace chisel
 
         void PreUpdate()
         {
+            eventCount = 0;
+
             SDL_Event e;
             while (SDL_PollEvent(&e))
             {
+                eventCount++;
                 switch(e.type)
                 {
                     case SDL_KEYDOWN:
@@ -185,6 +188,11 @@ namespace chisel
         #endif
         }
 
+        bool WaitForEvents(double timeout)
+        {
+            // Leaves the event in the queue for PreUpdate.
+            return SDL_WaitEventTimeout(nullptr, int(timeout * 1000.0)) != 0;
+        }
 
         uint2 GetSize()
         {
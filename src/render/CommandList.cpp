@@ -0,0 +1,84 @@
+#include "render/CommandList.h"
+#include "common/Hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace chisel::render
+{
+    static constexpr uint32_t AlignUp(uint32_t size, uint32_t align)
+    {
+        return (size + align - 1) / align * align;
+    }
+
+    void CommandList::Reset()
+    {
+        m_commands.clear();
+        m_upload.clear();
+        m_stats = Stats{};
+    }
+
+    void* CommandList::Allocate(Command type, uint32_t size, uint32_t extra)
+    {
+        uint32_t total = AlignUp(uint32_t(sizeof(Header)) + size + extra, Align);
+
+        size_t offset = m_commands.size();
+        m_commands.resize(offset + total);
+
+        auto* header = new (&m_commands[offset]) Header{ type, total };
+
+        m_stats.commands++;
+        m_stats.bytes += total;
+        return header + 1;
+    }
+
+    void CommandList::SetRenderTargets(std::span<ID3D11RenderTargetView* const> rtvs, ID3D11DepthStencilView* dsv)
+    {
+        auto* command = new (Allocate(Command::SetRenderTargets, sizeof(cmd::SetRenderTargets), 0)) cmd::SetRenderTargets{};
+        command->count = uint(std::min<size_t>(rtvs.size(), std::size(command->rtvs)));
+        std::copy_n(rtvs.begin(), command->count, command->rtvs);
+        command->dsv = dsv;
+    }
+
+    void CommandList::UploadConstBuffer(int slot, ID3D11Buffer* buffer, const void* data, uint size, ShaderStages stages)
+    {
+        auto* command = new (Allocate(Command::UploadConstBuffer, sizeof(cmd::UploadConstBuffer), size)) cmd::UploadConstBuffer{ buffer, slot, stages, size };
+        std::memcpy(command + 1, data, size);
+    }
+
+    void* CommandList::Upload(uint size, uint& offset)
+    {
+        // Enough for any vertex attribute
+        offset = AlignUp(uint32_t(m_upload.size()), 16);
+        m_upload.resize(offset + size);
+
+        m_stats.upload = uint32_t(m_upload.size());
+        return &m_upload[offset];
+    }
+
+    uint64_t CommandList::Hash() const
+    {
+        uint64_t hash = HashBytes(m_commands.data(), m_commands.size());
+        return HashBytes(m_upload.data(), m_upload.size(), hash);
+    }
+
+    //--------------------------------------------------
+    //  NullCommandBackend
+    //--------------------------------------------------
+
+    void NullCommandBackend::Submit(const CommandList& list)
+    {
+        m_stats.lists++;
+        m_stats.upload += list.UploadData().size();
+
+        list.Visit([this]<typename T>([[maybe_unused]] const T& command)
+        {
+            m_stats.commands++;
+            m_stats.counts[size_t(T::Type)]++;
+
+            if constexpr (T::Type == Command::Draw || T::Type == Command::DrawIndexed || T::Type == Command::DrawInstanced
+                       || T::Type == Command::DrawMesh || T::Type == Command::DrawMeshInstanced)
+                m_stats.draws++;
+        });
+    }
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include "render/Render.h"
+
+#include <cstddef>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace chisel::render
+{
+    enum class Command : uint8_t
+    {
+        SetShader,
+        SetBlendState,
+        SetDepthStencilState,
+        SetRasterState,
+        SetSampler,
+        SetShaderResource,
+        SetTopology,
+        SetVertexBuffer,
+        SetUploadVertexBuffer,
+        SetIndexBuffer,
+        SetRenderTargets,
+        SetViewport,
+        ClearRenderTarget,
+        ClearDepthStencil,
+        UploadConstBuffer,
+        Draw,
+        DrawIndexed,
+        DrawInstanced,
+        DrawMesh,
+        DrawMeshInstanced,
+
+        Count
+    };
+
+    // What each command stores. The stream is a header then one of these, padded to 8 bytes.
+    namespace cmd
+    {
+        struct SetShader            { static constexpr Command Type = Command::SetShader;            const Shader* shader; };
+        struct SetBlendState        { static constexpr Command Type = Command::SetBlendState;        const BlendState* state; vec4 factor; uint32 sampleMask; };
+        struct SetDepthStencilState { static constexpr Command Type = Command::SetDepthStencilState; ID3D11DepthStencilState* state; uint stencilRef; };
+        struct SetRasterState       { static constexpr Command Type = Command::SetRasterState;       ID3D11RasterizerState* state; };
+        struct SetSampler           { static constexpr Command Type = Command::SetSampler;           ID3D11SamplerState* sampler; uint slot; };
+        struct SetShaderResource    { static constexpr Command Type = Command::SetShaderResource;    ID3D11ShaderResourceView* srv; uint slot; };
+        struct SetTopology          { static constexpr Command Type = Command::SetTopology;          D3D11_PRIMITIVE_TOPOLOGY topology; };
+        struct SetVertexBuffer      { static constexpr Command Type = Command::SetVertexBuffer;      ID3D11Buffer* buffer; uint slot, stride, offset; };
+        // Binds the upload buffer, offset is into CommandList::UploadData.
+        struct SetUploadVertexBuffer{ static constexpr Command Type = Command::SetUploadVertexBuffer; uint slot, stride, offset; };
+        struct SetIndexBuffer       { static constexpr Command Type = Command::SetIndexBuffer;       ID3D11Buffer* buffer; DXGI_FORMAT format; uint offset; };
+        struct SetRenderTargets     { static constexpr Command Type = Command::SetRenderTargets;     ID3D11RenderTargetView* rtvs[2]; ID3D11DepthStencilView* dsv; uint count; };
+        struct SetViewport          { static constexpr Command Type = Command::SetViewport;          D3D11_VIEWPORT viewport; };
+        struct ClearRenderTarget    { static constexpr Command Type = Command::ClearRenderTarget;    ID3D11RenderTargetView* rtv; vec4 color; };
+        struct ClearDepthStencil    { static constexpr Command Type = Command::ClearDepthStencil;    ID3D11DepthStencilView* dsv; float depth; };
+        // Followed by size bytes of data.
+        struct UploadConstBuffer    { static constexpr Command Type = Command::UploadConstBuffer;    ID3D11Buffer* buffer; int slot; ShaderStages stages; uint size;
+                                      const void* Data() const { return this + 1; } };
+        struct Draw                 { static constexpr Command Type = Command::Draw;                 uint vertexCount, firstVertex; };
+        struct DrawIndexed          { static constexpr Command Type = Command::DrawIndexed;          uint indexCount, firstIndex; int baseVertex; };
+        struct DrawInstanced        { static constexpr Command Type = Command::DrawInstanced;        uint vertexCount, instanceCount, firstVertex, firstInstance; };
+        struct DrawMesh             { static constexpr Command Type = Command::DrawMesh;             Mesh* mesh; uint lod; };
+        // Instances come from the upload buffer, offset is into CommandList::UploadData.
+        struct DrawMeshInstanced    { static constexpr Command Type = Command::DrawMeshInstanced;    Mesh* mesh; uint stride, offset, instanceCount, lod; };
+    }
+
+    /**
+     * Draws and state changes, recorded into a linear buffer to be submitted later.
+     *
+     * Recording never touches the device or context, so any thread can record into its own list,
+     * e.g. one per viewport, while a single Submit on the main thread replays them all to D3D11.
+     * The calls mirror RenderContext's, so code can move between the two.
+     *
+     * Vertex and instance data written during recording goes into the list's upload area,
+     * which the backend copies into one dynamic buffer right before replaying.
+     */
+    class CommandList
+    {
+    public:
+        struct Stats
+        {
+            uint32_t commands = 0;
+            uint32_t draws    = 0;
+            uint32_t bytes    = 0; // Commands and const buffer data
+            uint32_t upload   = 0; // Vertex and instance data
+        };
+
+        // Forgets everything recorded, keeping the memory.
+        void Reset();
+
+        bool Empty() const { return m_commands.empty(); }
+        const Stats& GetStats() const { return m_stats; }
+
+        void SetShader(const Shader& shader)                                       { Record<cmd::SetShader>(&shader); }
+        // The state must outlive the list, e.g. one of BlendFuncs. nullptr for the default.
+        void SetBlendState(const BlendState& state, vec4 factor = vec4(1), uint32 sampleMask = 0xFFFFFFFF)
+                                                                                    { Record<cmd::SetBlendState>(&state, factor, sampleMask); }
+        void SetBlendState(std::nullptr_t)                                          { Record<cmd::SetBlendState>(nullptr, vec4(1), 0xFFFFFFFF); }
+        void SetDepthStencilState(const Com<ID3D11DepthStencilState>& state, uint stencilRef = 0)
+                                                                                    { Record<cmd::SetDepthStencilState>(state.ptr(), stencilRef); }
+        void SetRasterState(const Com<ID3D11RasterizerState>& state)                { Record<cmd::SetRasterState>(state.ptr()); }
+        void SetSampler(uint slot, const Com<ID3D11SamplerState>& sampler)          { Record<cmd::SetSampler>(sampler.ptr(), slot); }
+        void SetShaderResource(uint slot, ID3D11ShaderResourceView* srv)            { Record<cmd::SetShaderResource>(srv, slot); }
+        void SetTopology(D3D11_PRIMITIVE_TOPOLOGY topology)                         { Record<cmd::SetTopology>(topology); }
+        void SetVertexBuffer(uint slot, ID3D11Buffer* buffer, uint stride, uint offset = 0) { Record<cmd::SetVertexBuffer>(buffer, slot, stride, offset); }
+        void SetUploadVertexBuffer(uint slot, uint stride, uint offset)             { Record<cmd::SetUploadVertexBuffer>(slot, stride, offset); }
+        void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, uint offset)  { Record<cmd::SetIndexBuffer>(buffer, format, offset); }
+        void SetViewport(const D3D11_VIEWPORT& viewport)                            { Record<cmd::SetViewport>(viewport); }
+        void ClearRenderTarget(ID3D11RenderTargetView* rtv, vec4 color)             { Record<cmd::ClearRenderTarget>(rtv, color); }
+        void ClearDepthStencil(ID3D11DepthStencilView* dsv, float depth = 1.0f)     { Record<cmd::ClearDepthStencil>(dsv, depth); }
+
+        // Up to two render targets.
+        void SetRenderTargets(std::span<ID3D11RenderTargetView* const> rtvs, ID3D11DepthStencilView* dsv);
+
+        // The data is copied in, and uploaded when this command is replayed.
+        void UploadConstBuffer(int slot, ID3D11Buffer* buffer, const void* data, uint size, ShaderStages stages);
+
+        template <typename T>
+        void UploadConstBuffer(int slot, const Com<ID3D11Buffer>& buffer, const T& data, ShaderStages stages = VertexShader | PixelShader)
+        {
+            UploadConstBuffer(slot, buffer.ptr(), &data, uint(sizeof(T)), stages);
+        }
+
+        void Draw(uint vertexCount, uint firstVertex = 0)                           { Record<cmd::Draw>(vertexCount, firstVertex); m_stats.draws++; }
+        void DrawIndexed(uint indexCount, uint firstIndex = 0, int baseVertex = 0)  { Record<cmd::DrawIndexed>(indexCount, firstIndex, baseVertex); m_stats.draws++; }
+        void DrawInstanced(uint vertexCount, uint instanceCount, uint firstVertex = 0, uint firstInstance = 0)
+                                                                                    { Record<cmd::DrawInstanced>(vertexCount, instanceCount, firstVertex, firstInstance); m_stats.draws++; }
+        void DrawMesh(Mesh* mesh, uint lod = 0)                                     { Record<cmd::DrawMesh>(mesh, lod); m_stats.draws++; }
+        // Instances from the upload area, see Upload.
+        void DrawMeshInstanced(Mesh* mesh, uint stride, uint offset, uint instanceCount, uint lod = 0)
+                                                                                    { Record<cmd::DrawMeshInstanced>(mesh, stride, offset, instanceCount, lod); m_stats.draws++; }
+
+        // Reserves size bytes in the upload area and returns where to write them,
+        // valid until the next Upload. offset is what to bind or draw with.
+        void* Upload(uint size, uint& offset);
+
+        std::span<const std::byte> UploadData() const { return m_upload; }
+
+        // Of everything recorded, including uploads. Lists recorded the same way hash the same,
+        // so a caller can tell if it would draw exactly what it drew last time.
+        uint64_t Hash() const;
+
+        // Calls fn with each command in order, as its cmd:: struct.
+        template <typename Fn>
+        void Visit(Fn&& fn) const;
+
+    private:
+        struct Header
+        {
+            Command  type;
+            uint32_t size; // Including the header and padding
+        };
+
+        static constexpr uint32_t Align = 8;
+
+        // Space for a command and extra bytes after it.
+        void* Allocate(Command type, uint32_t size, uint32_t extra);
+
+        // Built in place, so padding keeps the zeroes Allocate gave it and equal lists hash the same.
+        template <typename T, typename... Args>
+        void Record(Args&&... args)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            new (Allocate(T::Type, sizeof(T), 0)) T{ std::forward<Args>(args)... };
+        }
+
+        std::vector<std::byte> m_commands;
+        std::vector<std::byte> m_upload;
+        Stats m_stats;
+    };
+
+    template <typename Fn>
+    void CommandList::Visit(Fn&& fn) const
+    {
+        for (size_t offset = 0; offset < m_commands.size();)
+        {
+            const Header* header = reinterpret_cast<const Header*>(&m_commands[offset]);
+            const void* data = &m_commands[offset + sizeof(Header)];
+            offset += header->size;
+
+            switch (header->type)
+            {
+                case Command::SetShader:             fn(*static_cast<const cmd::SetShader*>(data)); break;
+                case Command::SetBlendState:         fn(*static_cast<const cmd::SetBlendState*>(data)); break;
+                case Command::SetDepthStencilState:  fn(*static_cast<const cmd::SetDepthStencilState*>(data)); break;
+                case Command::SetRasterState:        fn(*static_cast<const cmd::SetRasterState*>(data)); break;
+                case Command::SetSampler:            fn(*static_cast<const cmd::SetSampler*>(data)); break;
+                case Command::SetShaderResource:     fn(*static_cast<const cmd::SetShaderResource*>(data)); break;
+                case Command::SetTopology:           fn(*static_cast<const cmd::SetTopology*>(data)); break;
+                case Command::SetVertexBuffer:       fn(*static_cast<const cmd::SetVertexBuffer*>(data)); break;
+                case Command::SetUploadVertexBuffer: fn(*static_cast<const cmd::SetUploadVertexBuffer*>(data)); break;
+                case Command::SetIndexBuffer:        fn(*static_cast<const cmd::SetIndexBuffer*>(data)); break;
+                case Command::SetRenderTargets:      fn(*static_cast<const cmd::SetRenderTargets*>(data)); break;
+                case Command::SetViewport:           fn(*static_cast<const cmd::SetViewport*>(data)); break;
+                case Command::ClearRenderTarget:     fn(*static_cast<const cmd::ClearRenderTarget*>(data)); break;
+                case Command::ClearDepthStencil:     fn(*static_cast<const cmd::ClearDepthStencil*>(data)); break;
+                case Command::UploadConstBuffer:     fn(*static_cast<const cmd::UploadConstBuffer*>(data)); break;
+                case Command::Draw:                  fn(*static_cast<const cmd::Draw*>(data)); break;
+                case Command::DrawIndexed:           fn(*static_cast<const cmd::DrawIndexed*>(data)); break;
+                case Command::DrawInstanced:         fn(*static_cast<const cmd::DrawInstanced*>(data)); break;
+                case Command::DrawMesh:              fn(*static_cast<const cmd::DrawMesh*>(data)); break;
+                case Command::DrawMeshInstanced:     fn(*static_cast<const cmd::DrawMeshInstanced*>(data)); break;
+                default: break;
+            }
+        }
+    }
+
+    /**
+     * Replays command lists without a device, counting what would have been submitted.
+     * For running the whole recording and submission path headless, e.g. in benchmarks.
+     */
+    struct NullCommandBackend final : CommandBackend
+    {
+        struct Stats
+        {
+            uint32_t lists    = 0;
+            uint32_t commands = 0;
+            uint32_t draws    = 0;
+            uint64_t upload   = 0; // Bytes that would have been copied to the GPU
+            uint32_t counts[size_t(Command::Count)] = {};
+        };
+
+        void Submit(const CommandList& list) override;
+
+        const Stats& GetStats() const { return m_stats; }
+        void ResetStats() { m_stats = Stats{}; }
+
+    private:
+        Stats m_stats;
+    };
+}
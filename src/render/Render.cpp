@@ -1,4 +1,5 @@
 #include "render/Render.h"
+#include "render/CommandList.h"
 
 #include <imgui.h>
 #include "gui/Common.h"
@@ -10,6 +11,9 @@
 #include "render/TextureFormat.h"
 #include "console/ConVar.h"
 
+#include <algorithm>
+#include <bit>
+
 namespace chisel::render
 {
     static ConVar<bool> r_vsync("r_vsync", true, "Enable/disable vsync");
@@ -65,6 +69,9 @@ namespace chisel::render
 
         swapchain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backbuffer.texture));
         device->CreateRenderTargetView(backbuffer.texture.ptr(), nullptr, &backbuffer.rtv);
+        D3D11_TEXTURE2D_DESC backbufferDesc;
+        backbuffer.texture->GetDesc(&backbufferDesc);
+        backbuffer.SetDesc(backbufferDesc);
 
         window->SetResizeCallback([this](uint width, uint height)
         {
@@ -75,6 +82,9 @@ namespace chisel::render
                 Console.Error("Failed to resize swapchain to {} x {} (is something using the backbuffer?)", width, height);
             swapchain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backbuffer.texture));
             device->CreateRenderTargetView(backbuffer.texture.ptr(), nullptr, &backbuffer.rtv);
+            D3D11_TEXTURE2D_DESC desc;
+            backbuffer.texture->GetDesc(&desc);
+            backbuffer.SetDesc(desc);
         });
 
         GUI::Setup();
@@ -269,6 +279,7 @@ namespace chisel::render
             .MiscFlags = 0,
         };
         device->CreateTexture2D(&rtDesc, nullptr, &rt.texture);
+        rt.SetDesc(rtDesc);
         D3D11_RENDER_TARGET_VIEW_DESC rtvDesc =
         {
             .Format = LinearToSRGB(format),
@@ -326,6 +337,7 @@ namespace chisel::render
             .MiscFlags = 0,
         };
         device->CreateTexture2D(&dsDesc, nullptr, &ds.texture);
+        ds.SetDesc(dsDesc);
         device->CreateDepthStencilView(ds.texture.ptr(), nullptr, &ds.dsv);
         return obj;
     }
@@ -503,30 +515,67 @@ namespace chisel::render
         return buffer;
     }
 
+    void* RenderContext::MapDynamicBuffer(Com<ID3D11Buffer>& buffer, uint32& capacity, uint32 size, uint bindFlags)
+    {
+        if (size > capacity || buffer == nullptr)
+        {
+            D3D11_BUFFER_DESC desc
+            {
+                .ByteWidth      = std::bit_ceil(std::max(size, 64u * 1024u)),
+                .Usage          = D3D11_USAGE_DYNAMIC,
+                .BindFlags      = bindFlags,
+                .CPUAccessFlags = D3D11_CPU_ACCESS_WRITE,
+            };
+
+            buffer = nullptr;
+            capacity = 0;
+            if (FAILED(device->CreateBuffer(&desc, nullptr, &buffer)))
+            {
+                Console.Error("[D3D11] Failed to create a {} KB dynamic buffer", desc.ByteWidth / 1024);
+                return nullptr;
+            }
+            capacity = desc.ByteWidth;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (FAILED(ctx->Map(buffer.ptr(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+            return nullptr;
+
+        return mapped.pData;
+    }
+
     //--------------------------------------------------
     //  DrawMesh
     //--------------------------------------------------
 
-    void RenderContext::DrawMesh(Mesh* mesh)
+    static void BindMeshGroup(RenderContext& r, const Mesh* mesh, const Mesh::Group& group)
     {
-        assert(mesh->uploaded);
-        int i = 0;
-        for (const Mesh::Group& group : mesh->groups)
+        if (group.material >= 0 && group.material < mesh->materials.size())
         {
-            if (group.material >= 0 && group.material < mesh->materials.size())
-            {
-                // TODO: Consistent material binding mechanism for all materials
-                // e.g. r.Bind(material)
+            // TODO: Consistent material binding mechanism for all materials
+            // e.g. r.Bind(material)
 
-                Rc<Material> material = mesh->materials[group.material];
-                ID3D11ShaderResourceView *srv = nullptr;
+            Rc<Material> material = mesh->materials[group.material];
+            ID3D11ShaderResourceView *srv = nullptr;
 
-                // Bind $basetexture
-                if (material->baseTexture != nullptr)
-                    srv = material->baseTexture->srvSRGB.ptr();
-                
-                ctx->PSSetShaderResources(0, 1, &srv);
-            }
+            // Bind $basetexture
+            if (material->baseTexture != nullptr)
+                srv = material->baseTexture->srvSRGB.ptr();
+            
+            r.ctx->PSSetShaderResources(0, 1, &srv);
+        }
+
+        const IndexBuffer& indices = group.indices;
+        if (indices.handle != nullptr)
+            r.ctx->IASetIndexBuffer((ID3D11Buffer*)indices.handle, indices.type == indices.UInt32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
+    }
+
+    void RenderContext::DrawMesh(Mesh* mesh, uint lod)
+    {
+        assert(mesh->uploaded);
+        for (const Mesh::Group& group : mesh->LODGroups(lod))
+        {
+            BindMeshGroup(*this, mesh, group);
 
             uint strides[] = {(uint)group.vertices.Stride()};
             uint offsets[] = {0};
@@ -534,20 +583,125 @@ namespace chisel::render
             
             const IndexBuffer& indices = group.indices;
             if (indices.handle != nullptr) {
-                ctx->IASetIndexBuffer((ID3D11Buffer*)indices.handle, indices.type == indices.UInt32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
-                ctx->DrawIndexed(indices.count, 0, 0);
+                ctx->DrawIndexed(group.IndexCount(), group.firstIndex, 0);
             } else {
                 ctx->Draw(group.vertices.count, 0);
             }
         }
     }
 
+    void RenderContext::DrawMeshInstanced(Mesh* mesh, ID3D11Buffer* instances, uint stride, uint offset, uint instanceCount, uint lod)
+    {
+        assert(mesh->uploaded);
+        for (const Mesh::Group& group : mesh->LODGroups(lod))
+        {
+            BindMeshGroup(*this, mesh, group);
+
+            ID3D11Buffer* buffers[] = {(ID3D11Buffer*)group.vertices.handle, instances};
+            uint strides[] = {(uint)group.vertices.Stride(), stride};
+            uint offsets[] = {0, offset};
+            ctx->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+
+            const IndexBuffer& indices = group.indices;
+            if (indices.handle != nullptr) {
+                ctx->DrawIndexedInstanced(group.IndexCount(), instanceCount, group.firstIndex, 0, 0);
+            } else {
+                ctx->DrawInstanced(group.vertices.count, instanceCount, 0, 0);
+            }
+        }
+    }
+
+    //--------------------------------------------------
+    //  Submit
+    //--------------------------------------------------
+
+    void RenderContext::Submit(const CommandList& list)
+    {
+        // All of the list's vertex and instance data in one go. Discarding gives every list its own copy,
+        // so lists submitted earlier in the frame still draw from theirs.
+        std::span<const std::byte> upload = list.UploadData();
+        ID3D11Buffer* uploaded = nullptr;
+        if (!upload.empty())
+        {
+            if (void* data = MapDynamicBuffer(uploadBuffer, uploadCapacity, uint32(upload.size())))
+            {
+                memcpy(data, upload.data(), upload.size());
+                ctx->Unmap(uploadBuffer.ptr(), 0);
+                uploaded = uploadBuffer.ptr();
+            }
+        }
+
+        struct Replay
+        {
+            RenderContext& r;
+            ID3D11Buffer* upload;
+
+            void operator()(const cmd::SetShader& c)            { r.SetShader(*c.shader); }
+            void operator()(const cmd::SetDepthStencilState& c) { r.ctx->OMSetDepthStencilState(c.state, c.stencilRef); }
+            void operator()(const cmd::SetRasterState& c)       { r.ctx->RSSetState(c.state); }
+            void operator()(const cmd::SetSampler& c)           { r.ctx->PSSetSamplers(c.slot, 1, &c.sampler); }
+            void operator()(const cmd::SetShaderResource& c)    { r.ctx->PSSetShaderResources(c.slot, 1, &c.srv); }
+            void operator()(const cmd::SetTopology& c)          { r.ctx->IASetPrimitiveTopology(c.topology); }
+            void operator()(const cmd::SetVertexBuffer& c)      { r.ctx->IASetVertexBuffers(c.slot, 1, &c.buffer, &c.stride, &c.offset); }
+            void operator()(const cmd::SetIndexBuffer& c)       { r.ctx->IASetIndexBuffer(c.buffer, c.format, c.offset); }
+            void operator()(const cmd::SetRenderTargets& c)     { r.ctx->OMSetRenderTargets(c.count, c.rtvs, c.dsv); }
+            void operator()(const cmd::SetViewport& c)          { r.ctx->RSSetViewports(1, &c.viewport); }
+            void operator()(const cmd::ClearRenderTarget& c)    { r.ctx->ClearRenderTargetView(c.rtv, &c.color.x); }
+            void operator()(const cmd::ClearDepthStencil& c)    { r.ctx->ClearDepthStencilView(c.dsv, D3D11_CLEAR_DEPTH, c.depth, 0); }
+            void operator()(const cmd::Draw& c)                 { r.ctx->Draw(c.vertexCount, c.firstVertex); }
+            void operator()(const cmd::DrawIndexed& c)          { r.ctx->DrawIndexed(c.indexCount, c.firstIndex, c.baseVertex); }
+            void operator()(const cmd::DrawInstanced& c)        { r.ctx->DrawInstanced(c.vertexCount, c.instanceCount, c.firstVertex, c.firstInstance); }
+            void operator()(const cmd::DrawMesh& c)             { r.DrawMesh(c.mesh, c.lod); }
+
+            void operator()(const cmd::SetBlendState& c)
+            {
+                if (c.state)
+                    r.SetBlendState(*c.state, c.factor, c.sampleMask);
+                else
+                    r.ctx->OMSetBlendState(nullptr, &c.factor.x, c.sampleMask);
+            }
+
+            void operator()(const cmd::SetUploadVertexBuffer& c)
+            {
+                if (upload)
+                    r.ctx->IASetVertexBuffers(c.slot, 1, &upload, &c.stride, &c.offset);
+            }
+
+            void operator()(const cmd::UploadConstBuffer& c)
+            {
+                r.UpdateDynamicBuffer(c.buffer, c.Data(), c.size);
+                if (c.stages & VertexShader) r.ctx->VSSetConstantBuffers1(c.slot, 1, &c.buffer, nullptr, nullptr);
+                if (c.stages & PixelShader)  r.ctx->PSSetConstantBuffers1(c.slot, 1, &c.buffer, nullptr, nullptr);
+            }
+
+            void operator()(const cmd::DrawMeshInstanced& c)
+            {
+                if (upload)
+                    r.DrawMeshInstanced(c.mesh, upload, c.stride, c.offset, c.instanceCount, c.lod);
+            }
+        };
+
+        list.Visit(Replay{ *this, uploaded });
+    }
+
     void RenderContext::UploadMesh(Mesh* mesh)
     {
         mesh->uploaded = false;
 
-        for (auto& group : mesh->groups)
+        for (size_t i = 0; i < mesh->groups.size(); i++)
         {
+            auto& group = mesh->groups[i];
+
+            // Reuse the buffers of an earlier group made from the same data.
+            for (size_t j = 0; j < i; j++)
+            {
+                const auto& other = mesh->groups[j];
+                if (group.vertices.handle == nullptr && other.vertices.pointer == group.vertices.pointer)
+                    group.vertices.handle = other.vertices.handle;
+                if (group.indices.handle == nullptr && group.indices.indices != nullptr && other.indices.indices == group.indices.indices)
+                    group.indices.handle = other.indices.handle;
+            }
+
             // Vertex Buffers
             if (group.vertices.handle == nullptr) {
                 D3D11_BUFFER_DESC desc = {};
@@ -620,6 +774,17 @@ namespace chisel::render
             ctx->PSSetShader(shader.ps.ptr(), nullptr, 0);
     }
 
+    bool Shader::Exists(std::string_view name)
+    {
+        fs::Path path = fs::Path("core/shaders") / name;
+        path.setExt(".vsc");
+        if (!fs::exists(path))
+            return false;
+
+        path.setExt(".psc");
+        return fs::exists(path);
+    }
+
     Shader::Shader(ID3D11Device1* device, Span<D3D11_INPUT_ELEMENT_DESC const> ia, std::string_view name)
     {
         fs::Path path = fs::Path("core/shaders") / name;
@@ -24,12 +24,26 @@ namespace chisel
         Com<ID3D11ShaderResourceView> srvLinear;
         Com<ID3D11ShaderResourceView> srvSRGB;
 
+        // Recorded when the texture is created, so nothing has to ask the device.
+        uint        width     = 0;
+        uint        height    = 0;
+        uint        mipLevels = 0;
+        DXGI_FORMAT format    = DXGI_FORMAT_UNKNOWN;
+        bool        alpha     = false; // Has an alpha channel
+
         operator bool() const { return texture != nullptr; }
         virtual uint2 GetSize()
         {
-            D3D11_TEXTURE2D_DESC desc;
-            texture->GetDesc(&desc);
-            return uint2(desc.Width, desc.Height);
+            return uint2(width, height);
+        }
+
+        void SetDesc(const D3D11_TEXTURE2D_DESC& desc, bool hasAlpha = false)
+        {
+            width     = desc.Width;
+            height    = desc.Height;
+            mipLevels = desc.MipLevels;
+            format    = desc.Format;
+            alpha     = hasAlpha;
         }
     };
 
@@ -42,10 +56,21 @@ namespace chisel
             alphatest = 0;
         }
 
+        static inline const uint2 DefaultMappingSize = uint2(32, 32);
+
         Rc<Texture> baseTexture;
         Rc<Texture> baseTextures[3]; // Additional layers
         bool translucent : 1;
         bool alphatest   : 1;
+
+        // Texture size that texture axes are in: the base texture's, as recorded when it was created.
+        // Read on use so it follows the texture when it's reloaded. Never asks the device.
+        uint2 GetMappingSize() const
+        {
+            if (baseTexture == nullptr || baseTexture->width == 0 || baseTexture->height == 0)
+                return DefaultMappingSize;
+            return uint2(baseTexture->width, baseTexture->height);
+        }
     };
 }
 
@@ -83,6 +108,9 @@ namespace chisel::render
 
         Shader() {}
         Shader(ID3D11Device1* device, Span<D3D11_INPUT_ELEMENT_DESC const> ia, std::string_view name);
+
+        // If both stages of a shader have been compiled, for shaders that can be done without.
+        static bool Exists(std::string_view name);
     };
 
     struct ComputeShaderBuffer
@@ -113,7 +141,18 @@ namespace chisel::render
         Com<ID3D11Buffer> brush;
     };
 
-    struct RenderContext
+    class CommandList;
+
+    /**
+     * Where command lists are submitted to, see CommandList.
+     */
+    struct CommandBackend
+    {
+        virtual void Submit(const CommandList& list) = 0;
+        virtual ~CommandBackend() {}
+    };
+
+    struct RenderContext final : CommandBackend
     {
         void Init(Window* window);
         void Shutdown();
@@ -131,8 +170,13 @@ namespace chisel::render
 
 
         // Compatability with existing Mesh class
-        void DrawMesh(Mesh* mesh);
+        void DrawMesh(Mesh* mesh, uint lod = 0);
         void UploadMesh(Mesh* mesh);
+        // Draws instanceCount copies of the mesh, with per-instance data from slot 1, starting offset bytes in.
+        void DrawMeshInstanced(Mesh* mesh, ID3D11Buffer* instances, uint stride, uint offset, uint instanceCount, uint lod = 0);
+
+        // Replays a recorded command list on the immediate context. Main thread only.
+        void Submit(const CommandList& list) override;
 
         template <class T>
         ComputeShaderBuffer CreateCSOutputBuffer() { return CreateCSOutputBuffer(uint(sizeof(T))); }
@@ -164,6 +208,11 @@ namespace chisel::render
             UpdateDynamicBuffer(res, &data, sizeof(T));
         }
 
+        // Maps a dynamic buffer for writing size bytes, discarding what was in it.
+        // Recreates it bigger first if it's too small, capacity tracks its size in bytes.
+        // nullptr on failure, otherwise Unmap it once written.
+        void* MapDynamicBuffer(Com<ID3D11Buffer>& buffer, uint32& capacity, uint32 size, uint bindFlags = D3D11_BIND_VERTEX_BUFFER);
+
         Com<ID3D11Device1> device;
         Com<ID3D11DeviceContext1> ctx;
         Com<IDXGISwapChain> swapchain;
@@ -171,6 +220,9 @@ namespace chisel::render
         RenderTarget backbuffer;
 
         Com<ID3D11Buffer> scratchVertex;
+        // Command lists' upload data, refilled for each one submitted
+        Com<ID3D11Buffer> uploadBuffer;
+        uint32 uploadCapacity = 0;
         Com<ID3D11SamplerState> sampler;
 
         //-----------------------------------------------------------------------------